@@ -0,0 +1,128 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      arena.cpp
+//
+// Abstract:
+//      Per-thread bump allocator for temporaries that only live for a tick.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <new>
+#include "eng3d/arena.hpp"
+
+// Starting size of each thread's arena, grows to the largest tick seen
+constexpr size_t ARENA_INITIAL_CAPACITY = 256 * 1024;
+
+Eng3D::ArenaResource::ArenaResource(size_t initial_capacity)
+    : capacity{ initial_capacity },
+    block{ std::make_unique<std::byte[]>(initial_capacity) }
+{
+
+}
+
+Eng3D::ArenaResource::~ArenaResource() {
+    this->reset();
+}
+
+void Eng3D::ArenaResource::reset() {
+    for(const auto& [p, alignment] : this->overflow)
+        ::operator delete(p, std::align_val_t{ alignment });
+    this->overflow.clear();
+    if(this->used > this->capacity) {
+        this->capacity = std::bit_ceil(this->used);
+        this->block = std::make_unique<std::byte[]>(this->capacity);
+    }
+    this->offset = 0;
+    this->used = 0;
+}
+
+void* Eng3D::ArenaResource::do_allocate(size_t bytes, size_t alignment) {
+    this->used += bytes;
+    const auto aligned_offset = (this->offset + alignment - 1) & ~(alignment - 1);
+    if(aligned_offset + bytes <= this->capacity) {
+        this->offset = aligned_offset + bytes;
+        return this->block.get() + aligned_offset;
+    }
+    // Doesn't fit, fallback to the heap until the next reset
+    this->overflow.reserve(this->overflow.size() + 1);
+    auto* p = ::operator new(bytes, std::align_val_t{ alignment });
+    this->overflow.emplace_back(p, alignment);
+    return p;
+}
+
+void Eng3D::ArenaResource::do_deallocate(void*, size_t, size_t) {
+    // Freed in bulk on reset
+}
+
+bool Eng3D::ArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+/// @brief Arenas of all the threads, so they can be reset from the tick thread
+struct ArenaRegistry {
+    std::mutex lock;
+    std::vector<Eng3D::ArenaResource*> arenas;
+};
+
+static ArenaRegistry& get_registry() {
+    static ArenaRegistry registry;
+    return registry;
+}
+
+/// @brief Owns the arena of a thread and unregisters it when the thread exits
+struct ThreadArena {
+    ThreadArena()
+        : arena(ARENA_INITIAL_CAPACITY)
+    {
+        auto& registry = get_registry();
+        const std::scoped_lock lock(registry.lock);
+        registry.arenas.push_back(&arena);
+    }
+
+    ~ThreadArena() {
+        auto& registry = get_registry();
+        const std::scoped_lock lock(registry.lock);
+        std::erase(registry.arenas, &arena);
+    }
+
+    Eng3D::ArenaResource arena;
+};
+
+std::pmr::memory_resource* Eng3D::TickArena::get() {
+    thread_local ThreadArena thread_arena;
+    return &thread_arena.arena;
+}
+
+void Eng3D::TickArena::reset() {
+    auto& registry = get_registry();
+    const std::scoped_lock lock(registry.lock);
+    for(auto* arena : registry.arenas)
+        arena->reset();
+}
+
+size_t Eng3D::TickArena::get_used() {
+    auto& registry = get_registry();
+    const std::scoped_lock lock(registry.lock);
+    size_t total = 0;
+    for(const auto* arena : registry.arenas)
+        total += arena->used;
+    return total;
+}
@@ -0,0 +1,68 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      arena.hpp
+//
+// Abstract:
+//      Per-thread bump allocator for temporaries that only live for a tick.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace Eng3D {
+    /// @brief Bump allocator, deallocation is a no-op and all the memory is given
+    /// back at once with reset. Not thread safe, one is kept per thread by TickArena
+    class ArenaResource final : public std::pmr::memory_resource {
+    public:
+        ArenaResource(size_t initial_capacity);
+        ~ArenaResource() override;
+        /// @brief Releases everything allocated so far, if the block overflowed
+        /// it's grown so the next cycle fits in a single block
+        void reset();
+
+        size_t used = 0; // Bytes handed out since the last reset
+        size_t capacity = 0;
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        std::unique_ptr<std::byte[]> block;
+        size_t offset = 0;
+        std::vector<std::pair<void*, size_t>> overflow; // Allocations that didn't fit on the block
+    };
+
+    /// @brief Arena for simulation temporaries (per-province scratch vectors,
+    /// sorting buffers, combinables). Each thread gets its own ArenaResource so
+    /// no locking is needed when allocating, everything is released at once by
+    /// reset at the end of the tick, after which no pointer into it may be kept
+    namespace TickArena {
+        /// @brief Memory resource of the calling thread
+        std::pmr::memory_resource* get();
+        /// @brief Release the memory of every thread's arena, must be called while
+        /// no other thread is using their arena (i.e at the end of the tick)
+        void reset();
+        /// @brief Bytes handed out by all arenas since the last reset
+        size_t get_used();
+    }
+}
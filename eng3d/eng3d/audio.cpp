@@ -43,7 +43,7 @@
 Eng3D::Audio::Audio(const std::string_view path, bool _is_sound)
     : is_sound{ _is_sound }
 {
-    Eng3D::Log::debug("audio", Eng3D::translate_format("Decoding audio %s", path.data()));
+    Eng3D::Log::debug("audio", "Decoding audio %s", path.data());
     if(this->is_sound) this->stream = (void*)Mix_LoadWAV(std::string(path).c_str());
     else this->stream = (void*)Mix_LoadMUS(std::string(path).c_str());
 }
@@ -69,7 +69,7 @@ Eng3D::AudioManager::AudioManager(Eng3D::State& _s)
 void Eng3D::AudioManager::play_sound(const std::string_view path) {
     auto audio = this->load(path, true);
     if((audio->channel = Mix_PlayChannel(-1, (Mix_Chunk *)audio->stream, 0)) < 0)
-        Eng3D::Log::warning("audio", Eng3D::translate_format("Unable to load audio %s: %s", path.data(), Mix_GetError()));
+        Eng3D::Log::warning("audio", "Unable to load audio %s: %s", path.data(), Mix_GetError());
     this->current_sound = audio;
 }
 
@@ -87,7 +87,7 @@ void Eng3D::AudioManager::set_sound_volume(float v) {
 void Eng3D::AudioManager::play_music(const std::string_view path) {
     auto audio = this->load(path, false);
     if(Mix_PlayMusic((Mix_Music *)audio->stream, 0) < 0)
-        Eng3D::Log::warning("audio", Eng3D::translate_format("Unable to load audio %s: %s", path.data(), Mix_GetError()));
+        Eng3D::Log::warning("audio", "Unable to load audio %s: %s", path.data(), Mix_GetError());
     this->current_music = audio;
 }
 
@@ -113,6 +113,6 @@ const std::shared_ptr<Eng3D::Audio> Eng3D::AudioManager::load(const std::string_
     if(it != audios.cend()) return (*it).second;
     // Otherwise Sound is not in our control, so we create a new one
     audios[key] = std::make_shared<Eng3D::Audio>(path, is_sound);
-    Eng3D::Log::debug("audio", Eng3D::translate_format("Loaded and cached sound %s", path.data()));
+    Eng3D::Log::debug("audio", "Loaded and cached sound %s", path.data());
     return audios[key];
 }
@@ -0,0 +1,153 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      chunked_archive.cpp
+//
+// Abstract:
+//      Reading and writing of chunked archives.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "eng3d/chunked_archive.hpp"
+#include "eng3d/compress.hpp"
+#include "eng3d/log.hpp"
+
+constexpr char chunked_archive_signature[4] = { '>', ':', ')', 'C' };
+constexpr uint32_t chunked_archive_version = 1;
+
+// File layout: signature, version, header chunk and list chunks table (name,
+// first element, element count, offset, uncompressed and compressed sizes),
+// then the compressed chunks one after another
+
+void Eng3D::Deser::ChunkedArchive::to_file(const std::string_view path) {
+    const auto start = std::chrono::steady_clock::now();
+    this->header.end_stream();
+    std::vector<Chunk*> all_chunks{ nullptr };
+    for(auto& chunk : this->chunks)
+        all_chunks.push_back(&chunk);
+
+    std::vector<std::vector<uint8_t>> compressed(all_chunks.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, all_chunks.size()), [&](const auto& range) {
+        for(size_t i = range.begin(); i != range.end(); i++) {
+            const auto& data = all_chunks[i] != nullptr ? all_chunks[i]->data : this->header.buffer;
+            compressed[i].resize(Eng3D::Zlib::get_compressed_size(data.size()));
+            compressed[i].resize(Eng3D::Zlib::compress(data.data(), data.size(), compressed[i].data(), compressed[i].size(), Z_BEST_SPEED));
+        }
+    });
+
+    Eng3D::Deser::Archive table{};
+    uint32_t n_chunks = all_chunks.size();
+    Eng3D::Deser::serialize(table, chunked_archive_version);
+    Eng3D::Deser::serialize(table, n_chunks);
+    uint64_t offset = 0;
+    for(size_t i = 0; i < all_chunks.size(); i++) {
+        const auto* chunk = all_chunks[i];
+        std::string list = chunk != nullptr ? chunk->list : std::string{};
+        uint64_t first = chunk != nullptr ? chunk->first : 0, count = chunk != nullptr ? chunk->count : 0;
+        uint64_t size = chunk != nullptr ? chunk->data.size() : this->header.size();
+        uint64_t compressed_size = compressed[i].size();
+        Eng3D::Deser::serialize(table, list);
+        Eng3D::Deser::serialize(table, first);
+        Eng3D::Deser::serialize(table, count);
+        Eng3D::Deser::serialize(table, offset);
+        Eng3D::Deser::serialize(table, size);
+        Eng3D::Deser::serialize(table, compressed_size);
+        offset += compressed_size;
+    }
+
+    std::unique_ptr<FILE, decltype(&std::fclose)> fp(std::fopen(path.data(), "wb"), std::fclose);
+    if(fp == nullptr)
+        CXX_THROW(Eng3D::Deser::Exception, translate_format("Can't write archive %s", path.data()));
+    uint64_t table_size = table.size();
+    std::fwrite(chunked_archive_signature, 1, sizeof(chunked_archive_signature), fp.get());
+    std::fwrite(&table_size, 1, sizeof(table_size), fp.get());
+    std::fwrite(table.buffer.data(), 1, table.size(), fp.get());
+    for(const auto& data : compressed)
+        std::fwrite(data.data(), 1, data.size(), fp.get());
+    const auto ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    Eng3D::Log::debug("archive", "Wrote %u chunks (%zu compressed bytes) to %s in %.2fms", n_chunks, static_cast<size_t>(offset), path.data(), ms);
+}
+
+void Eng3D::Deser::ChunkedArchive::from_file(const std::string_view path) {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<FILE, decltype(&std::fclose)> fp(std::fopen(path.data(), "rb"), std::fclose);
+    if(fp == nullptr)
+        CXX_THROW(Eng3D::Deser::Exception, translate_format("Can't read archive %s", path.data()));
+    char signature[sizeof(chunked_archive_signature)];
+    uint64_t table_size = 0;
+    if(std::fread(signature, 1, sizeof(signature), fp.get()) != sizeof(signature)
+    || std::memcmp(signature, chunked_archive_signature, sizeof(signature)) != 0
+    || std::fread(&table_size, 1, sizeof(table_size), fp.get()) != sizeof(table_size))
+        CXX_THROW(Eng3D::Deser::Exception, "Invalid archive");
+
+    Eng3D::Deser::Archive table{};
+    table.buffer.resize(table_size);
+    if(std::fread(table.buffer.data(), 1, table.size(), fp.get()) != table.size())
+        CXX_THROW(Eng3D::Deser::Exception, "Truncated archive");
+    uint32_t version = 0, n_chunks = 0;
+    Eng3D::Deser::deserialize(table, version);
+    Eng3D::Deser::deserialize(table, n_chunks);
+    if(version != chunked_archive_version || n_chunks == 0)
+        CXX_THROW(Eng3D::Deser::Exception, "Unsupported archive version");
+
+    struct Entry {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t compressed_size = 0;
+    };
+    std::vector<Entry> entries(n_chunks);
+    this->chunks.clear();
+    this->chunks.resize(n_chunks - 1);
+    for(size_t i = 0; i < n_chunks; i++) {
+        std::string list;
+        uint64_t first = 0, count = 0;
+        Eng3D::Deser::deserialize(table, list);
+        Eng3D::Deser::deserialize(table, first);
+        Eng3D::Deser::deserialize(table, count);
+        Eng3D::Deser::deserialize(table, entries[i].offset);
+        Eng3D::Deser::deserialize(table, entries[i].size);
+        Eng3D::Deser::deserialize(table, entries[i].compressed_size);
+        // Every element takes at least a byte
+        if(count > entries[i].size)
+            CXX_THROW(Eng3D::Deser::Exception, "Invalid chunk entry");
+        if(i > 0)
+            this->chunks[i - 1] = Chunk{ list, first, count, {} };
+    }
+
+    const auto& last = entries.back();
+    std::vector<uint8_t> compressed(last.offset + last.compressed_size);
+    if(std::fread(compressed.data(), 1, compressed.size(), fp.get()) != compressed.size())
+        CXX_THROW(Eng3D::Deser::Exception, "Truncated archive");
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, n_chunks), [&](const auto& range) {
+        for(size_t i = range.begin(); i != range.end(); i++) {
+            const auto& entry = entries[i];
+            if(entry.offset + entry.compressed_size > compressed.size())
+                CXX_THROW(Eng3D::Deser::Exception, "Chunk out of the archive bounds");
+            auto& data = i > 0 ? this->chunks[i - 1].data : this->header.buffer;
+            data.resize(entry.size);
+            if(Eng3D::Zlib::decompress(compressed.data() + entry.offset, entry.compressed_size, data.data(), data.size()) != entry.size)
+                CXX_THROW(Eng3D::Deser::Exception, "Corrupted chunk");
+        }
+    });
+    this->header.rewind();
+    this->stats.clear();
+    const auto ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    Eng3D::Log::debug("archive", "Read %u chunks (%zu compressed bytes) from %s in %.2fms", n_chunks, compressed.size(), path.data(), ms);
+}
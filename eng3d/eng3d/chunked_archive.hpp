@@ -0,0 +1,159 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      chunked_archive.hpp
+//
+// Abstract:
+//      Archive made of independently compressed chunks, so big lists can be
+//      (de)serialized and (de)compressed in parallel.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include "eng3d/serializer.hpp"
+
+namespace Eng3D::Deser {
+    /// @brief Archive split into chunks which are compressed on their own and
+    /// stitched together with an offset table. Big lists are split onto chunks
+    /// of elements that are (de)serialized in parallel, everything else goes
+    /// onto the header chunk. Lists aren't limited by max_elements
+    class ChunkedArchive {
+    public:
+        struct Chunk {
+            std::string list; // Empty for the header
+            uint64_t first = 0; // Index of the first element
+            uint64_t count = 0;
+            std::vector<uint8_t> data;
+        };
+
+        /// @brief Timing of the (de)serialization of a list
+        struct ListStats {
+            std::string name;
+            size_t elements = 0;
+            size_t chunks = 0;
+            size_t bytes = 0; // Uncompressed
+            float ms = 0.f;
+        };
+
+        ChunkedArchive() = default;
+        ~ChunkedArchive() = default;
+        void to_file(const std::string_view path);
+        void from_file(const std::string_view path);
+
+        template<bool is_serialize, typename T>
+        void deser_list(const std::string_view name, typename CondConstType<is_serialize, std::vector<T>>::type& list, size_t chunk_elements) {
+            if constexpr(is_serialize) this->serialize_list(name, list, chunk_elements);
+            else this->deserialize_list(name, list);
+        }
+
+        template<typename T>
+        void serialize_list(const std::string_view name, const std::vector<T>& list, size_t chunk_elements) {
+            const auto start = std::chrono::steady_clock::now();
+            chunk_elements = std::max<size_t>(chunk_elements, 1); // Chunks of nothing would never cover the list
+            const size_t n_chunks = (list.size() + chunk_elements - 1) / chunk_elements;
+            const size_t base = this->chunks.size();
+            this->chunks.resize(base + n_chunks);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, n_chunks), [&](const auto& range) {
+                for(size_t i = range.begin(); i != range.end(); i++) {
+                    auto& chunk = this->chunks[base + i];
+                    chunk.list = name;
+                    chunk.first = i * chunk_elements;
+                    chunk.count = std::min(chunk_elements, list.size() - chunk.first);
+                    Eng3D::Deser::Archive ar{};
+                    for(size_t j = 0; j < chunk.count; j++)
+                        Eng3D::Deser::serialize(ar, list[chunk.first + j]);
+                    chunk.data = std::move(ar.buffer);
+                }
+            });
+            this->add_stats(name, list.size(), base, n_chunks, start);
+        }
+
+        template<typename T>
+        void deserialize_list(const std::string_view name, std::vector<T>& list) {
+            const auto start = std::chrono::steady_clock::now();
+            // Chunks of a list are always stored next to each other
+            const auto it = std::find_if(this->chunks.begin(), this->chunks.end(), [name](const auto& chunk) { return chunk.list == name; });
+            const size_t base = std::distance(this->chunks.begin(), it);
+            const size_t n_chunks = std::distance(it, std::find_if(it, this->chunks.end(), [name](const auto& chunk) { return chunk.list != name; }));
+            const size_t size = n_chunks > 0 ? this->chunks[base + n_chunks - 1].first + this->chunks[base + n_chunks - 1].count : 0;
+            list.clear();
+            list.resize(size);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, n_chunks), [&](const auto& range) {
+                for(size_t i = range.begin(); i != range.end(); i++) {
+                    auto& chunk = this->chunks[base + i];
+                    if(chunk.first + chunk.count > size)
+                        CXX_THROW(Eng3D::Deser::Exception, "Chunk out of the list bounds");
+                    Eng3D::Deser::Archive ar{};
+                    ar.buffer = std::move(chunk.data);
+                    for(size_t j = 0; j < chunk.count; j++)
+                        Eng3D::Deser::deserialize(ar, list[chunk.first + j]);
+                    if(ar.ptr != ar.size())
+                        CXX_THROW(Eng3D::Deser::Exception, "Chunk has trailing data");
+                    chunk.data = std::move(ar.buffer);
+                }
+            });
+            this->add_stats(name, size, base, n_chunks, start);
+        }
+
+        const std::vector<ListStats>& get_stats() const {
+            return this->stats;
+        }
+
+        /// @brief FNV-1a hash of the uncompressed contents, two archives of the same
+        /// data have the same hash regardless of how many threads made them
+        uint64_t get_hash() const {
+            uint64_t hash = 0xcbf29ce484222325;
+            const auto hash_bytes = [&hash](const void* data, size_t size) {
+                const auto* bytes = static_cast<const uint8_t*>(data);
+                for(size_t i = 0; i < size; i++)
+                    hash = (hash ^ bytes[i]) * 0x100000001b3;
+            };
+            hash_bytes(this->header.buffer.data(), this->header.buffer.size());
+            for(const auto& chunk : this->chunks) {
+                hash_bytes(chunk.list.data(), chunk.list.size());
+                hash_bytes(&chunk.first, sizeof(chunk.first));
+                hash_bytes(&chunk.count, sizeof(chunk.count));
+                hash_bytes(chunk.data.data(), chunk.data.size());
+            }
+            return hash;
+        }
+
+        /// @brief Small data, stored as a single chunk
+        Eng3D::Deser::Archive header;
+    private:
+        void add_stats(const std::string_view name, size_t elements, size_t first_chunk, size_t n_chunks, std::chrono::steady_clock::time_point start) {
+            ListStats list_stats{ std::string(name), elements, n_chunks, 0, 0.f };
+            for(size_t i = first_chunk; i < first_chunk + n_chunks; i++)
+                list_stats.bytes += this->chunks[i].data.size();
+            list_stats.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            this->stats.push_back(list_stats);
+        }
+
+        std::vector<Chunk> chunks;
+        std::vector<ListStats> stats;
+    };
+}
@@ -24,18 +24,24 @@
 
 #pragma once
 
+#include <stdexcept>
 #include <zlib.h>
+#include "eng3d/utils.hpp"
 
 namespace Eng3D::Zlib {
-    size_t get_compressed_size(size_t len) {
+    inline size_t get_compressed_size(size_t len) {
         return ::compressBound(len);
     }
-    
-    size_t compress(const void* src, size_t src_len, void* dest, unsigned long dest_len) {
-        return ::compress(static_cast<Bytef*>(dest), &dest_len, static_cast<const Bytef*>(src), src_len);
+
+    /// @brief Compress src onto dest
+    /// @return size_t Size of the compressed data
+    inline size_t compress(const void* src, size_t src_len, void* dest, unsigned long dest_len, int level = Z_DEFAULT_COMPRESSION) {
+        const auto r = ::compress2(static_cast<Bytef*>(dest), &dest_len, static_cast<const Bytef*>(src), src_len, level);
+        if(r == Z_OK) return dest_len;
+        CXX_THROW(std::runtime_error, "Insufficient zlib output buffer size for deflate");
     }
 
-    size_t decompress(const void* src, size_t src_len, void* dest, unsigned long dest_len) {
+    inline size_t decompress(const void* src, size_t src_len, void* dest, unsigned long dest_len) {
         const auto r = ::uncompress(static_cast<Bytef*>(dest), &dest_len, static_cast<const Bytef*>(src), src_len);
         if(r == Z_OK) return dest_len;
         CXX_THROW(std::runtime_error, "Insufficient zlib output buffer size for inflate");
@@ -85,6 +85,13 @@ public:
         for(const auto& [_, index] : small)
             prob[index] = 1.f;
         small.clear();
+    }
+    /// @brief Construct from any pair of ranges (i.e PMR vectors), items are copied
+    template<typename I, typename P>
+    DiscreteDistribution(const I& items, const P& probabilities)
+        : DiscreteDistribution(std::vector<T>(items.begin(), items.end()), std::vector<float>(probabilities.begin(), probabilities.end()))
+    {
+
     }
     ~DiscreteDistribution() = default;
 
@@ -27,6 +27,7 @@
 #include <cstddef>
 #include <cassert>
 #include <optional>
+#include <vector>
 #include "eng3d/utils.hpp"
 
 namespace Eng3D {
@@ -45,6 +46,23 @@ namespace Eng3D {
             return index;
         }
 
+        /// @brief Place the element on the given index, used to mirror the indices of
+        /// another freelist (i.e one on a remote end)
+        void add_at(size_t index, T& e) {
+            if(index >= data.size()) {
+                for(size_t i = data.size(); i < index; i++)
+                    slots.push_back(i);
+                data.resize(index + 1);
+            } else if(!data[index].has_value()) {
+                std::erase(slots, index);
+            }
+            data[index].emplace(e);
+        }
+
+        bool contains(size_t index) const {
+            return index < data.size() && data[index].has_value();
+        }
+
         void remove(size_t index) {
             assert(data[index].has_value());
             data[index].reset();
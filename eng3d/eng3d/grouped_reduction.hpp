@@ -0,0 +1,97 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      grouped_reduction.hpp
+//
+// Abstract:
+//      Sums values of elements onto the groups they belong to, in parallel
+//      and without per-thread copies of the groups.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace Eng3D {
+    /// @brief Elements are bucketed by group first, then every group is summed by
+    /// a single task. There's nothing to combine afterwards, no locks, and the sums
+    /// are made in element order so they don't depend on how the work was scheduled
+    class GroupedReduction {
+    public:
+        GroupedReduction() = default;
+        ~GroupedReduction() = default;
+
+        /// @brief Bucket the elements by group, elements whose group isn't below n_groups are left out
+        /// @param get_group Group of an element given its index
+        template<typename F>
+        void partition(size_t n_elements, size_t n_groups, F&& get_group) {
+            this->element_groups.resize(n_elements);
+            this->offsets.assign(n_groups + 1, 0);
+            for(size_t i = 0; i < n_elements; i++) {
+                const size_t group = get_group(i);
+                this->element_groups[i] = group;
+                if(group < n_groups)
+                    this->offsets[group + 1]++;
+            }
+            for(size_t i = 0; i < n_groups; i++)
+                this->offsets[i + 1] += this->offsets[i];
+
+            // Counting sort, keeps the elements of a group in ascending order
+            this->elements.resize(this->offsets.back());
+            this->cursors.assign(this->offsets.begin(), this->offsets.end() - 1);
+            for(size_t i = 0; i < n_elements; i++) {
+                const auto group = this->element_groups[i];
+                if(group < n_groups)
+                    this->elements[this->cursors[group]++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        /// @brief Sum the values of the elements of every group in parallel
+        /// @param fn Called once per group with the group and its sum, from the task that owns the group
+        template<typename T, typename F>
+        void reduce(const T* values, F&& fn) const {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, this->size()), [&](const auto& range) {
+                for(size_t group = range.begin(); group != range.end(); group++) {
+                    T sum{};
+                    for(const auto element : this->get_elements(group))
+                        sum += values[element];
+                    fn(group, sum);
+                }
+            });
+        }
+
+        /// @brief Number of groups
+        size_t size() const {
+            return this->offsets.empty() ? 0 : this->offsets.size() - 1;
+        }
+
+        std::span<const uint32_t> get_elements(size_t group) const {
+            return std::span<const uint32_t>(this->elements.data() + this->offsets[group], this->offsets[group + 1] - this->offsets[group]);
+        }
+    private:
+        std::vector<uint32_t> elements; // Elements sorted by group
+        std::vector<size_t> offsets; // Where the elements of each group start, plus the end
+        std::vector<size_t> element_groups;
+        std::vector<size_t> cursors;
+    };
+}
@@ -22,32 +22,69 @@
 //      Overrides default new/delete operators.
 // ----------------------------------------------------------------------------
 
-#ifdef E3D_MANAGED_HEAP
 #include <cstdlib>
 #include <new>
+#include <atomic>
 
 #include "eng3d/heap_ext.hpp"
 #include "eng3d/utils.hpp"
 
-void* operator new(std::size_t size) {
+#ifdef E3D_MANAGED_HEAP
+// Relaxed ordering is enough, these are only read for statistics
+static std::atomic<size_t> g_allocations = 0;
+static std::atomic<size_t> g_deallocations = 0;
+static std::atomic<size_t> g_bytes = 0;
+
+static inline void* managed_alloc(std::size_t size) {
     if(size == 0) size++;
     void* p = std::malloc(size);
-    if(p) return p;
+    if(p) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes.fetch_add(size, std::memory_order_relaxed);
+        return p;
+    }
     CXX_THROW(std::bad_alloc);
 }
 
-void operator delete(void* ptr) noexcept {
+static inline void managed_free(void* ptr) noexcept {
+    if(ptr == nullptr) return;
+    g_deallocations.fetch_add(1, std::memory_order_relaxed);
     std::free(ptr);
 }
 
+void* operator new(std::size_t size) {
+    return managed_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    managed_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    managed_free(ptr);
+}
+
 void* operator new[](std::size_t size) {
-    if(size == 0) size++;
-    void* p = std::malloc(size);
-    if(p) return p;
-    CXX_THROW(std::bad_alloc);
+    return managed_alloc(size);
 }
 
 void operator delete[](void* ptr) noexcept {
-    std::free(ptr);
+    managed_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    managed_free(ptr);
+}
+
+Eng3D::Heap::Stats Eng3D::Heap::get_stats() {
+    Eng3D::Heap::Stats stats{};
+    stats.allocations = g_allocations.load(std::memory_order_relaxed);
+    stats.deallocations = g_deallocations.load(std::memory_order_relaxed);
+    stats.bytes = g_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+#else
+Eng3D::Heap::Stats Eng3D::Heap::get_stats() {
+    return Eng3D::Heap::Stats{};
 }
 #endif
@@ -0,0 +1,41 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      heap_ext.hpp
+//
+// Abstract:
+//      Counters for the managed heap.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+
+namespace Eng3D::Heap {
+    /// @brief Cumulative counters of the managed heap, these are process wide so
+    /// allocations done by other threads are also accounted for
+    struct Stats {
+        size_t allocations = 0;
+        size_t deallocations = 0;
+        size_t bytes = 0; // Total bytes requested
+    };
+
+    /// @brief Obtain the counters of the managed heap, all zeroes when Eng3D isn't
+    /// managing the heap (E3D_MANAGED_HEAP is not defined)
+    Stats get_stats();
+}
@@ -92,5 +92,5 @@ void Eng3D::Interface::ProfilerTaskView::set_task(Eng3D::BenchmarkTask& profiler
     float time = profiler_view.get_average_time_ms();
     auto format_time = std::to_string((int)time);
     format_time = std::string(3 - glm::min<size_t>(3, format_time.length()), '0') + format_time;
-    this->label->set_text(format_time + " ms " + profiler_view.name);
+    this->label->set_text(format_time + " ms " + std::to_string(profiler_view.last_allocations) + " allocs " + profiler_view.name);
 }
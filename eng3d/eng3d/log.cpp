@@ -19,18 +19,271 @@
 //      log.cpp
 //
 // Abstract:
-//      Does some important stuff.
+//      Lock-free message ring, drained by a writer thread onto the console and
+//      the log file, and the per call site rate limiter.
 // ----------------------------------------------------------------------------
 
 #include <cstdio>
 #include <optional>
 #include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <unordered_set>
 #include "SDL.h"
 #include "log.hpp"
 
 bool Eng3D::Log::debug_show = false;
 
+namespace {
+    constexpr size_t SLOT_COUNT = 1024; // Power of two
+    constexpr size_t RATE_BUCKETS = 256;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        size_t length;
+        char text[Eng3D::Log::MAX_MESSAGE_SIZE + 64]; // Message plus the severity and category
+    };
+
+    /// @brief Messages sent per second by a call site, call sites hashing to the
+    /// same bucket share their limit
+    struct RateBucket {
+        std::atomic<const char*> key = nullptr;
+        std::atomic<int64_t> second = 0;
+        std::atomic<size_t> count = 0;
+        std::atomic<size_t> suppressed = 0;
+    };
+
+    /// @brief Bounded multi-producer single-consumer ring, producers never block,
+    /// when the ring is full the message is dropped
+    class Sink {
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<size_t> enqueue_pos = 0;
+        size_t dequeue_pos = 0; // Only touched by the writer
+        std::atomic<uint32_t> wake = 0;
+        std::atomic<bool> running = false;
+        std::atomic<bool> stopped = false;
+        std::once_flag start_flag;
+        std::thread writer;
+        std::mutex file_mutex;
+        std::FILE* file = nullptr;
+    public:
+        std::atomic<size_t> written = 0;
+        std::atomic<size_t> dropped = 0;
+        std::atomic<size_t> suppressed = 0;
+        std::atomic<size_t> rate_limit = 32;
+        RateBucket rate_buckets[RATE_BUCKETS];
+        std::atomic<bool> any_category_disabled = false;
+        std::mutex categories_mutex;
+        std::unordered_set<std::string> disabled_categories;
+
+        Sink()
+            : slots{ std::make_unique<Slot[]>(SLOT_COUNT) }
+        {
+            for(size_t i = 0; i < SLOT_COUNT; i++)
+                this->slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        ~Sink() {
+            this->stop();
+            if(this->file != nullptr)
+                std::fclose(this->file);
+        }
+
+        void start() {
+            std::call_once(this->start_flag, [this] {
+                this->running = true;
+                this->writer = std::thread(&Sink::write_loop, this);
+            });
+        }
+
+        void stop() {
+            if(this->stopped.exchange(true)) return;
+            this->running = false;
+            this->wake.fetch_add(1, std::memory_order_release);
+            this->wake.notify_one();
+            if(this->writer.joinable())
+                this->writer.join();
+        }
+
+        void write_line(const char* text, size_t length) {
+            SDL_Log("%.*s", static_cast<int>(length), text);
+            const std::scoped_lock lock(this->file_mutex);
+            if(this->file != nullptr) {
+                std::fwrite(text, 1, length, this->file);
+                std::fputc('\n', this->file);
+            }
+            this->written.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void push(const std::string_view severity, const std::string_view category, const std::string_view msg) {
+            if(this->stopped.load(std::memory_order_acquire)) { // Logging during shutdown, just write it
+                char text[sizeof(Slot::text)];
+                const auto length = this->format(text, severity, category, msg);
+                this->write_line(text, length);
+                return;
+            }
+            this->start();
+
+            auto pos = this->enqueue_pos.load(std::memory_order_relaxed);
+            Slot* slot;
+            while(1) {
+                slot = &this->slots[pos % SLOT_COUNT];
+                const auto seq = slot->sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if(diff == 0) {
+                    if(this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if(diff < 0) { // Full
+                    this->dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                } else {
+                    pos = this->enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            slot->length = this->format(slot->text, severity, category, msg);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            this->wake.fetch_add(1, std::memory_order_release);
+            this->wake.notify_one();
+        }
+
+        /// @brief Wait until the writer has consumed everything enqueued so far
+        void flush() {
+            const auto target = this->enqueue_pos.load(std::memory_order_acquire);
+            if(target == 0) return;
+            while(this->running.load(std::memory_order_acquire)) {
+                // A dequeued slot gets the sequence of its next lap
+                const auto& slot = this->slots[(target - 1) % SLOT_COUNT];
+                if(slot.sequence.load(std::memory_order_acquire) >= target - 1 + SLOT_COUNT)
+                    break;
+                std::this_thread::yield();
+            }
+            const std::scoped_lock lock(this->file_mutex);
+            if(this->file != nullptr)
+                std::fflush(this->file);
+        }
+
+        bool open_file(const std::string_view path) {
+            auto* new_file = std::fopen(std::string(path).c_str(), "wt");
+            if(new_file == nullptr) return false;
+            const std::scoped_lock lock(this->file_mutex);
+            if(this->file != nullptr)
+                std::fclose(this->file);
+            this->file = new_file;
+            return true;
+        }
+    private:
+        static size_t format(char* text, const std::string_view severity, const std::string_view category, const std::string_view msg) {
+            const int length = std::snprintf(text, sizeof(Slot::text), "<%.*s:%.*s> %.*s",
+                static_cast<int>(severity.size()), severity.data(),
+                static_cast<int>(category.size()), category.data(),
+                static_cast<int>(msg.size()), msg.data());
+            return std::min<size_t>(std::max(length, 0), sizeof(Slot::text) - 1);
+        }
+
+        void write_loop() {
+            while(1) {
+                const auto wake_value = this->wake.load(std::memory_order_acquire);
+                bool any = false;
+                while(1) {
+                    auto& slot = this->slots[this->dequeue_pos % SLOT_COUNT];
+                    if(slot.sequence.load(std::memory_order_acquire) != this->dequeue_pos + 1)
+                        break;
+                    this->write_line(slot.text, slot.length);
+                    slot.sequence.store(this->dequeue_pos + SLOT_COUNT, std::memory_order_release);
+                    this->dequeue_pos++;
+                    any = true;
+                }
+                if(any) {
+                    const std::scoped_lock lock(this->file_mutex);
+                    if(this->file != nullptr)
+                        std::fflush(this->file);
+                    continue;
+                }
+                if(!this->running.load(std::memory_order_acquire))
+                    break;
+                this->wake.wait(wake_value, std::memory_order_acquire);
+            }
+        }
+    };
+
+    Sink& get_sink() {
+        static Sink sink;
+        return sink;
+    }
+}
+
 /// @brief Logs data to a file or console
 void Eng3D::Log::log(const std::string_view severity, const std::string_view category, const std::string_view msg) {
-    SDL_Log("<%s:%s> %s", severity.data(), category.data(), msg.data());
+    get_sink().push(severity, category, msg);
+}
+
+bool Eng3D::Log::is_enabled(Eng3D::Log::Level level, const std::string_view category) {
+    if(level == Eng3D::Log::Level::DEBUG && !Eng3D::Log::debug_show)
+        return false;
+    auto& sink = get_sink();
+    if(!sink.any_category_disabled.load(std::memory_order_relaxed))
+        return true;
+    const std::scoped_lock lock(sink.categories_mutex);
+    return !sink.disabled_categories.contains(std::string(category));
+}
+
+bool Eng3D::Log::should_log(Eng3D::Log::Level level, const std::string_view category, const char* key) {
+    if(!Eng3D::Log::is_enabled(level, category))
+        return false;
+    auto& sink = get_sink();
+    const auto limit = sink.rate_limit.load(std::memory_order_relaxed);
+    if(limit == 0 || level == Eng3D::Log::Level::ERROR)
+        return true;
+
+    auto& bucket = sink.rate_buckets[(reinterpret_cast<uintptr_t>(key) >> 3) % RATE_BUCKETS];
+    const auto second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    auto bucket_second = bucket.second.load(std::memory_order_relaxed);
+    if(bucket_second != second && bucket.second.compare_exchange_strong(bucket_second, second, std::memory_order_relaxed)) {
+        // New window, report what the previous one held back
+        const auto suppressed = bucket.suppressed.exchange(0, std::memory_order_relaxed);
+        const auto* last_key = bucket.key.load(std::memory_order_relaxed);
+        bucket.count.store(0, std::memory_order_relaxed);
+        if(suppressed > 0 && last_key != nullptr)
+            Eng3D::Log::log_format(level, category, "Suppressed %zu messages like \"%s\"", suppressed, last_key);
+    }
+    bucket.key.store(key, std::memory_order_relaxed);
+    if(bucket.count.fetch_add(1, std::memory_order_relaxed) < limit)
+        return true;
+    bucket.suppressed.fetch_add(1, std::memory_order_relaxed);
+    sink.suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Eng3D::Log::set_category_enabled(const std::string_view category, bool enabled) {
+    auto& sink = get_sink();
+    const std::scoped_lock lock(sink.categories_mutex);
+    if(enabled)
+        sink.disabled_categories.erase(std::string(category));
+    else
+        sink.disabled_categories.insert(std::string(category));
+    sink.any_category_disabled = !sink.disabled_categories.empty();
+}
+
+void Eng3D::Log::set_rate_limit(size_t max_per_second) {
+    get_sink().rate_limit = max_per_second;
+}
+
+bool Eng3D::Log::open_file(const std::string_view path) {
+    return get_sink().open_file(path);
+}
+
+void Eng3D::Log::flush() {
+    get_sink().flush();
+}
+
+Eng3D::Log::Stats Eng3D::Log::get_stats() {
+    auto& sink = get_sink();
+    Eng3D::Log::Stats stats{};
+    stats.written = sink.written.load(std::memory_order_relaxed);
+    stats.dropped = sink.dropped.load(std::memory_order_relaxed);
+    stats.suppressed = sink.suppressed.load(std::memory_order_relaxed);
+    return stats;
 }
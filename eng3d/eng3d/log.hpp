@@ -19,27 +19,108 @@
 //      log.hpp
 //
 // Abstract:
-//      Does some important stuff.
+//      Level and category gated logging. Messages are queued on a lock-free ring
+//      and written to the console and log file by a background thread.
 // ----------------------------------------------------------------------------
 
 #pragma once
 
+#include <cstdio>
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include <algorithm>
 
 namespace Eng3D::Log {
+    enum class Level {
+        DEBUG,
+        WARNING,
+        ERROR,
+    };
+
+    /// @brief Maximum length of a single message, longer ones are truncated
+    constexpr size_t MAX_MESSAGE_SIZE = 480;
+
     extern bool debug_show;
+
+    struct Stats {
+        size_t written = 0;
+        size_t dropped = 0; // The ring was full
+        size_t suppressed = 0; // By the rate limiter
+    };
+
     void log(const std::string_view severity, const std::string_view category, const std::string_view msg);
+    /// @brief Whether messages of the given level and category are shown at all
+    bool is_enabled(Level level, const std::string_view category);
+    /// @brief Like is_enabled, but also accounts a message of the call site
+    /// identified by key (the format string) against the rate limit
+    bool should_log(Level level, const std::string_view category, const char* key);
+    void set_category_enabled(const std::string_view category, bool enabled);
+    /// @brief Maximum formatted messages per second from a single call site, 0 for unlimited
+    void set_rate_limit(size_t max_per_second);
+    /// @brief Additionally write the log onto the given file
+    bool open_file(const std::string_view path);
+    /// @brief Block until every queued message has been written
+    void flush();
+    Stats get_stats();
+
+    static inline const char* get_level_name(Level level) {
+        switch(level) {
+        case Level::DEBUG: return "Debug";
+        case Level::WARNING: return "Warning";
+        case Level::ERROR: return "Error";
+        }
+        return "Unknown";
+    }
+
+    template<typename ... Args>
+    void log_format(Level level, const std::string_view category, const char* format, Args&& ... args) {
+#ifdef __clang__
+#   pragma clang diagnostic push
+#   pragma clang diagnostic ignored "-Wformat-security"
+#endif
+        char buf[MAX_MESSAGE_SIZE];
+        const int size = std::snprintf(buf, sizeof(buf), format, args...);
+        if(size < 0) return;
+        Eng3D::Log::log(get_level_name(level), category, std::string_view(buf, std::min<size_t>(size, sizeof(buf) - 1)));
+#ifdef __clang__
+#   pragma clang diagnostic pop
+#endif
+    }
 
     static inline void debug(const std::string_view category, const std::string_view msg) {
-        if(debug_show)
+        if(Eng3D::Log::is_enabled(Level::DEBUG, category))
             Eng3D::Log::log("Debug", category, msg);
     }
 
     static inline void warning(const std::string_view category, const std::string_view msg) {
-        Eng3D::Log::log("Warning", category, msg);
+        if(Eng3D::Log::is_enabled(Level::WARNING, category))
+            Eng3D::Log::log("Warning", category, msg);
     }
 
     static inline void error(const std::string_view category, const std::string_view msg) {
         Eng3D::Log::log("Error", category, msg);
     }
+
+    /// @brief Formatted variants, the message is only formatted when it is going
+    /// to be shown. Repeated messages from the same call site are rate limited
+    template<typename ... Args>
+    requires (sizeof...(Args) > 0)
+    void debug(const std::string_view category, const char* format, Args&& ... args) {
+        if(Eng3D::Log::should_log(Level::DEBUG, category, format))
+            Eng3D::Log::log_format(Level::DEBUG, category, format, std::forward<Args>(args)...);
+    }
+
+    template<typename ... Args>
+    requires (sizeof...(Args) > 0)
+    void warning(const std::string_view category, const char* format, Args&& ... args) {
+        if(Eng3D::Log::should_log(Level::WARNING, category, format))
+            Eng3D::Log::log_format(Level::WARNING, category, format, std::forward<Args>(args)...);
+    }
+
+    template<typename ... Args>
+    requires (sizeof...(Args) > 0)
+    void error(const std::string_view category, const char* format, Args&& ... args) {
+        Eng3D::Log::log_format(Level::ERROR, category, format, std::forward<Args>(args)...);
+    }
 }
@@ -169,7 +169,8 @@ bool Eng3D::Networking::Packet::send() {
     if(!stream.send(&net_size, sizeof(net_size), pred))
         return false;
     
-    if(!stream.send(buffer.data(), n_data, pred))
+    const auto* payload = shared ? shared->data() : buffer.data();
+    if(!stream.send(payload, n_data, pred))
         return false;
 
     const uint16_t eof_marker = htons(0xFE0F);
@@ -191,6 +192,7 @@ bool Eng3D::Networking::Packet::recv() {
     if(!n_data)
         return false;
 
+    shared.reset();
     buffer.resize(n_data);
     if(!stream.recv(buffer.data(), buffer.size(), pred))
         return false;
@@ -204,6 +206,59 @@ bool Eng3D::Networking::Packet::recv() {
     return true;
 }
 
+//
+// Packet pool
+//
+Eng3D::Networking::PacketPool::State::~State() {
+    std::vector<uint8_t>* buffer;
+    while(this->free_list.try_pop(buffer))
+        delete buffer;
+}
+
+Eng3D::Networking::PacketPool::PacketPool()
+    : state{ std::make_shared<State>() }
+{
+
+}
+
+Eng3D::Networking::SharedPayload Eng3D::Networking::PacketPool::wrap(std::vector<uint8_t>* buffer) {
+    return Eng3D::Networking::SharedPayload(buffer, [weak_state = std::weak_ptr<State>(this->state)](const std::vector<uint8_t>* p) {
+        auto* pooled = const_cast<std::vector<uint8_t>*>(p);
+        auto slot = weak_state.lock();
+        // The pool may go slightly over max_free when many buffers are released at once
+        if(slot != nullptr && pooled->capacity() <= max_capacity && slot->n_free < max_free) {
+            pooled->clear();
+            slot->n_free++;
+            slot->free_list.push(pooled);
+            return;
+        }
+        delete pooled;
+    });
+}
+
+Eng3D::Networking::SharedPayload Eng3D::Networking::PacketPool::make(const void* data, size_t size) {
+    std::vector<uint8_t>* buffer = nullptr;
+    if(this->state->free_list.try_pop(buffer)) {
+        this->state->n_free--;
+        this->state->n_reused++;
+    } else {
+        buffer = new std::vector<uint8_t>();
+        this->state->n_allocated++;
+    }
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    buffer->assign(bytes, bytes + size);
+    return this->wrap(buffer);
+}
+
+Eng3D::Networking::SharedPayload Eng3D::Networking::PacketPool::adopt(std::vector<uint8_t>&& data) {
+    this->state->n_allocated++;
+    return this->wrap(new std::vector<uint8_t>(std::move(data)));
+}
+
+Eng3D::Networking::PacketPool::Stats Eng3D::Networking::PacketPool::get_stats() const {
+    return Stats{ this->state->n_allocated.load(), this->state->n_reused.load(), this->state->n_free.load() };
+}
+
 //
 // Server client
 //
@@ -289,12 +344,32 @@ Eng3D::Networking::Server::~Server() {
 }
 
 /// @brief This will broadcast the given packet to all clients currently on the server
+/// the payload is copied once onto a shared buffer, and each client queue only gets a handle
 void Eng3D::Networking::Server::broadcast(const Eng3D::Networking::Packet& packet) {
+    const auto shared_packet = packet.with_shared(packet.shared ? packet.shared : packet_pool.make(packet.buffer.data(), packet.size()));
+    for(size_t i = 0; i < n_clients; i++)
+        if(clients[i].is_connected == true)
+            clients[i].packets.push(shared_packet);
+}
+
+/// @brief Same as above but takes the payload of the packet without copying it
+void Eng3D::Networking::Server::broadcast(Eng3D::Networking::Packet&& packet) {
+    this->share(packet);
     for(size_t i = 0; i < n_clients; i++)
         if(clients[i].is_connected == true)
             clients[i].packets.push(packet);
 }
 
+/// @brief Moves the payload of the packet onto a shared buffer, so it can be pushed
+/// onto the queues of many clients without copying it
+void Eng3D::Networking::Server::share(Eng3D::Networking::Packet& packet) {
+    if(!packet.shared) {
+        packet.buffer.resize(packet.size());
+        packet.set_shared(packet_pool.adopt(std::move(packet.buffer)));
+    }
+    packet.pred = nullptr;
+}
+
 void Eng3D::Networking::Server::do_netloop(std::function<void(int i)> on_wake_thread, int id) {
     auto& cl = clients[id];
     int conn_fd = 0;
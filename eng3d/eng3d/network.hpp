@@ -32,6 +32,7 @@
 #include <thread>
 #include <mutex>
 #include <deque>
+#include <memory>
 #include <stdexcept>
 #include <functional>
 #include <tbb/concurrent_queue.h>
@@ -96,6 +97,41 @@ namespace Eng3D::Networking {
         PACKET_ERROR,
     };
 
+    /// @brief Immutable payload shared by every packet of a broadcast
+    using SharedPayload = std::shared_ptr<const std::vector<uint8_t>>;
+
+    /// @brief Recycles the memory of shared payloads, once the last packet referencing
+    /// a payload is sent its buffer goes back to the pool. Buffers released after the
+    /// pool is destroyed are simply freed
+    class PacketPool {
+        struct State {
+            ~State();
+            tbb::concurrent_queue<std::vector<uint8_t>*> free_list;
+            std::atomic<size_t> n_free = 0;
+            std::atomic<size_t> n_allocated = 0;
+            std::atomic<size_t> n_reused = 0;
+        };
+        std::shared_ptr<State> state;
+        SharedPayload wrap(std::vector<uint8_t>* buffer);
+    public:
+        constexpr static size_t max_free = 64;
+        constexpr static size_t max_capacity = 1024 * 1024; // Bigger buffers aren't kept around
+
+        struct Stats {
+            size_t allocated; // Buffers allocated from the heap
+            size_t reused; // Buffers taken from the pool
+            size_t free; // Buffers waiting in the pool
+        };
+
+        PacketPool();
+        ~PacketPool() = default;
+        /// @brief Copy the data onto a pooled buffer
+        SharedPayload make(const void* data, size_t size);
+        /// @brief Take ownership of the buffer without copying it
+        SharedPayload adopt(std::vector<uint8_t>&& buffer);
+        Stats get_stats() const;
+    };
+
     class Packet {
         size_t n_data = 0;
         PacketCode code = PacketCode::OK;
@@ -114,6 +150,22 @@ namespace Eng3D::Networking {
             return static_cast<void*>(&buffer[0]);
         }
 
+        /// @brief Send a shared payload instead of the own buffer, copying the packet
+        /// afterwards only copies the handle
+        void set_shared(SharedPayload payload) noexcept {
+            n_data = payload->size();
+            buffer.clear();
+            shared = std::move(payload);
+        }
+
+        /// @brief Same packet sending a shared payload, without copying the own buffer
+        Packet with_shared(SharedPayload payload) const {
+            Packet packet{};
+            packet.code = this->code;
+            packet.set_shared(std::move(payload));
+            return packet;
+        }
+
         template<typename T>
         void data(const T* buf = nullptr, size_t size = sizeof(T)) noexcept {
             n_data = size;
@@ -134,6 +186,7 @@ namespace Eng3D::Networking {
         bool recv();
 
         std::vector<uint8_t> buffer;
+        SharedPayload shared;
         SocketStream stream;
         std::function<bool()> pred;
     };
@@ -176,6 +229,8 @@ namespace Eng3D::Networking {
         Server(unsigned port, unsigned max_conn);
         virtual ~Server();
         void broadcast(const Eng3D::Networking::Packet& packet);
+        void broadcast(Eng3D::Networking::Packet&& packet);
+        void share(Eng3D::Networking::Packet& packet);
         void do_netloop(std::function<void(int i)> on_wake_thread, int id);
 
         virtual void on_connect(int conn_fd, int id) = 0;
@@ -185,6 +240,7 @@ namespace Eng3D::Networking {
         ServerClient* clients;
         std::size_t n_clients;
         std::size_t player_count = 0;
+        PacketPool packet_pool;
     };
 
     class Client {
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <glm/glm.hpp>
 #include "eng3d/profiler.hpp"
+#include "eng3d/heap_ext.hpp"
 #include "eng3d/log.hpp"
 
 using namespace Eng3D;
@@ -35,18 +36,31 @@ static const float MS_TO_KEEP_DATA = 10 * 1e3;
 
 void Eng3D::BenchmarkTask::start() {
     start_time = std::chrono::system_clock::now();
+    start_allocations = Eng3D::Heap::get_stats().allocations;
     running = true;
 }
 
 void Eng3D::BenchmarkTask::stop() {
     assert(running && "Can't stop task which hasn't started yet");
     running = false;
+    last_allocations = Eng3D::Heap::get_stats().allocations - start_allocations;
     auto now = std::chrono::system_clock::now();
-    float time = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
+    float time = std::chrono::duration<float, std::milli>(now - start_time).count();
     times.push_back(time);
+    total_time_ms += time;
+    total_samples++;
+    total_allocations += last_allocations;
     start_times.push_back(start_time);
 }
 
+/// @brief Adds a sample measured elsewhere (for example, time waited on a lock)
+void Eng3D::BenchmarkTask::add_time(float time_ms) {
+    times.push_back(time_ms);
+    start_times.push_back(std::chrono::system_clock::now());
+    total_time_ms += time_ms;
+    total_samples++;
+}
+
 float Eng3D::BenchmarkTask::get_average_time_ms() {
     this->clear_old();
     float total_time = 0;
@@ -96,6 +110,13 @@ void Eng3D::Profiler::stop(const std::string_view name) {
     it->second.stop();
 }
 
+void Eng3D::Profiler::record(const std::string_view name, float time_ms) {
+    auto it = tasks.find(std::string{ name });
+    if(it == tasks.end())
+        it = tasks.insert({ std::string{ name }, Eng3D::BenchmarkTask(name, tasks.size()) }).first;
+    it->second.add_time(time_ms);
+}
+
 void Eng3D::Profiler::tick_done() {
 
 }
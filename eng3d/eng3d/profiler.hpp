@@ -47,15 +47,24 @@ namespace Eng3D {
         BenchmarkTask& operator=(const BenchmarkTask& lhs) = delete;
         void start();
         void stop();
+        void add_time(float time_ms);
         float get_average_time_ms();
         float get_largest_time_ms();
 
         const std::string name;
         const uint32_t color;
+        /// @brief Heap allocations done while the task last ran (see Eng3D::Heap)
+        size_t last_allocations = 0;
+        /// @brief Running totals since the task was created, unlike the 10 seconds
+        /// window used for the averages these are never trimmed
+        double total_time_ms = 0.f;
+        size_t total_samples = 0;
+        size_t total_allocations = 0;
     private:
         std::list<float> times;
         std::list<std::chrono::system_clock::time_point> start_times;
         std::chrono::system_clock::time_point start_time;
+        size_t start_allocations = 0;
         bool running;
     };
 
@@ -66,6 +75,7 @@ namespace Eng3D {
         ~Profiler() = default;
         void start(const std::string_view name);
         void stop(const std::string_view name);
+        void record(const std::string_view name, float time_ms);
         void tick_done();
         void render_done();
         float get_fps();
@@ -0,0 +1,85 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      ranking.hpp
+//
+// Abstract:
+//      Keys ordered by a score that is refreshed every update, the order is
+//      kept between updates and only fixed where it changed.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Eng3D {
+    /// @brief Keys ordered by descending score. Scores barely change from an update
+    /// to the next, so the previous order is fixed with an insertion sort, which is
+    /// linear when nothing moved, instead of sorting from scratch. Nothing is
+    /// allocated once it has been sized, and ties keep their previous order
+    template<typename K, typename S = float>
+    class Ranking {
+    public:
+        using value_type = std::pair<K, S>;
+
+        Ranking() = default;
+        ~Ranking() = default;
+
+        /// @brief Refresh the scores of the keys 0 to size - 1 and restore the order,
+        /// the order starts over when the number of keys changes
+        /// @return Number of moves made to restore the order
+        template<typename F>
+        size_t update(size_t size, F&& get_score) {
+            if(this->entries.size() != size) {
+                this->entries.resize(size);
+                for(size_t i = 0; i < size; i++)
+                    this->entries[i].first = K(i);
+            }
+            for(auto& [key, score] : this->entries)
+                score = get_score(key);
+
+            size_t moves = 0;
+            for(size_t i = 1; i < this->entries.size(); i++) {
+                if(!(this->entries[i - 1].second < this->entries[i].second)) continue;
+                auto entry = this->entries[i];
+                size_t j = i;
+                for(; j > 0 && this->entries[j - 1].second < entry.second; j--)
+                    this->entries[j] = this->entries[j - 1];
+                this->entries[j] = entry;
+                moves += i - j;
+            }
+            return moves;
+        }
+
+        typename std::vector<value_type>::const_iterator begin() const {
+            return this->entries.begin();
+        }
+
+        typename std::vector<value_type>::const_iterator end() const {
+            return this->entries.end();
+        }
+
+        size_t size() const {
+            return this->entries.size();
+        }
+    private:
+        std::vector<value_type> entries;
+    };
+}
@@ -0,0 +1,139 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      rle_grid.hpp
+//
+// Abstract:
+//      2D grid stored as run-length encoded rows.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#include "eng3d/serializer.hpp"
+
+namespace Eng3D {
+    /// @brief 2D grid whose rows are stored as runs of equal values, suited for maps
+    /// where most rows are long stretches of the same value (i.e province maps).
+    /// Point lookups binary search the runs of a row - O(log runs), while scans
+    /// should iterate over the runs directly with for_each_run
+    template<typename T>
+    class RLEGrid {
+    public:
+        RLEGrid() = default;
+        ~RLEGrid() = default;
+
+        /// @brief Encode a raw row-major array
+        /// @param data Pointer to the width * height elements
+        RLEGrid(const T* data, size_t _width, size_t _height)
+            : width{ _width },
+            height{ _height }
+        {
+            row_offsets.reserve(height + 1);
+            for(size_t j = 0; j < height; j++) {
+                row_offsets.push_back(run_starts.size());
+                const T* row = &data[j * width];
+                for(size_t i = 0; i < width; i++) {
+                    if(i == 0 || row[i] != row[i - 1]) {
+                        run_starts.push_back(i);
+                        run_values.push_back(row[i]);
+                    }
+                }
+            }
+            row_offsets.push_back(run_starts.size());
+        }
+
+        /// @brief Obtain the value at the given position
+        T get(size_t x, size_t y) const noexcept {
+            assert(x < width && y < height);
+            const auto first = run_starts.begin() + row_offsets[y];
+            const auto last = run_starts.begin() + row_offsets[y + 1];
+            // Last run which starts at or before x
+            const auto it = std::upper_bound(first, last, static_cast<uint32_t>(x)) - 1;
+            return run_values[std::distance(run_starts.begin(), it)];
+        }
+
+        T operator[](size_t idx) const noexcept {
+            return this->get(idx % width, idx / width);
+        }
+
+        /// @brief Calls fn(x_start, x_end, value) for every run on the row, x_end is exclusive
+        template<typename F>
+        void for_each_run(size_t y, F&& fn) const {
+            const size_t first = row_offsets[y], last = row_offsets[y + 1];
+            for(size_t k = first; k < last; k++) {
+                const size_t x_end = k + 1 < last ? run_starts[k + 1] : width;
+                fn(static_cast<size_t>(run_starts[k]), x_end, run_values[k]);
+            }
+        }
+
+        /// @brief Decodes a row onto a raw buffer of width elements
+        void decode_row(size_t y, T* out) const {
+            this->for_each_run(y, [out](size_t x_start, size_t x_end, const T& value) {
+                std::fill(out + x_start, out + x_end, value);
+            });
+        }
+
+        size_t run_count() const noexcept {
+            return run_starts.size();
+        }
+
+        /// @brief Memory used by the encoded data, in bytes
+        size_t memory_usage() const noexcept {
+            return run_starts.capacity() * sizeof(uint32_t) + run_values.capacity() * sizeof(T) + row_offsets.capacity() * sizeof(uint32_t);
+        }
+
+        bool empty() const noexcept {
+            return run_starts.empty();
+        }
+
+        void clear() noexcept {
+            width = height = 0;
+            run_starts = decltype(run_starts)();
+            run_values = decltype(run_values)();
+            row_offsets = decltype(row_offsets)();
+        }
+
+        size_t width = 0, height = 0;
+        std::vector<uint32_t> run_starts; // X where each run starts
+        std::vector<T> run_values; // Value of each run
+        std::vector<uint32_t> row_offsets; // First run of each row, plus one past the last run
+    };
+
+    namespace Deser {
+        template<typename T>
+        struct Serializer<Eng3D::RLEGrid<T>> {
+            template<bool is_const>
+            using type = typename CondConstType<is_const, Eng3D::RLEGrid<T>>::type;
+
+            template<bool is_serialize>
+            static inline void deser_dynamic(Eng3D::Deser::Archive& ar, type<is_serialize>& obj) {
+                Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.width);
+                Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.height);
+                Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.run_starts);
+                Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.run_values);
+                Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.row_offsets);
+            }
+        };
+    }
+}
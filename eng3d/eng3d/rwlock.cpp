@@ -0,0 +1,81 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      rwlock.cpp
+//
+// Abstract:
+//      Reader/writer lock which keeps track of the time spent waiting on it.
+// ----------------------------------------------------------------------------
+
+#include <chrono>
+#include "eng3d/rwlock.hpp"
+
+/// @brief Measure the time spent blocking on fn, in nanoseconds
+template<typename F>
+static inline uint64_t timed_wait(F&& fn) {
+    const auto start_time = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void Eng3D::RWLock::lock() {
+    // Uncontended acquisitions don't pay for the clock
+    if(!this->mutex.try_lock()) {
+        this->exclusive_wait_ns += timed_wait([this]() { this->mutex.lock(); });
+        this->contended_count++;
+    }
+    this->exclusive_count++;
+}
+
+bool Eng3D::RWLock::try_lock() {
+    if(!this->mutex.try_lock()) return false;
+    this->exclusive_count++;
+    return true;
+}
+
+void Eng3D::RWLock::unlock() {
+    this->mutex.unlock();
+}
+
+void Eng3D::RWLock::lock_shared() {
+    if(!this->mutex.try_lock_shared()) {
+        this->shared_wait_ns += timed_wait([this]() { this->mutex.lock_shared(); });
+        this->contended_count++;
+    }
+    this->shared_count++;
+}
+
+bool Eng3D::RWLock::try_lock_shared() {
+    if(!this->mutex.try_lock_shared()) return false;
+    this->shared_count++;
+    return true;
+}
+
+void Eng3D::RWLock::unlock_shared() {
+    this->mutex.unlock_shared();
+}
+
+Eng3D::RWLock::Stats Eng3D::RWLock::take_stats() noexcept {
+    Eng3D::RWLock::Stats stats{};
+    stats.exclusive_wait_ms = static_cast<float>(this->exclusive_wait_ns.exchange(0)) / 1e6f;
+    stats.shared_wait_ms = static_cast<float>(this->shared_wait_ns.exchange(0)) / 1e6f;
+    stats.exclusive_count = this->exclusive_count.exchange(0);
+    stats.shared_count = this->shared_count.exchange(0);
+    stats.contended_count = this->contended_count.exchange(0);
+    return stats;
+}
@@ -0,0 +1,71 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      rwlock.hpp
+//
+// Abstract:
+//      Reader/writer lock which keeps track of the time spent waiting on it.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <shared_mutex>
+
+namespace Eng3D {
+    /// @brief Reader/writer lock, readers (UI, rendering, serialization) may hold
+    /// it concurrently while writers (the world tick, mutating packets) hold it
+    /// exclusively. Satisfies both Lockable and SharedLockable so it can be used
+    /// with std::scoped_lock and std::shared_lock. The time spent waiting to
+    /// acquire the lock is accumulated until take_stats is called
+    class RWLock {
+    public:
+        struct Stats {
+            float exclusive_wait_ms = 0.f; // Time spent by writers waiting for the lock
+            float shared_wait_ms = 0.f; // Time spent by readers waiting for the lock
+            size_t exclusive_count = 0; // Number of times the lock was acquired by writers
+            size_t shared_count = 0; // Number of times the lock was acquired by readers
+            size_t contended_count = 0; // Number of acquisitions that had to wait
+        };
+
+        RWLock() = default;
+        RWLock(const RWLock&) = delete;
+        RWLock& operator=(const RWLock&) = delete;
+        ~RWLock() = default;
+
+        void lock();
+        bool try_lock();
+        void unlock();
+        void lock_shared();
+        bool try_lock_shared();
+        void unlock_shared();
+
+        /// @brief Obtain the statistics accumulated since the last call and reset them
+        /// @return Stats Accumulated statistics
+        Stats take_stats() noexcept;
+    private:
+        std::shared_mutex mutex;
+        std::atomic<uint64_t> exclusive_wait_ns = 0;
+        std::atomic<uint64_t> shared_wait_ns = 0;
+        std::atomic<size_t> exclusive_count = 0;
+        std::atomic<size_t> shared_count = 0;
+        std::atomic<size_t> contended_count = 0;
+    };
+}
@@ -37,6 +37,8 @@
 #include <bitset>
 #include <limits>
 #include <concepts>
+#include <bit>
+#include <iterator>
 #include <glm/glm.hpp>
 #include "eng3d/utils.hpp"
 #include "eng3d/string.hpp"
@@ -196,6 +198,35 @@ namespace Eng3D::Deser {
         }
     };
 
+    /// @brief Elements whose serialized form is their in-memory bytes, so a contiguous
+    /// range of them can be copied in one go. Integers are stored as little endian
+    template<typename T>
+    concept SerializerBulk = ::std::is_trivially_copyable_v<T>
+        && (::std::is_base_of_v<SerializerMemcpy<T>, Serializer<T>>
+        || (::std::is_integral_v<T> && !::std::is_same_v<T, bool>));
+
+    /// @brief Copies a contiguous range of bulk elements with a single memcpy
+    template<SerializerBulk T>
+    struct SerializerBulkRange {
+        template<bool is_serialize>
+        static inline void deser_range(Eng3D::Deser::Archive& ar, typename CondConstType<is_serialize, T>::type* data, size_t len) {
+            constexpr bool needs_swap = ::std::is_integral_v<T> && sizeof(T) > 1 && ::std::endian::native == ::std::endian::big;
+            const auto start = ar.ptr;
+            if constexpr(is_serialize) ar.copy_from(data, len * sizeof(T));
+            else ar.copy_to(data, len * sizeof(T));
+            if constexpr(needs_swap) {
+                // Swap the copy on the stream, the source may be const
+                auto* p = is_serialize ? reinterpret_cast<T*>(&ar.buffer[start]) : const_cast<T*>(data);
+                for(size_t i = 0; i < len; i++) {
+                    T tmp;
+                    ::std::memcpy(&tmp, &p[i], sizeof(T));
+                    tmp = ::std::byteswap<T>(tmp);
+                    ::std::memcpy(&p[i], &tmp, sizeof(T));
+                }
+            }
+        }
+    };
+
     template<typename T>
     concept SerializerContainer = requires(T a, T b) {
 #if defined(__GNUC__) && !defined(__clang__) && !defined(__llvm__)
@@ -223,16 +254,30 @@ namespace Eng3D::Deser {
             if(len >= max_elements)
                 CXX_THROW(Eng3D::Deser::Exception, "Exceeded max element count");
 
-            if constexpr(is_serialize) {
+            // No insert means this is a static array of some sort, ::std::array perhaps?
+            constexpr bool has_insert = requires(T a, typename T::value_type tp) { a.insert(tp); };
+            constexpr bool has_resize = requires(T a, size_t n) { a.resize(n); };
+            // Contiguous ranges of plain elements are copied at once instead of per element
+            constexpr bool is_bulk = SerializerBulk<typename T::value_type>
+                && ::std::contiguous_iterator<typename T::iterator>
+                && requires(T a) { a.data(); };
+            if constexpr(is_bulk) {
+                using value_type = typename T::value_type;
+                if constexpr(!is_serialize) {
+                    if constexpr(has_resize) {
+                        obj_group.resize(len);
+                    } else if(len > obj_group.size()) {
+                        CXX_THROW(Eng3D::Deser::Exception, "Exceeded max element count");
+                    }
+                }
+                SerializerBulkRange<value_type>::template deser_range<is_serialize>(ar, obj_group.data(), len);
+            } else if constexpr(is_serialize) {
                 for(auto& obj : obj_group)
                     Eng3D::Deser::deser_dynamic<true>(ar, obj);
             } else {
                 if constexpr(requires(T a) { a.clear(); })
                     obj_group.clear();
                 
-                // No insert means this is a static array of some sort, ::std::array perhaps?
-                constexpr bool has_insert = requires(T a, typename T::value_type tp) { a.insert(tp); };
-                constexpr bool has_resize = requires(T a, size_t n) { a.resize(n); };
                 if constexpr(!has_insert && !has_resize) {
                     for(decltype(len) i = 0; i < len; i++)
                         Eng3D::Deser::deser_dynamic<false>(ar, obj_group[i]);
@@ -319,6 +364,34 @@ namespace Eng3D::Deser {
         }
     };
 
+    /// @brief The whole string pool, strings are stored in order of their ids so
+    /// refs serialized alongside keep pointing to the same text
+    template<>
+    struct Serializer<Eng3D::StringManager> {
+        template<bool is_const>
+        using type = typename CondConstType<is_const, Eng3D::StringManager>::type;
+
+        template<bool is_serialize>
+        static inline void deser_dynamic(Eng3D::Deser::Archive& ar, type<is_serialize>& obj) {
+            uint32_t len = obj.size();
+            Eng3D::Deser::deser_dynamic<is_serialize>(ar, len);
+            if constexpr(is_serialize) {
+                for(uint32_t i = 0; i < len; i++) {
+                    std::string str(obj.get_by_id(Eng3D::StringRef(i)));
+                    Eng3D::Deser::deser_dynamic<true>(ar, str);
+                }
+            } else {
+                obj.clear();
+                for(uint32_t i = 0; i < len; i++) {
+                    std::string str;
+                    Eng3D::Deser::deser_dynamic<false>(ar, str);
+                    if(obj.insert(str).get_id() != i)
+                        CXX_THROW(Eng3D::Deser::Exception, "String pool has duplicated entries");
+                }
+            }
+        }
+    };
+
     template<>
     struct Serializer<Eng3D::Rectangle> {
         template<bool is_const>
@@ -0,0 +1,155 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      small_map.hpp
+//
+// Abstract:
+//      Sorted map for a handful of entries, stored inline until it outgrows it.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace Eng3D {
+    /// @brief Map sorted by key meant for maps that are nearly always empty or
+    /// tiny, the first N entries are stored inline and only bigger maps allocate.
+    /// Entries are contiguous, so iterating is as cheap as iterating an array
+    template<typename K, typename V, size_t N = 2>
+    class SmallMap {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using iterator = value_type*;
+        using const_iterator = const value_type*;
+
+        SmallMap() = default;
+        ~SmallMap() = default;
+        SmallMap(const SmallMap&) = default;
+        SmallMap(SmallMap&&) noexcept = default;
+        SmallMap& operator=(const SmallMap&) = default;
+        SmallMap& operator=(SmallMap&&) noexcept = default;
+
+        iterator begin() { return this->data(); }
+        iterator end() { return this->data() + this->size(); }
+        const_iterator begin() const { return this->data(); }
+        const_iterator end() const { return this->data() + this->size(); }
+
+        size_t size() const {
+            return this->is_heap() ? this->heap_data.size() : this->n_inline;
+        }
+
+        bool empty() const {
+            return this->size() == 0;
+        }
+
+        /// @brief Whether the entries have been moved onto the heap
+        bool is_heap() const {
+            return !this->heap_data.empty();
+        }
+
+        iterator find(const K& key) {
+            auto it = this->lower_bound(key);
+            return it != this->end() && it->first == key ? it : this->end();
+        }
+
+        const_iterator find(const K& key) const {
+            return const_cast<SmallMap*>(this)->find(key);
+        }
+
+        bool contains(const K& key) const {
+            return this->find(key) != this->end();
+        }
+
+        /// @brief Obtains the value of a key, inserting a default one if it isn't there
+        V& operator[](const K& key) {
+            auto it = this->lower_bound(key);
+            if(it != this->end() && it->first == key)
+                return it->second;
+            return this->insert_at(it - this->begin(), value_type(key, V{}))->second;
+        }
+
+        /// @brief Inserts an entry if its key isn't already there
+        std::pair<iterator, bool> insert(const value_type& value) {
+            auto it = this->lower_bound(value.first);
+            if(it != this->end() && it->first == value.first)
+                return std::make_pair(it, false);
+            return std::make_pair(this->insert_at(it - this->begin(), value), true);
+        }
+
+        void erase(const K& key) {
+            auto it = this->find(key);
+            if(it == this->end()) return;
+            if(this->is_heap()) {
+                this->heap_data.erase(this->heap_data.begin() + (it - this->begin()));
+            } else {
+                std::move(it + 1, this->end(), it);
+                this->n_inline--;
+            }
+        }
+
+        void clear() {
+            this->heap_data.clear();
+            this->n_inline = 0;
+        }
+
+        bool operator==(const SmallMap& o) const {
+            return std::equal(this->begin(), this->end(), o.begin(), o.end());
+        }
+    private:
+        value_type* data() {
+            return this->is_heap() ? this->heap_data.data() : this->inline_data.data();
+        }
+
+        const value_type* data() const {
+            return this->is_heap() ? this->heap_data.data() : this->inline_data.data();
+        }
+
+        iterator lower_bound(const K& key) {
+            return std::lower_bound(this->begin(), this->end(), key, [](const auto& e, const K& k) {
+                return e.first < k;
+            });
+        }
+
+        iterator insert_at(size_t index, const value_type& value) {
+            if(!this->is_heap() && this->n_inline < N) {
+                std::move_backward(this->inline_data.begin() + index, this->inline_data.begin() + this->n_inline, this->inline_data.begin() + this->n_inline + 1);
+                this->inline_data[index] = value;
+                this->n_inline++;
+                return this->begin() + index;
+            }
+
+            if(!this->is_heap()) { // Outgrew the inline storage
+                this->heap_data.reserve(N * 2);
+                this->heap_data.assign(this->inline_data.begin(), this->inline_data.begin() + this->n_inline);
+                this->n_inline = 0;
+            }
+            return &*this->heap_data.insert(this->heap_data.begin() + index, value);
+        }
+
+        std::array<value_type, N> inline_data{};
+        std::vector<value_type> heap_data;
+        uint32_t n_inline = 0;
+    };
+}
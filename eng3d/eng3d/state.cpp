@@ -193,10 +193,10 @@ Eng3D::Installer::Installer(Eng3D::State& _s)
 
     // Set global locale to the user preferred
     std::locale::global(std::locale(""));
-    Eng3D::Log::debug("engine", Eng3D::translate_format("User's locale is %s", std::locale("").name().data()));
+    Eng3D::Log::debug("engine", "User's locale is %s", std::locale("").name().data());
 
     const int seed = (int)((uint32_t)time(NULL) * (uint32_t)getpid());
-    Eng3D::Log::debug("engine", Eng3D::translate_format("Using random seed of %i", seed));
+    Eng3D::Log::debug("engine", "Using random seed of %i", seed);
     std::srand(seed);
 
 #if defined E3D_BACKEND_OPENGL || defined E3D_BACKEND_GLES
@@ -226,7 +226,7 @@ Eng3D::Installer::Installer(Eng3D::State& _s)
     // Create the initial window
     s.width = 1280;
     s.height = 720;
-    Eng3D::Log::debug("sdl2", Eng3D::translate_format("New window %u x %u", s.width, s.height));
+    Eng3D::Log::debug("sdl2", "New window %u x %u", s.width, s.height);
     
     s.window = SDL_CreateWindow(canonical_name.data(), SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, s.width, s.height, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
     if(s.window == nullptr)
@@ -238,7 +238,7 @@ Eng3D::Installer::Installer(Eng3D::State& _s)
         CXX_THROW(std::runtime_error, Eng3D::translate_format("Failed to initialize SDL context %s", SDL_GetError()));
     SDL_GL_SetSwapInterval(1);
 
-    Eng3D::Log::debug("opengl", Eng3D::translate_format("OpenGL Version: %s", (const char*)glGetString(GL_VERSION)));
+    Eng3D::Log::debug("opengl", "OpenGL Version: %s", (const char*)glGetString(GL_VERSION));
 #   ifdef E3D_BACKEND_OPENGL
     glewExperimental = GL_TRUE;
     const auto r = glewInit();
@@ -248,7 +248,7 @@ Eng3D::Installer::Installer(Eng3D::State& _s)
 
     GLint size;
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
-    Eng3D::Log::debug("gamestate", Eng3D::translate_format("Maximum texture size: %zu", size));
+    Eng3D::Log::debug("gamestate", "Maximum texture size: %zu", size);
     assert(size > 0 && size < std::numeric_limits<size_t>::max());
     s.max_texture_size = size;
 
@@ -327,20 +327,20 @@ Eng3D::State::State(const std::vector<std::string>& pkg_paths)
         HINSTANCE hGetProcIDDLL = LoadLibrary(plugin.data());
         // This shouldn't happen - like ever!
         if(!hGetProcIDDLL) {
-            Eng3D::Log::error("plugin", Eng3D::translate_format("DLL file %s not found", plugin.data()));
+            Eng3D::Log::error("plugin", "DLL file %s not found", plugin.data());
             continue;
         }
 
         typedef int(__stdcall* plugin_dll_entry_t)(const char* gameid, int gamever);
         plugin_dll_entry_t entry = (plugin_dll_entry_t)GetProcAddress(hGetProcIDDLL, "__unirend_entry");
         if(!entry) {
-            Eng3D::Log::warning("plugin", Eng3D::translate_format("Can't find __unirend_entry on %s", plugin.data()));
+            Eng3D::Log::warning("plugin", "Can't find __unirend_entry on %s", plugin.data());
             continue;
         }
 
         int r = entry("SYMPHONY_EMPIRES", 0x00F0);
         if(r != 0) {
-            Eng3D::Log::warning("plugin", Eng3D::translate_format("Error %i on plugin %s", i, plugin.data()));
+            Eng3D::Log::warning("plugin", "Error %i on plugin %s", i, plugin.data());
         }
 #endif
     }
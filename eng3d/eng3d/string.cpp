@@ -23,16 +23,23 @@
 // ----------------------------------------------------------------------------
 
 #include <unordered_map>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <bit>
+#include <cmath>
 #include <cstring>
 #include <mutex>
 #include <memory>
 #include "eng3d/string.hpp"
 
+static void clear_translation_cache();
+
 //
 // StringRef
 //
 Eng3D::StringRef::StringRef(const std::string_view str) {
-    *this = Eng3D::StringManager::get_instance().insert(std::string{str});
+    *this = Eng3D::StringManager::get_instance().insert(str);
 }
 
 const std::string_view Eng3D::StringRef::get_string() const {
@@ -45,40 +52,263 @@ const std::string_view Eng3D::StringRef::get_string() const {
 //
 static Eng3D::StringManager *g_string_man = nullptr;
 Eng3D::StringManager::StringManager(Eng3D::State& _s)
-    : s{ _s }
+    : StringManager()
+{
+    this->s = &_s;
+}
+
+Eng3D::StringManager::StringManager()
+    : blocks{ std::make_unique<std::atomic<Entry*>[]>(MAX_BLOCKS) }
 {
+    this->clear();
     g_string_man = this;
 }
 
+Eng3D::StringManager::~StringManager() {
+    for(size_t i = 0; i < MAX_BLOCKS; i++)
+        delete[] this->blocks[i].load();
+}
+
 Eng3D::StringManager& Eng3D::StringManager::get_instance() {
     return *g_string_man;
 }
 
-static std::unordered_map<std::string, std::string> trans_msg;
-static std::mutex trans_lock;
+/// @brief Copy the text (and a terminator) onto the chunks, the chunks are never
+/// reallocated so the returned pointer stays valid until clear
+const char* Eng3D::StringManager::store(const std::string_view str) {
+    const auto size = str.size() + 1;
+    if(size > CHUNK_SIZE) { // Big strings get a chunk of their own
+        this->chunks.insert(this->chunks.begin(), std::make_unique<char[]>(size));
+        this->stats.reserved_bytes += size;
+        auto* p = this->chunks.front().get();
+        std::copy(str.begin(), str.end(), p);
+        p[str.size()] = '\0';
+        return p;
+    }
+    if(this->chunk_offset + size > CHUNK_SIZE) {
+        this->chunks.push_back(std::make_unique<char[]>(CHUNK_SIZE));
+        this->stats.reserved_bytes += CHUNK_SIZE;
+        this->chunk_offset = 0;
+    }
+    auto* p = this->chunks.back().get() + this->chunk_offset;
+    std::copy(str.begin(), str.end(), p);
+    p[str.size()] = '\0';
+    this->chunk_offset += size;
+    return p;
+}
+
+Eng3D::StringRef Eng3D::StringManager::insert(const std::string_view str) {
+    const std::scoped_lock lock(this->insert_mutex);
+    this->stats.total_inserts++;
+    this->stats.total_bytes += str.size() + 1;
+    const auto it = this->lookup.find(str);
+    if(it != this->lookup.end())
+        return Eng3D::StringRef(it->second);
+
+    const auto id = this->count.load(std::memory_order_relaxed);
+    if(id >= ENTRIES_PER_BLOCK * MAX_BLOCKS)
+        CXX_THROW(std::runtime_error, "String pool is full");
+    auto& block = this->blocks[id / ENTRIES_PER_BLOCK];
+    if(block.load(std::memory_order_relaxed) == nullptr) {
+        block.store(new Entry[ENTRIES_PER_BLOCK], std::memory_order_release);
+        this->stats.reserved_bytes += ENTRIES_PER_BLOCK * sizeof(Entry);
+    }
+
+    const auto* data = this->store(str);
+    block.load(std::memory_order_relaxed)[id % ENTRIES_PER_BLOCK] = Entry{ data, str.size() };
+    this->lookup.emplace(std::string_view(data, str.size()), id);
+    this->stats.unique_strings++;
+    this->stats.unique_bytes += str.size() + 1;
+    // Publish the entry, readers never look past count
+    this->count.store(id + 1, std::memory_order_release);
+    return Eng3D::StringRef(id);
+}
+
+std::optional<Eng3D::StringRef> Eng3D::StringManager::find(const std::string_view str) const {
+    const std::scoped_lock lock(this->insert_mutex);
+    const auto it = this->lookup.find(str);
+    if(it == this->lookup.end())
+        return std::nullopt;
+    return Eng3D::StringRef(it->second);
+}
+
+void Eng3D::StringManager::clear() {
+    {
+        const std::scoped_lock lock(this->insert_mutex);
+        this->count.store(0, std::memory_order_release);
+        this->lookup.clear();
+        this->chunks.clear();
+        this->chunk_offset = CHUNK_SIZE;
+        for(size_t i = 0; i < MAX_BLOCKS; i++)
+            delete[] this->blocks[i].exchange(nullptr);
+        this->stats = Stats{};
+    }
+    // Ids are about to be reused for other strings
+    clear_translation_cache();
+    // The empty string is always the first, so default constructed refs are empty
+    this->insert("");
+}
+
+Eng3D::StringManager::Stats Eng3D::StringManager::get_stats() const {
+    const std::scoped_lock lock(this->insert_mutex);
+    auto stats_copy = this->stats;
+    stats_copy.reserved_bytes += MAX_BLOCKS * sizeof(std::atomic<Entry*>) + this->lookup.size() * (sizeof(std::string_view) + sizeof(size_t));
+    return stats_copy;
+}
+
+namespace {
+    /// @brief Immutable open addressed table of translations. It's built once per
+    /// locale load and never modified, so lookups need no locks
+    class TranslationTable {
+        struct Slot {
+            size_t hash = 0;
+            uint32_t index = 0; // Index of the message plus one, zero if empty
+        };
+        static constexpr size_t CACHE_BLOCK_SIZE = 4096;
+        static constexpr size_t CACHE_BLOCKS = 4096;
+        static constexpr uint32_t CACHE_UNKNOWN = 0;
+        static constexpr uint32_t CACHE_MISS = 1; // Other values are the index plus two
+
+        std::vector<std::pair<std::string, std::string>> messages;
+        std::vector<Slot> slots;
+        size_t mask = 0;
+        // Results by StringRef id, filled lazily by the readers
+        std::unique_ptr<std::atomic<std::atomic<uint32_t>*>[]> ref_cache;
+    public:
+        TranslationTable(std::vector<std::pair<std::string, std::string>> _messages)
+            : messages{ std::move(_messages) },
+            ref_cache{ std::make_unique<std::atomic<std::atomic<uint32_t>*>[]>(CACHE_BLOCKS) }
+        {
+            // At most half full, probe sequences stay short
+            this->slots.resize(std::bit_ceil(std::max<size_t>(this->messages.size() * 2, 16)));
+            this->mask = this->slots.size() - 1;
+            for(size_t i = 0; i < this->messages.size(); i++) {
+                const auto hash = std::hash<std::string_view>{}(this->messages[i].first);
+                auto pos = hash & this->mask;
+                while(this->slots[pos].index != 0)
+                    pos = (pos + 1) & this->mask;
+                this->slots[pos] = Slot{ hash, static_cast<uint32_t>(i + 1) };
+            }
+        }
+
+        ~TranslationTable() {
+            this->clear_cache();
+        }
+
+        void clear_cache() const {
+            for(size_t i = 0; i < CACHE_BLOCKS; i++)
+                delete[] this->ref_cache[i].exchange(nullptr);
+        }
+
+        const std::pair<std::string, std::string>* find(const std::string_view key) const {
+            const auto hash = std::hash<std::string_view>{}(key);
+            for(auto pos = hash & this->mask; this->slots[pos].index != 0; pos = (pos + 1) & this->mask) {
+                const auto& slot = this->slots[pos];
+                if(slot.hash == hash && this->messages[slot.index - 1].first == key)
+                    return &this->messages[slot.index - 1];
+            }
+            return nullptr;
+        }
+
+        std::string_view find(const Eng3D::StringRef ref) const {
+            const auto id = ref.get_id();
+            if(id >= CACHE_BLOCK_SIZE * CACHE_BLOCKS) {
+                const auto* msg = this->find(ref.get_string());
+                return msg != nullptr ? std::string_view(msg->second) : ref.get_string();
+            }
+
+            auto& block_ptr = this->ref_cache[id / CACHE_BLOCK_SIZE];
+            auto* block = block_ptr.load(std::memory_order_acquire);
+            if(block == nullptr) {
+                auto* new_block = new std::atomic<uint32_t>[CACHE_BLOCK_SIZE]();
+                if(block_ptr.compare_exchange_strong(block, new_block, std::memory_order_acq_rel)) {
+                    block = new_block;
+                } else {
+                    delete[] new_block; // Another thread won, block holds theirs
+                }
+            }
+
+            auto& entry = block[id % CACHE_BLOCK_SIZE];
+            auto value = entry.load(std::memory_order_relaxed);
+            if(value == CACHE_UNKNOWN) {
+                const auto* msg = this->find(ref.get_string());
+                value = msg != nullptr ? static_cast<uint32_t>(msg - this->messages.data()) + 2 : CACHE_MISS;
+                entry.store(value, std::memory_order_relaxed);
+            }
+            return value == CACHE_MISS ? ref.get_string() : std::string_view(this->messages[value - 2].second);
+        }
+
+        const std::vector<std::pair<std::string, std::string>>& get_messages() const {
+            return this->messages;
+        }
+    };
+
+    std::atomic<const TranslationTable*> g_trans_table = nullptr;
+    // Readers may still hold views onto old tables, so they're kept until exit
+    std::vector<std::unique_ptr<TranslationTable>> trans_tables;
+    std::mutex trans_load_lock;
+}
+
+static void clear_translation_cache() {
+    const std::scoped_lock lock(trans_load_lock);
+    for(const auto& table : trans_tables)
+        table->clear_cache();
+}
+
 void Eng3D::Locale::from_file(const std::string_view filename) {
     std::unique_ptr<FILE, decltype(&fclose)> fp(fopen(filename.data(), "rt"), fclose);
+    if(fp == nullptr)
+        CXX_THROW(std::runtime_error, Eng3D::string_format("Can't open locale file %s", filename.data()));
+
+    const std::scoped_lock lock(trans_load_lock);
+    std::unordered_map<std::string, std::string> trans_msg;
+    if(const auto* table = g_trans_table.load(std::memory_order_acquire); table != nullptr)
+        trans_msg.insert(table->get_messages().begin(), table->get_messages().end());
+
     char tmp[100];
     while(fgets(tmp, sizeof tmp, fp.get()) != nullptr) {
         if(!strncmp(tmp, "msgid", 5)) {
-            char msgid[100];
-            sscanf(tmp + 5, " %*c%[^\"]s%*c ", msgid);
-            fgets(tmp, sizeof tmp, fp.get());
+            char msgid[100] = { 0 };
+            sscanf(tmp + 5, " %*c%99[^\"]s%*c ", msgid);
+            if(fgets(tmp, sizeof tmp, fp.get()) == nullptr)
+                break;
             if(!strncmp(tmp, "msgstr", 6)) {
-                char msgstr[100];
-                sscanf(tmp + 6, " %*c%[^\"]s%*c ", msgstr);
+                char msgstr[100] = { 0 }; // Stays empty if untranslated
+                sscanf(tmp + 6, " %*c%99[^\"]s%*c ", msgstr);
                 trans_msg[msgid] = msgstr;
             }
         }
     }
+
+    std::vector<std::pair<std::string, std::string>> messages;
+    for(auto& [msgid, msgstr] : trans_msg)
+        if(!msgstr.empty()) // Empty translations mean untranslated
+            messages.emplace_back(msgid, std::move(msgstr));
+    trans_tables.push_back(std::make_unique<TranslationTable>(std::move(messages)));
+    g_trans_table.store(trans_tables.back().get(), std::memory_order_release);
+}
+
+std::string_view Eng3D::Locale::translate_view(const std::string_view str) {
+    const auto* table = g_trans_table.load(std::memory_order_acquire);
+    if(table == nullptr)
+        return str;
+    const auto* msg = table->find(str);
+    return msg != nullptr ? std::string_view(msg->second) : str;
+}
+
+std::string_view Eng3D::Locale::translate_view(const Eng3D::StringRef ref) {
+    const auto* table = g_trans_table.load(std::memory_order_acquire);
+    if(table == nullptr)
+        return ref.get_string();
+    return table->find(ref);
 }
 
 std::string Eng3D::Locale::translate(const std::string_view str) {
-    const std::scoped_lock lock(trans_lock);
-    const auto msg = trans_msg[str.data()];
-    if(msg.empty())
-        return std::string(str);
-    return msg;
+    return std::string(Eng3D::Locale::translate_view(str));
+}
+
+std::string Eng3D::Locale::translate(const Eng3D::StringRef ref) {
+    return std::string(Eng3D::Locale::translate_view(ref));
 }
 
 std::string Eng3D::Locale::format_number(double num) {
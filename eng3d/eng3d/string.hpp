@@ -27,15 +27,22 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <cassert>
+#include <atomic>
+#include <optional>
+#include <unordered_map>
 #include <mutex>
 #include <memory>
 #include <compare>
+#include <algorithm>
+#include <cstdio>
 #include <iterator>
 #include <stdexcept>
 #include "eng3d/utils.hpp"
 
 namespace Eng3D {
-    /// @brief A reference to a string on the global string pool
+    /// @brief A reference to a string on the global string pool, since strings
+    /// are interned two refs are equal iff their text is equal
     struct StringRef {
         constexpr StringRef() = default;
         StringRef(const std::string_view str);
@@ -67,28 +74,69 @@ namespace Eng3D {
     class State;
     /// @brief The string pool manager (singleton), used mainly for translation
     /// purpouses. But also helps to reduce the memory size of various objects.
+    /// Strings are interned, inserting the same text twice gives the same id so
+    /// StringRefs can be compared by their id alone. Text is kept on append-only
+    /// chunks so views never dangle, and reading by id takes no locks
     class StringManager {
-        Eng3D::State& s;
+        Eng3D::State* s = nullptr;
+
+        /// @brief Location of an interned string, always null terminated
+        struct Entry {
+            const char* data = nullptr;
+            size_t length = 0;
+        };
+        static constexpr size_t ENTRIES_PER_BLOCK = 4096;
+        static constexpr size_t MAX_BLOCKS = 4096;
+        static constexpr size_t CHUNK_SIZE = 64 * 1024;
     public:
+        /// @brief Memory report of the pool
+        struct Stats {
+            size_t unique_strings = 0;
+            size_t total_inserts = 0; // Including the ones deduplicated
+            size_t unique_bytes = 0; // Bytes of the text stored
+            size_t total_bytes = 0; // Bytes a non-interning pool would have stored
+            size_t reserved_bytes = 0; // Chunks and id tables
+        };
+
         StringManager(Eng3D::State& _s);
-        ~StringManager() = default;
-
-        Eng3D::StringRef insert(const std::string_view str) {
-            const std::scoped_lock lock(strings_mutex);
-            const auto id = strings.size();
-            std::copy(str.begin(), str.end(), std::back_inserter(strings));
-            strings.push_back('\0');
-            return Eng3D::StringRef(id);
-        }
+        /// @brief Standalone manager for tools that run without a state (i.e headless benchmarks)
+        StringManager();
+        ~StringManager();
+
+        /// @brief Intern a string, thread safe
+        Eng3D::StringRef insert(const std::string_view str);
+        /// @brief Obtain the ref of an already interned string, without inserting it
+        std::optional<Eng3D::StringRef> find(const std::string_view str) const;
 
+        /// @brief Obtain the text of a ref, lock-free. The ref must have been
+        /// handed out by this manager
         const std::string_view get_by_id(const Eng3D::StringRef ref) const {
-            const std::scoped_lock lock(strings_mutex);
-            return &strings[ref.get_id()];
+            const auto id = ref.get_id();
+            assert(id < this->count.load(std::memory_order_acquire));
+            const auto* block = this->blocks[id / ENTRIES_PER_BLOCK].load(std::memory_order_acquire);
+            const auto& entry = block[id % ENTRIES_PER_BLOCK];
+            return std::string_view(entry.data, entry.length);
         }
 
-        std::vector<char> strings;
+        /// @brief Number of unique strings (ids go from 0 to size - 1)
+        size_t size() const {
+            return this->count.load(std::memory_order_acquire);
+        }
+
+        /// @brief Drop every string, not safe while other threads read from the pool
+        void clear();
+        Stats get_stats() const;
         static StringManager& get_instance();
-        mutable std::mutex strings_mutex;
+    private:
+        const char* store(const std::string_view str);
+
+        std::unique_ptr<std::atomic<Entry*>[]> blocks;
+        std::atomic<size_t> count = 0;
+        std::vector<std::unique_ptr<char[]>> chunks;
+        size_t chunk_offset = CHUNK_SIZE;
+        std::unordered_map<std::string_view, size_t> lookup;
+        Stats stats;
+        mutable std::mutex insert_mutex;
     };
 
     /// @brief String formatter
@@ -102,13 +150,20 @@ namespace Eng3D {
 #   pragma clang diagnostic push
 #   pragma clang diagnostic ignored "-Wformat-security"
 #endif
-        int size_s = std::snprintf(nullptr, 0, format.data(), std::forward<decltype(args)>(args)...) + 1; // Extra space for '\0'
-        if(size_s <= 0)
+        // Format directly onto the string, only strings longer than the initial
+        // guess need a second pass
+        std::string str(std::max<size_t>(format.size() * 2, 64), '\0');
+        const int size_s = std::snprintf(str.data(), str.size() + 1, format.data(), args...);
+        if(size_s < 0)
             CXX_THROW(std::runtime_error, "Error during formatting");
-        size_t size = static_cast<size_t>(size_s);
-        std::unique_ptr<char[]> buf = std::make_unique<char[]>(size);
-        std::snprintf(buf.get(), size, format.data(), args ...);
-        return std::string(buf.get(), buf.get() + size - 1); // We don't want the '\0' inside
+        const auto size = static_cast<size_t>(size_s);
+        if(size > str.size()) {
+            str.resize(size);
+            std::snprintf(str.data(), size + 1, format.data(), args...);
+        } else {
+            str.resize(size);
+        }
+        return str;
 #ifdef __clang__
 #   pragma clang diagnostic pop
 #endif
@@ -117,8 +172,16 @@ namespace Eng3D {
 using Eng3D::string_format;
 
 namespace Eng3D::Locale {
+    /// @brief Load the translations of a .po file, they are merged with the ones
+    /// already loaded and published as a new immutable table
     void from_file(const std::string_view filename);
+    /// @brief Lock-free lookup of a translation, gives back str when there is none.
+    /// A translated view stays valid for the whole program
+    std::string_view translate_view(const std::string_view str);
+    /// @brief Same as above, but the result is cached by the id of the interned string
+    std::string_view translate_view(const Eng3D::StringRef ref);
     std::string translate(const std::string_view str);
+    std::string translate(const Eng3D::StringRef ref);
     std::string format_number(double num);
 }
 using Eng3D::Locale::translate;
@@ -131,7 +194,7 @@ namespace Eng3D {
     /// @return std::string The resulting formatted text
     template<typename ... Args>
     std::string translate_format(const std::string_view format, Args&& ... args) {
-        return Eng3D::string_format(Eng3D::Locale::translate(format), std::forward<decltype(args)>(args)...);
+        return Eng3D::string_format(Eng3D::Locale::translate_view(format), std::forward<decltype(args)>(args)...);
     }
 }
 using Eng3D::translate_format;
@@ -248,9 +248,9 @@ void Eng3D::Texture::_upload(TextureOptions options) {
         GLint result;
         glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &result);
         if(result == 0) {
-            Eng3D::Log::debug("opengl", Eng3D::translate_format("Couldn't compress texture of %u x %u", width, height));
+            Eng3D::Log::debug("opengl", "Couldn't compress texture of %u x %u", width, height);
         } else {
-            Eng3D::Log::debug("opengl", Eng3D::translate_format("Compressed texture of %u x %u", width, height));
+            Eng3D::Log::debug("opengl", "Compressed texture of %u x %u", width, height);
         }
 #endif
         // We will free up the texture if we don't plan on editing it since it's on the GPU now
@@ -445,7 +445,7 @@ std::shared_ptr<Eng3D::Texture> Eng3D::TextureManager::load(const std::string_vi
     auto it = textures.find(key);
     if(it != textures.end()) return (*it).second;
     
-    Eng3D::Log::debug("texture", Eng3D::string_format("Loaded and cached texture for %s", path.data()));
+    Eng3D::Log::debug("texture", "Loaded and cached texture for %s", path.data());
 
     // Otherwise texture is not in our control, so we create a new texture
     std::shared_ptr<Eng3D::Texture> tex;
@@ -473,11 +473,11 @@ std::shared_ptr<Eng3D::Texture> Eng3D::TextureManager::gen_text(Eng3D::TrueType:
     auto it = text_textures.find(key);
     if(it != text_textures.end()) return it->second;
 
-    Eng3D::Log::debug("texture", Eng3D::string_format("Loaded and cached text texture for %s", msg.data()));
+    Eng3D::Log::debug("texture", "Loaded and cached text texture for %s", msg.data());
 
     // Otherwise texture is not in our control, so we create a new texture
     auto tex = std::make_shared<Eng3D::Texture>();
-    Eng3D::Log::debug("ttf", Eng3D::string_format("Creating text for %s", msg.data()));
+    Eng3D::Log::debug("ttf", "Creating text for %s", msg.data());
     const SDL_Color sdl_color{
         static_cast<Uint8>(color.r * 255.f), static_cast<Uint8>(color.g * 255.f),
         static_cast<Uint8>(color.b * 255.f), 0 };
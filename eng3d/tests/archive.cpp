@@ -26,6 +26,9 @@
 #include <vector>
 #include <array>
 #include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cstring>
 
 #include "eng3d/state.hpp"
 #include "eng3d/string.hpp"
@@ -97,6 +100,130 @@ static int test_numerical_array() {
     return 0;
 }
 
+// An id copied as-is, takes the bulk path in containers
+struct BenchId {
+    uint32_t id;
+    bool operator==(const BenchId&) const = default;
+};
+template<>
+struct Eng3D::Deser::Serializer<BenchId> : Eng3D::Deser::SerializerMemcpy<BenchId> {};
+
+// Same layout and bytes, but serialized per element
+struct BenchSlowId {
+    uint32_t id;
+    bool operator==(const BenchSlowId&) const = default;
+};
+template<>
+struct Eng3D::Deser::Serializer<BenchSlowId> {
+    template<bool is_serialize>
+    static inline void deser_dynamic(Eng3D::Deser::Archive& ar, auto& obj) {
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.id);
+    }
+};
+
+// Resembles a province, a few scalars plus id lists
+template<typename Id>
+struct BenchProvince {
+    std::vector<Id> neighbour_ids;
+    std::vector<Id> unit_ids;
+    std::vector<uint32_t> stockpile;
+    uint32_t owner;
+    bool operator==(const BenchProvince&) const = default;
+};
+template<typename Id>
+struct Eng3D::Deser::Serializer<BenchProvince<Id>> {
+    template<bool is_serialize>
+    static inline void deser_dynamic(Eng3D::Deser::Archive& ar, auto& obj) {
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.neighbour_ids);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.unit_ids);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.stockpile);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.owner);
+    }
+};
+
+/// @brief Round trips obj a few times, returns the throughput in MB/s (or a negative
+/// value if the round trip doesn't match) and the serialized bytes on buffer
+template<typename T>
+static double bench_round_trip(const T& obj, std::vector<uint8_t>& buffer, int rounds = 8) {
+    double seconds = 0.f;
+    size_t bytes = 0;
+    for(int i = 0; i < rounds; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        Eng3D::Deser::Archive ar;
+        Eng3D::Deser::serialize(ar, obj);
+        ar.rewind();
+        T copy;
+        Eng3D::Deser::deserialize(ar, copy);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bytes += ar.size();
+        if(!(copy == obj)) return -1.f;
+        buffer = ar.buffer;
+    }
+    return (bytes / (1024.f * 1024.f)) / seconds;
+}
+
+static int test_bulk_ids(size_t max_samples = 1 << 22) {
+    std::vector<BenchId> fast(max_samples);
+    std::vector<BenchSlowId> slow(max_samples);
+    for(size_t i = 0; i < max_samples; i++)
+        fast[i].id = slow[i].id = rand();
+
+    std::vector<uint8_t> fast_bytes, slow_bytes;
+    const auto fast_mbs = bench_round_trip(fast, fast_bytes);
+    const auto slow_mbs = bench_round_trip(slow, slow_bytes);
+    std::cout << "Id vector: bulk " << fast_mbs << " MB/s, per element " << slow_mbs << " MB/s" << std::endl;
+    if(fast_mbs < 0.f || slow_mbs < 0.f) {
+        std::cout << "Test failed, round trip mismatch" << std::endl;
+        return -1;
+    }
+    // The bulk path must not change the format of savefiles
+    if(fast_bytes != slow_bytes) {
+        std::cout << "Test failed, bulk and per element streams differ" << std::endl;
+        return -1;
+    }
+
+    std::array<BenchId, 64> fixed;
+    for(auto& id : fixed) id.id = rand();
+    std::vector<uint8_t> fixed_bytes;
+    if(bench_round_trip(fixed, fixed_bytes, 1) < 0.f) {
+        std::cout << "Test failed, std::array round trip mismatch" << std::endl;
+        return -1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+template<typename Id>
+static std::vector<BenchProvince<Id>> make_world(size_t n_provinces) {
+    srand(n_provinces);
+    std::vector<BenchProvince<Id>> provinces(n_provinces);
+    for(auto& province : provinces) {
+        province.neighbour_ids.resize(4 + rand() % 8);
+        for(auto& id : province.neighbour_ids) id.id = rand() % n_provinces;
+        province.unit_ids.resize(rand() % 32);
+        for(auto& id : province.unit_ids) id.id = rand();
+        province.stockpile.resize(64);
+        std::iota(province.stockpile.begin(), province.stockpile.end(), rand());
+        province.owner = rand() % 256;
+    }
+    return provinces;
+}
+
+static int test_bulk_world(size_t n_provinces = 65536) {
+    const auto fast = make_world<BenchId>(n_provinces);
+    const auto slow = make_world<BenchSlowId>(n_provinces);
+    std::vector<uint8_t> fast_bytes, slow_bytes;
+    const auto fast_mbs = bench_round_trip(fast, fast_bytes);
+    const auto slow_mbs = bench_round_trip(slow, slow_bytes);
+    std::cout << "World of " << n_provinces << " provinces: bulk " << fast_mbs << " MB/s, per element " << slow_mbs << " MB/s" << std::endl;
+    if(fast_mbs < 0.f || slow_mbs < 0.f || fast_bytes != slow_bytes) {
+        std::cout << "Test failed, world round trip mismatch" << std::endl;
+        return -1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
 static int test_string(size_t max_samples = 32) {
     std::string fuzz;
     fuzz.resize(max_samples);
@@ -144,4 +271,8 @@ int main(int, char**) {
 
     std::cout << "std::string" << std::endl;
     test_string();
+
+    std::cout << "Bulk copy" << std::endl;
+    test_bulk_ids();
+    test_bulk_world();
 }
@@ -0,0 +1,122 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      broadcast.cpp
+//
+// Abstract:
+//      Measures the cost of broadcasting a packet against the number of clients,
+//      copying the payload per client versus sharing a pooled payload.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <sys/socket.h>
+
+#include "eng3d/network.hpp"
+
+class BenchServer : public Eng3D::Networking::Server {
+public:
+    BenchServer(unsigned port, unsigned max_conn)
+        : Eng3D::Networking::Server(port, max_conn)
+    {
+        this->clients = new Eng3D::Networking::ServerClient[max_conn];
+        for(size_t i = 0; i < max_conn; i++)
+            this->clients[i].is_connected = true;
+    }
+    void on_connect(int, int) override {}
+    void on_disconnect() override {}
+    void handler(const Eng3D::Networking::Packet&, Eng3D::Deser::Archive&, int) override {}
+
+    // What the clients threads do, send and drop the packets
+    void drain() {
+        Eng3D::Networking::Packet packet;
+        for(size_t i = 0; i < this->n_clients; i++)
+            while(this->clients[i].packets.try_pop(packet));
+    }
+};
+
+static Eng3D::Networking::Packet make_packet(size_t size) {
+    std::vector<uint8_t> payload(size);
+    for(size_t i = 0; i < size; i++)
+        payload[i] = static_cast<uint8_t>(i * 31);
+    Eng3D::Networking::Packet packet{};
+    packet.data(payload.data(), payload.size());
+    return packet;
+}
+
+static int test_loopback(Eng3D::Networking::PacketPool& pool) {
+    int sv[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        std::cout << "Test failed, can't create socket pair" << std::endl;
+        return -1;
+    }
+    const auto expected = make_packet(4096);
+    Eng3D::Networking::Packet packet(sv[0]);
+    packet.set_shared(pool.make(expected.buffer.data(), expected.size()));
+    Eng3D::Networking::Packet received(sv[1]);
+    const bool ok = packet.send() && received.recv() && received.buffer == expected.buffer;
+    close(sv[0]);
+    close(sv[1]);
+    if(!ok) {
+        std::cout << "Test failed, shared payload was not received intact" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int main(int, char**) {
+    constexpr size_t payload_size = 60000; // Around a full province update
+    constexpr int rounds = 64;
+    const auto packet = make_packet(payload_size);
+
+    BenchServer server(18360, 64);
+    if(test_loopback(server.packet_pool) != 0)
+        return -1;
+
+    for(const size_t n_clients : { 1, 4, 16, 64 }) {
+        server.n_clients = n_clients;
+
+        // Old behaviour, the whole packet is copied onto each queue
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < rounds; i++) {
+            for(size_t j = 0; j < n_clients; j++)
+                server.clients[j].packets.push(packet);
+            server.drain();
+        }
+        const auto copy_us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < rounds; i++) {
+            server.broadcast(packet);
+            server.drain();
+        }
+        const auto shared_us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+        std::cout << n_clients << " clients: copied " << copy_us << "us, shared " << shared_us << "us per broadcast" << std::endl;
+    }
+
+    // Once drained the payloads go back to the pool, so the broadcasts reuse them
+    const auto stats = server.packet_pool.get_stats();
+    std::cout << "Pool: " << stats.allocated << " allocated, " << stats.reused << " reused, " << stats.free << " free" << std::endl;
+    if(stats.reused == 0 || stats.allocated > 2) {
+        std::cout << "Test failed, payloads aren't recycled" << std::endl;
+        return -1;
+    }
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
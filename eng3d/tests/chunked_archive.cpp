@@ -0,0 +1,169 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      chunked_archive.cpp
+//
+// Abstract:
+//      Checks the round trip of chunked archives and compares them against a
+//      plain archive.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cmath>
+
+#include "eng3d/serializer.hpp"
+#include "eng3d/chunked_archive.hpp"
+
+/// @brief Province-like element, with a few nested lists
+struct Item {
+    std::string name;
+    std::vector<uint32_t> values;
+    uint16_t owner = 0;
+    float size = 0.f;
+
+    /// @brief Floats are stored as fixed point, so they're compared with some tolerance
+    bool operator==(const Item& o) const {
+        return name == o.name && values == o.values && owner == o.owner && std::abs(size - o.size) < 0.01f;
+    }
+};
+
+template<>
+struct Eng3D::Deser::Serializer<Item> {
+    template<bool is_const>
+    using type = typename Eng3D::Deser::CondConstType<is_const, Item>::type;
+    template<bool is_serialize>
+    static inline void deser_dynamic(Eng3D::Deser::Archive& ar, type<is_serialize>& obj) {
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.name);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.values);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.owner);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.size);
+    }
+};
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int test_chunked_archive(size_t n_items = 100000) {
+    std::vector<Item> items(n_items);
+    std::vector<uint16_t> owners(n_items * 3);
+    std::mt19937 rng(1825);
+    for(size_t i = 0; i < n_items; i++) {
+        items[i].name = "item_" + std::to_string(i);
+        items[i].values.resize(rng() % 32);
+        for(auto& value : items[i].values)
+            value = rng() % 1000;
+        items[i].owner = static_cast<uint16_t>(rng());
+        items[i].size = static_cast<float>(rng() % 100000) / 4.f;
+    }
+    for(auto& owner : owners)
+        owner = static_cast<uint16_t>(rng());
+    const std::vector<Item> empty_items;
+    const uint32_t time = 1825;
+
+    const std::string plain_path = "chunked_archive_plain.bin";
+    const std::string chunked_path = "chunked_archive_chunked.bin";
+    std::vector<Item> plain_items;
+    const auto plain_save_ms = time_ms([&] {
+        Eng3D::Deser::Archive ar{};
+        Eng3D::Deser::serialize(ar, items);
+        ar.to_file(plain_path);
+    });
+    const auto plain_load_ms = time_ms([&] {
+        Eng3D::Deser::Archive ar{};
+        ar.from_file(plain_path);
+        Eng3D::Deser::deserialize(ar, plain_items);
+    });
+
+    Eng3D::Deser::ChunkedArchive save_ar{};
+    const auto chunked_save_ms = time_ms([&] {
+        Eng3D::Deser::serialize(save_ar.header, time);
+        save_ar.serialize_list("items", items, 1024);
+        save_ar.serialize_list("owners", owners, 4096);
+        save_ar.serialize_list("empty", empty_items, 1024);
+        save_ar.to_file(chunked_path);
+    });
+    Eng3D::Deser::ChunkedArchive load_ar{};
+    std::vector<Item> loaded_items, loaded_empty_items{ Item{} };
+    std::vector<uint16_t> loaded_owners;
+    uint32_t loaded_time = 0;
+    const auto chunked_load_ms = time_ms([&] {
+        load_ar.from_file(chunked_path);
+        Eng3D::Deser::deserialize(load_ar.header, loaded_time);
+        load_ar.deserialize_list("items", loaded_items);
+        load_ar.deserialize_list("owners", loaded_owners);
+        load_ar.deserialize_list("empty", loaded_empty_items);
+    });
+    std::remove(plain_path.data());
+    std::remove(chunked_path.data());
+
+    if(plain_items != items) {
+        std::cout << "Test failed, plain archive round trip differs" << std::endl;
+        return -1;
+    }
+    if(loaded_items != items || loaded_owners != owners || !loaded_empty_items.empty() || loaded_time != time) {
+        std::cout << "Test failed, chunked archive round trip differs" << std::endl;
+        return -1;
+    }
+
+    // Same contents hash the same, whether they were saved or loaded
+    Eng3D::Deser::ChunkedArchive changed_ar{};
+    Eng3D::Deser::serialize(changed_ar.header, time);
+    items.back().owner++;
+    changed_ar.serialize_list("items", items, 1024);
+    changed_ar.serialize_list("owners", owners, 4096);
+    changed_ar.serialize_list("empty", empty_items, 1024);
+    changed_ar.header.end_stream();
+    if(save_ar.get_hash() != load_ar.get_hash() || save_ar.get_hash() == changed_ar.get_hash()) {
+        std::cout << "Test failed, hash of the archive doesn't follow its contents" << std::endl;
+        return -1;
+    }
+
+    // A chunk size of zero still stores every element, one per chunk
+    Eng3D::Deser::ChunkedArchive single_ar{};
+    const std::vector<uint16_t> few_owners(owners.begin(), owners.begin() + 16);
+    std::vector<uint16_t> loaded_few_owners;
+    single_ar.serialize_list("owners", few_owners, 0);
+    single_ar.deserialize_list("owners", loaded_few_owners);
+    if(loaded_few_owners != few_owners) {
+        std::cout << "Test failed, chunks of zero elements round trip differs" << std::endl;
+        return -1;
+    }
+
+    for(const auto& stats : save_ar.get_stats())
+        std::cout << "Save " << stats.name << ": " << stats.elements << " elements in " << stats.chunks << " chunks, " << stats.bytes << "B, " << stats.ms << "ms" << std::endl;
+    for(const auto& stats : load_ar.get_stats())
+        std::cout << "Load " << stats.name << ": " << stats.elements << " elements in " << stats.chunks << " chunks, " << stats.bytes << "B, " << stats.ms << "ms" << std::endl;
+    std::cout << "Plain: save " << plain_save_ms << "ms, load " << plain_load_ms << "ms" << std::endl;
+    std::cout << "Chunked: save " << chunked_save_ms << "ms, load " << chunked_load_ms << "ms" << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::Deser::ChunkedArchive" << std::endl;
+    return test_chunked_archive();
+}
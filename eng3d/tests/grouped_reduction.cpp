@@ -0,0 +1,104 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      grouped_reduction.cpp
+//
+// Abstract:
+//      Checks the grouped reduction against a serial sum and times it against
+//      per-thread copies of the groups.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <tbb/combinable.h>
+
+#include "eng3d/grouped_reduction.hpp"
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int test_grouped_reduction(size_t n_elements = 50000, size_t n_groups = 1000) {
+    // Province-like elements with a nation-like group, some have none
+    std::vector<uint16_t> groups(n_elements);
+    std::vector<float> values(n_elements);
+    std::mt19937 rng(1825);
+    for(size_t i = 0; i < n_elements; i++) {
+        groups[i] = rng() % 50 == 0 ? static_cast<uint16_t>(-1) : static_cast<uint16_t>(rng() % n_groups);
+        values[i] = static_cast<float>(rng() % 10000) / 100.f;
+    }
+
+    std::vector<float> expected(n_groups, 0.f);
+    for(size_t i = 0; i < n_elements; i++)
+        if(groups[i] < n_groups)
+            expected[groups[i]] += values[i];
+
+    // Start the scheduler beforehand so it isn't timed
+    tbb::parallel_for(static_cast<size_t>(0), n_groups, [](size_t) {});
+
+    Eng3D::GroupedReduction reduction{};
+    std::vector<float> sums(n_groups, -1.f);
+    const auto partition_ms = time_ms([&] {
+        reduction.partition(n_elements, n_groups, [&groups](size_t i) { return groups[i]; });
+    });
+    const auto reduce_ms = time_ms([&] {
+        reduction.reduce(values.data(), [&sums](size_t group, float sum) { sums[group] = sum; });
+    });
+    // Same order as the serial sum, so they're equal to the bit
+    if(sums != expected) {
+        std::cout << "Test failed, grouped sums differ from the serial sums" << std::endl;
+        return -1;
+    }
+
+    // What it replaces, every thread has its own copy of all the groups
+    std::vector<float> combined(n_groups, 0.f);
+    const auto combinable_ms = time_ms([&] {
+        tbb::combinable<std::vector<float>> local_sums([n_groups] { return std::vector<float>(n_groups, 0.f); });
+        tbb::parallel_for(static_cast<size_t>(0), n_elements, [&](size_t i) {
+            if(groups[i] < n_groups)
+                local_sums.local()[groups[i]] += values[i];
+        });
+        local_sums.combine_each([&combined](const auto& local) {
+            for(size_t i = 0; i < local.size(); i++)
+                combined[i] += local[i];
+        });
+    });
+
+    // An empty partition has no groups
+    Eng3D::GroupedReduction empty{};
+    empty.partition(0, 0, [](size_t) { return 0; });
+    if(empty.size() != 0) {
+        std::cout << "Test failed, empty partition has groups" << std::endl;
+        return -1;
+    }
+
+    std::cout << "Grouped: partition " << partition_ms << "ms, reduce " << reduce_ms << "ms" << std::endl;
+    std::cout << "Combinable: " << combinable_ms << "ms" << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::GroupedReduction" << std::endl;
+    return test_grouped_reduction();
+}
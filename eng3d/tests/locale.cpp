@@ -0,0 +1,147 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      locale.cpp
+//
+// Abstract:
+//      Checks translation lookups and string formatting, and benchmarks the
+//      lock-free translation table against a mutex guarded map.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+
+#include "eng3d/string.hpp"
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief Run fn(thread_index) on n threads and wait for all of them
+template<typename F>
+static void run_threads(size_t n, F&& fn) {
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < n; i++)
+        threads.emplace_back(fn, i);
+    for(auto& thread : threads)
+        thread.join();
+}
+
+static int test_locale(size_t n_messages = 2000, size_t n_lookups = 2000000) {
+    Eng3D::StringManager pool;
+
+    // Formatting, short and longer than the initial guess
+    const std::string long_text(1000, 'a');
+    if(Eng3D::string_format("%i-%s", 42, "abc") != "42-abc" || Eng3D::string_format("%s!", long_text.data()) != long_text + "!") {
+        std::cout << "Test failed, wrong formatting" << std::endl;
+        return -1;
+    }
+
+    // No locale loaded, the text is given back as is
+    if(Eng3D::Locale::translate("Province") != "Province") {
+        std::cout << "Test failed, translated without a locale" << std::endl;
+        return -1;
+    }
+
+    const std::string path = "locale_test.po";
+    {
+        std::ofstream po(path);
+        for(size_t i = 0; i < n_messages; i++)
+            po << "msgid \"Message " << i << "\"\nmsgstr \"Mensaje " << i << "\"\n";
+        po << "msgid \"Untranslated\"\nmsgstr \"\"\n";
+    }
+    Eng3D::Locale::from_file(path);
+    std::remove(path.data());
+
+    if(Eng3D::Locale::translate("Message 7") != "Mensaje 7" || Eng3D::Locale::translate("Untranslated") != "Untranslated" || Eng3D::Locale::translate("Missing") != "Missing") {
+        std::cout << "Test failed, wrong translation" << std::endl;
+        return -1;
+    }
+    if(Eng3D::translate_format("Message %i", 3) != "Message 3") {
+        std::cout << "Test failed, wrong translated formatting" << std::endl;
+        return -1;
+    }
+    // Interned strings, looked up twice to go through the cache
+    const Eng3D::StringRef ref("Message 12");
+    const Eng3D::StringRef missing_ref("Missing");
+    for(size_t i = 0; i < 2; i++) {
+        if(Eng3D::Locale::translate(ref) != "Mensaje 12" || Eng3D::Locale::translate(missing_ref) != "Missing") {
+            std::cout << "Test failed, wrong translation of interned string" << std::endl;
+            return -1;
+        }
+    }
+    // Reusing ids for other strings must not give stale translations
+    pool.clear();
+    const Eng3D::StringRef other_ref("Message 13");
+    Eng3D::StringRef("Message 12");
+    if(Eng3D::Locale::translate(other_ref) != "Mensaje 13") {
+        std::cout << "Test failed, stale translation after clearing the pool" << std::endl;
+        return -1;
+    }
+
+    // Concurrent lookups, as done when refreshing the UI labels
+    std::unordered_map<std::string, std::string> locked_map;
+    std::mutex locked_mutex;
+    std::vector<std::string> keys;
+    std::vector<Eng3D::StringRef> refs;
+    for(size_t i = 0; i < n_messages; i++) {
+        keys.push_back("Message " + std::to_string(i * 2)); // Half of them are misses
+        refs.push_back(Eng3D::StringRef(keys.back()));
+        locked_map["Message " + std::to_string(i)] = "Mensaje " + std::to_string(i);
+    }
+    const size_t n_threads = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<size_t> checksums(n_threads);
+    const auto locked_ms = time_ms([&] {
+        run_threads(n_threads, [&](size_t t) {
+            for(size_t i = 0; i < n_lookups / n_threads; i++) {
+                const std::scoped_lock lock(locked_mutex);
+                checksums[t] += locked_map[keys[(i * 7 + t) % keys.size()]].size();
+            }
+        });
+    });
+    const auto table_ms = time_ms([&] {
+        run_threads(n_threads, [&](size_t t) {
+            for(size_t i = 0; i < n_lookups / n_threads; i++)
+                checksums[t] += Eng3D::Locale::translate_view(keys[(i * 7 + t) % keys.size()]).size();
+        });
+    });
+    const auto ref_ms = time_ms([&] {
+        run_threads(n_threads, [&](size_t t) {
+            for(size_t i = 0; i < n_lookups / n_threads; i++)
+                checksums[t] += Eng3D::Locale::translate_view(refs[(i * 7 + t) % refs.size()]).size();
+        });
+    });
+
+    std::cout << n_lookups << " lookups on " << n_threads << " threads: locked map " << locked_ms << "ms (" << locked_map.size() << " entries after misses), table " << table_ms << "ms, interned " << ref_ms << "ms" << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::Locale" << std::endl;
+    return test_locale();
+}
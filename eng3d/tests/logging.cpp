@@ -0,0 +1,120 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      logging.cpp
+//
+// Abstract:
+//      Checks that the asynchronous log sink writes every message, that disabled
+//      levels cost no formatting and that repeated messages are rate limited.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+
+#include "eng3d/log.hpp"
+#include "eng3d/string.hpp"
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int test_logging(size_t n_threads = 4, size_t n_messages = 200, size_t n_disabled = 1000000) {
+    const std::string path = "logging_test.txt";
+    if(!Eng3D::Log::open_file(path)) {
+        std::cout << "Test failed, can't open " << path << std::endl;
+        return -1;
+    }
+
+    // Every message gets written, unless the ring was full
+    Eng3D::Log::set_rate_limit(0);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([t, n_messages] {
+            for(size_t i = 0; i < n_messages; i++)
+                Eng3D::Log::warning("test", "Thread %zu message %zu", t, i);
+        });
+    }
+    for(auto& thread : threads)
+        thread.join();
+    Eng3D::Log::flush();
+    auto stats = Eng3D::Log::get_stats();
+    if(stats.written + stats.dropped != n_threads * n_messages) {
+        std::cout << "Test failed, " << stats.written << " written and " << stats.dropped << " dropped of " << n_threads * n_messages << std::endl;
+        return -1;
+    }
+    std::ifstream file(path);
+    size_t lines = 0;
+    for(std::string line; std::getline(file, line); lines++) {
+        if(line.rfind("<Warning:test> Thread ", 0) != 0) {
+            std::cout << "Test failed, unexpected line " << line << std::endl;
+            return -1;
+        }
+    }
+    if(lines != stats.written) {
+        std::cout << "Test failed, " << lines << " lines on the file but " << stats.written << " written" << std::endl;
+        return -1;
+    }
+
+    const auto concurrent_stats = stats;
+
+    // Repeated messages of a call site
+    Eng3D::Log::set_rate_limit(10);
+    for(size_t i = 0; i < 1000; i++)
+        Eng3D::Log::warning("test", "Province %zu is too big", i);
+    Eng3D::Log::flush();
+    stats = Eng3D::Log::get_stats();
+    if(stats.suppressed < 900) {
+        std::cout << "Test failed, only " << stats.suppressed << " messages suppressed" << std::endl;
+        return -1;
+    }
+
+    // Disabled levels, formatted eagerly vs lazily
+    Eng3D::Log::debug_show = false;
+    const auto written = stats.written;
+    const auto eager_ms = time_ms([n_disabled] {
+        for(size_t i = 0; i < n_disabled; i++)
+            Eng3D::Log::debug("test", Eng3D::string_format("Tick %zu done", i));
+    });
+    const auto lazy_ms = time_ms([n_disabled] {
+        for(size_t i = 0; i < n_disabled; i++)
+            Eng3D::Log::debug("test", "Tick %zu done", i);
+    });
+    Eng3D::Log::flush();
+    if(Eng3D::Log::get_stats().written != written) {
+        std::cout << "Test failed, disabled debug messages were written" << std::endl;
+        return -1;
+    }
+
+    std::cout << n_threads * n_messages << " concurrent messages: " << concurrent_stats.written << " written, " << concurrent_stats.dropped << " dropped" << std::endl;
+    std::cout << "1000 repeated messages: " << stats.written - concurrent_stats.written << " written, " << stats.suppressed << " suppressed" << std::endl;
+    std::cout << n_disabled << " disabled debug messages: eager " << eager_ms << "ms, lazy " << lazy_ms << "ms" << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::Log" << std::endl;
+    return test_logging();
+}
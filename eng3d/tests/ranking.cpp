@@ -0,0 +1,108 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      ranking.cpp
+//
+// Abstract:
+//      Checks the order of the ranking against a stable sort and times it
+//      against sorting from scratch on every update.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "eng3d/ranking.hpp"
+#include "eng3d/heap_ext.hpp"
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief Like the factories of a province, ranked by their operating ratio, which
+/// drifts a little from tick to tick
+static int test_ranking(size_t n_lists = 5000, size_t n_keys = 32, size_t n_updates = 100) {
+    std::mt19937 rng(1825);
+    std::uniform_real_distribution<float> initial(0.f, 2.f), drift(-0.01f, 0.01f);
+    std::vector<std::vector<float>> scores(n_lists, std::vector<float>(n_keys));
+    for(auto& list_scores : scores)
+        for(auto& score : list_scores)
+            score = initial(rng);
+
+    std::vector<Eng3D::Ranking<size_t>> rankings(n_lists);
+    float sort_ms = 0.f, ranking_ms = 0.f;
+    size_t sort_allocations = 0, ranking_allocations = 0, moves = 0;
+    for(size_t update = 0; update < n_updates; update++) {
+        for(auto& list_scores : scores)
+            for(auto& score : list_scores)
+                score = std::max(score + drift(rng), 0.f);
+
+        // What it replaces, a new list sorted on every update
+        std::vector<std::vector<std::pair<size_t, float>>> sorted(n_lists);
+        auto allocations = Eng3D::Heap::get_stats().allocations;
+        sort_ms += time_ms([&] {
+            for(size_t i = 0; i < n_lists; i++) {
+                std::vector<std::pair<size_t, float>> list;
+                list.reserve(n_keys);
+                for(size_t j = 0; j < n_keys; j++)
+                    list.emplace_back(j, scores[i][j]);
+                std::stable_sort(list.begin(), list.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+                sorted[i] = std::move(list);
+            }
+        });
+        sort_allocations += Eng3D::Heap::get_stats().allocations - allocations;
+
+        allocations = Eng3D::Heap::get_stats().allocations;
+        ranking_ms += time_ms([&] {
+            for(size_t i = 0; i < n_lists; i++)
+                moves += rankings[i].update(n_keys, [&](size_t key) { return scores[i][key]; });
+        });
+        if(update > 0)
+            ranking_allocations += Eng3D::Heap::get_stats().allocations - allocations;
+
+        // Scores of both must be in the same descending order, ties may be in any order
+        for(size_t i = 0; i < n_lists; i++) {
+            const bool same_order = std::equal(rankings[i].begin(), rankings[i].end(), sorted[i].begin(), sorted[i].end(), [](const auto& a, const auto& b) {
+                return a.second == b.second;
+            });
+            if(rankings[i].size() != n_keys || !same_order) {
+                std::cout << "Test failed, ranking isn't in descending order" << std::endl;
+                return -1;
+            }
+        }
+    }
+    if(ranking_allocations != 0) {
+        std::cout << "Test failed, ranking allocated after being sized" << std::endl;
+        return -1;
+    }
+
+    std::cout << "Sort: " << sort_ms / n_updates << "ms and " << sort_allocations / n_updates << " allocations per update" << std::endl;
+    std::cout << "Ranking: " << ranking_ms / n_updates << "ms and " << ranking_allocations / n_updates << " allocations per update, " << moves / n_updates << " moves" << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::Ranking" << std::endl;
+    return test_ranking();
+}
@@ -0,0 +1,135 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      rle_grid.cpp
+//
+// Abstract:
+//      Checks the run-length encoded grid against a raw array and benchmarks
+//      memory usage, lookups, row scans and serialized size of both.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdint>
+
+#include "eng3d/serializer.hpp"
+#include "eng3d/rle_grid.hpp"
+
+/// @brief Generate a province-like map, rectangular-ish blobs of random sizes
+static std::vector<uint16_t> make_map(size_t width, size_t height) {
+    std::vector<uint16_t> map(width * height);
+    std::mt19937 rng(1825);
+    std::uniform_int_distribution<size_t> size_dist(8, 96);
+    const size_t cell_w = 48, cell_h = 32;
+    std::vector<size_t> jitter(width / cell_w + 2);
+    for(auto& e : jitter) e = size_dist(rng) % cell_w;
+    for(size_t j = 0; j < height; j++) {
+        for(size_t i = 0; i < width; i++) {
+            const size_t cx = (i + jitter[(j / cell_h) % jitter.size()]) / cell_w;
+            const size_t cy = (j + jitter[(i / cell_w) % jitter.size()] / 2) / cell_h;
+            map[i + j * width] = static_cast<uint16_t>((cx + cy * (width / cell_w + 1)) % 65535);
+        }
+    }
+    return map;
+}
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int test_rle_grid(size_t width = 5400, size_t height = 2700) {
+    const auto map = make_map(width, height);
+    Eng3D::RLEGrid<uint16_t> grid;
+    const auto encode_ms = time_ms([&]() {
+        grid = Eng3D::RLEGrid<uint16_t>(map.data(), width, height);
+    });
+
+    // Every single tile must match
+    for(size_t j = 0; j < height; j++) {
+        for(size_t i = 0; i < width; i++) {
+            if(grid.get(i, j) != map[i + j * width]) {
+                std::cout << "Test failed, tile " << i << "," << j << " is different" << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    // Random point lookups
+    std::mt19937 rng(0);
+    std::vector<size_t> lookups(1 << 20);
+    for(auto& e : lookups) e = rng() % (width * height);
+    size_t raw_sum = 0, rle_sum = 0;
+    const auto raw_lookup_ms = time_ms([&]() {
+        for(const auto idx : lookups) raw_sum += map[idx];
+    });
+    const auto rle_lookup_ms = time_ms([&]() {
+        for(const auto idx : lookups) rle_sum += grid[idx];
+    });
+    if(raw_sum != rle_sum) {
+        std::cout << "Test failed, lookups differ" << std::endl;
+        return -1;
+    }
+
+    // Full scans, like the ones for the province box areas
+    size_t raw_scan = 0, rle_scan = 0;
+    const auto raw_scan_ms = time_ms([&]() {
+        for(size_t i = 0; i < width * height; i++) raw_scan += map[i];
+    });
+    const auto rle_scan_ms = time_ms([&]() {
+        for(size_t j = 0; j < height; j++)
+            grid.for_each_run(j, [&rle_scan](size_t x_start, size_t x_end, uint16_t value) {
+                rle_scan += (x_end - x_start) * value;
+            });
+    });
+    if(raw_scan != rle_scan) {
+        std::cout << "Test failed, scans differ" << std::endl;
+        return -1;
+    }
+
+    // Serialized size and roundtrip
+    // Raw tiles are copied as a block, just like the world used to do
+    Eng3D::Deser::Archive raw_ar{};
+    raw_ar.copy_from(map.data(), map.size() * sizeof(uint16_t));
+    Eng3D::Deser::Archive rle_ar{};
+    Eng3D::Deser::serialize(rle_ar, grid);
+    rle_ar.rewind();
+    Eng3D::RLEGrid<uint16_t> loaded_grid;
+    Eng3D::Deser::deserialize(rle_ar, loaded_grid);
+    if(loaded_grid.run_starts != grid.run_starts || loaded_grid.run_values != grid.run_values || loaded_grid.row_offsets != grid.row_offsets) {
+        std::cout << "Test failed, serialized grid is different" << std::endl;
+        return -1;
+    }
+
+    std::cout << "Map " << width << "x" << height << ", " << grid.run_count() << " runs, encoded in " << encode_ms << "ms" << std::endl;
+    std::cout << "Memory: raw " << map.size() * sizeof(uint16_t) << "B, rle " << grid.memory_usage() << "B" << std::endl;
+    std::cout << "Random lookups: raw " << raw_lookup_ms << "ms, rle " << rle_lookup_ms << "ms" << std::endl;
+    std::cout << "Full scan: raw " << raw_scan_ms << "ms, rle " << rle_scan_ms << "ms" << std::endl;
+    std::cout << "Serialized: raw " << raw_ar.size() << "B, rle " << rle_ar.size() << "B" << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::RLEGrid" << std::endl;
+    return test_rle_grid();
+}
@@ -0,0 +1,201 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      small_map.cpp
+//
+// Abstract:
+//      Checks the small map against std::map, and compares the memory and
+//      serialization cost of per-nation investments stored densely (a vector
+//      sized to the nations) and sparsely, on a world the size of industrial_era.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cmath>
+
+#include "eng3d/serializer.hpp"
+#include "eng3d/small_map.hpp"
+
+/// @brief Same layout as a building investment
+struct Investment {
+    float total = 0.f;
+    float today_funds = 0.f;
+
+    /// @brief Floats are stored as fixed point, so they're compared with some tolerance
+    bool operator==(const Investment& o) const {
+        return std::abs(total - o.total) < 0.01f && std::abs(today_funds - o.today_funds) < 0.01f;
+    }
+};
+
+template<>
+struct Eng3D::Deser::Serializer<Investment> {
+    template<bool is_const>
+    using type = typename Eng3D::Deser::CondConstType<is_const, Investment>::type;
+    template<bool is_serialize>
+    static inline void deser_dynamic(Eng3D::Deser::Archive& ar, type<is_serialize>& obj) {
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.total);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.today_funds);
+    }
+};
+
+using InvestmentMap = Eng3D::SmallMap<uint16_t, Investment>;
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool same_entries(const InvestmentMap& map, const std::map<uint16_t, Investment>& reference) {
+    if(map.size() != reference.size()) return false;
+    auto it = reference.begin();
+    for(const auto& [key, value] : map) {
+        if(key != it->first || !(value == it->second)) return false;
+        it++;
+    }
+    return true;
+}
+
+/// @brief Random inserts, updates and erases, mirrored onto a std::map
+static int test_operations() {
+    std::mt19937 rng(1825);
+    for(size_t round = 0; round < 200; round++) {
+        InvestmentMap map;
+        std::map<uint16_t, Investment> reference;
+        const uint16_t n_keys = 1 + round % 12; // Both inline and spilled onto the heap
+        for(size_t i = 0; i < 100; i++) {
+            const uint16_t key = rng() % n_keys;
+            switch(rng() % 3) {
+            case 0:
+                map[key].total += 1.f;
+                reference[key].total += 1.f;
+                break;
+            case 1:
+                map.insert(std::make_pair(key, Investment{ 2.f, 1.f }));
+                reference.insert(std::make_pair(key, Investment{ 2.f, 1.f }));
+                break;
+            default:
+                map.erase(key);
+                reference.erase(key);
+                break;
+            }
+            if(!same_entries(map, reference) || map.contains(key) != reference.contains(key)) {
+                std::cout << "Test failed, small map differs from std::map" << std::endl;
+                return -1;
+            }
+        }
+
+        // Copies are independent of the original
+        auto copy = map;
+        copy[n_keys].total = 5.f;
+        if(map.contains(n_keys) || !copy.contains(n_keys)) {
+            std::cout << "Test failed, copy shares entries with the original" << std::endl;
+            return -1;
+        }
+
+        Eng3D::Deser::Archive ar{};
+        Eng3D::Deser::serialize(ar, map);
+        ar.rewind();
+        InvestmentMap loaded;
+        if(!map.empty())
+            loaded[0].total = 1.f; // Overwritten by the load
+        Eng3D::Deser::deserialize(ar, loaded);
+        if(!(loaded == map)) {
+            std::cout << "Test failed, serialization round trip differs" << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int test_industrial_era(size_t n_provinces = 5846, size_t n_building_types = 22, size_t n_nations = 250) {
+    const size_t n_buildings = n_provinces * n_building_types;
+    // A few buildings get foreign investment, from one or two nations and rarely more
+    std::mt19937 rng(1825);
+    std::vector<std::pair<size_t, uint16_t>> investments;
+    for(size_t i = 0; i < n_buildings; i++) {
+        if(rng() % 16 != 0) continue;
+        const size_t n_investors = rng() % 32 == 0 ? 5 : 1 + rng() % 2;
+        for(size_t j = 0; j < n_investors; j++)
+            investments.emplace_back(i, static_cast<uint16_t>(rng() % n_nations));
+    }
+
+    std::vector<std::vector<Investment>> dense(n_buildings, std::vector<Investment>(n_nations));
+    std::vector<InvestmentMap> sparse(n_buildings);
+    for(const auto& [building, nation] : investments) {
+        dense[building][nation].total += 100.f;
+        sparse[building][nation].total += 100.f;
+    }
+
+    size_t dense_bytes = sizeof(dense[0]) * n_buildings, sparse_bytes = sizeof(sparse[0]) * n_buildings;
+    size_t n_spilled = 0;
+    for(size_t i = 0; i < n_buildings; i++) {
+        dense_bytes += dense[i].capacity() * sizeof(Investment);
+        if(sparse[i].is_heap()) {
+            sparse_bytes += sparse[i].size() * sizeof(InvestmentMap::value_type);
+            n_spilled++;
+        }
+    }
+
+    // What the economy does with them every tick
+    float dense_sum = 0.f, sparse_sum = 0.f;
+    const auto dense_iter_ms = time_ms([&] {
+        for(const auto& building : dense)
+            for(const auto& investment : building)
+                dense_sum += investment.total;
+    });
+    const auto sparse_iter_ms = time_ms([&] {
+        for(const auto& building : sparse)
+            for(const auto& [nation, investment] : building)
+                sparse_sum += investment.total;
+    });
+    if(dense_sum != sparse_sum) {
+        std::cout << "Test failed, dense and sparse investments differ" << std::endl;
+        return -1;
+    }
+
+    Eng3D::Deser::Archive dense_ar{}, sparse_ar{};
+    const auto dense_ser_ms = time_ms([&] { Eng3D::Deser::serialize(dense_ar, dense); });
+    const auto sparse_ser_ms = time_ms([&] { Eng3D::Deser::serialize(sparse_ar, sparse); });
+    std::vector<InvestmentMap> loaded;
+    sparse_ar.rewind();
+    const auto sparse_deser_ms = time_ms([&] { Eng3D::Deser::deserialize(sparse_ar, loaded); });
+    if(loaded != sparse) {
+        std::cout << "Test failed, sparse investments round trip differs" << std::endl;
+        return -1;
+    }
+
+    std::cout << n_buildings << " buildings, " << investments.size() << " foreign investments, " << n_spilled << " maps spilled onto the heap" << std::endl;
+    std::cout << "Memory: dense " << dense_bytes / 1024 << "KB, sparse " << sparse_bytes / 1024 << "KB" << std::endl;
+    std::cout << "Iterate: dense " << dense_iter_ms << "ms, sparse " << sparse_iter_ms << "ms" << std::endl;
+    std::cout << "Serialize: dense " << dense_ar.size() << "B in " << dense_ser_ms << "ms, sparse " << sparse_ar.size() << "B in " << sparse_ser_ms << "ms (" << sparse_deser_ms << "ms to load)" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::SmallMap" << std::endl;
+    if(test_operations() != 0 || test_industrial_era() != 0)
+        return -1;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Eng3D - General purpouse game engine
+// Copyright (C) 2021-2023, Eng3D contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      string_pool.cpp
+//
+// Abstract:
+//      Checks interning and serialization of the string pool, and benchmarks
+//      concurrent reads against a mutex guarded character vector.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "eng3d/serializer.hpp"
+#include "eng3d/string.hpp"
+
+/// @brief The old pool, every insert appends and every read takes the lock
+struct LockedPool {
+    std::vector<char> strings;
+    mutable std::mutex strings_mutex;
+
+    size_t insert(const std::string_view str) {
+        const std::scoped_lock lock(strings_mutex);
+        const auto id = strings.size();
+        std::copy(str.begin(), str.end(), std::back_inserter(strings));
+        strings.push_back('\0');
+        return id;
+    }
+
+    std::string_view get_by_id(size_t id) const {
+        const std::scoped_lock lock(strings_mutex);
+        return &strings[id];
+    }
+};
+
+template<typename F>
+static float time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// @brief Run fn(thread_index) on n threads and wait for all of them
+template<typename F>
+static void run_threads(size_t n, F&& fn) {
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < n; i++)
+        threads.emplace_back(fn, i);
+    for(auto& thread : threads)
+        thread.join();
+}
+
+static int test_string_pool(size_t n_unique = 20000, size_t n_reads = 2000000) {
+    Eng3D::StringManager pool;
+
+    // Same text gives the same id
+    const auto a = pool.insert("province_paris");
+    const auto b = pool.insert(std::string("province_") + "paris");
+    if(a != b || Eng3D::StringRef() != pool.insert("")) {
+        std::cout << "Test failed, interned strings have different ids" << std::endl;
+        return -1;
+    }
+
+    // Names are repeated a lot (i.e pop types or commodities on each province)
+    std::vector<std::string> texts;
+    for(size_t i = 0; i < n_unique; i++)
+        texts.push_back("name_" + std::to_string(i));
+    const auto a_view = a.get_string();
+    std::vector<Eng3D::StringRef> refs;
+    std::vector<size_t> picks;
+    std::mt19937 rng(1825);
+    std::uniform_int_distribution<size_t> text_dist(0, n_unique - 1);
+    for(size_t i = 0; i < n_unique * 8; i++) {
+        picks.push_back(text_dist(rng));
+        refs.push_back(pool.insert(texts[picks.back()]));
+    }
+    for(size_t i = 0; i < refs.size(); i++) {
+        if(refs[i].get_string() != texts[picks[i]] || pool.find(texts[picks[i]]) != refs[i]) {
+            std::cout << "Test failed, interned text is different" << std::endl;
+            return -1;
+        }
+    }
+    // Views are never invalidated by later inserts
+    if(a_view.data() != a.get_string().data() || a_view != "province_paris") {
+        std::cout << "Test failed, view was invalidated" << std::endl;
+        return -1;
+    }
+    if(pool.find("never_inserted").has_value()) {
+        std::cout << "Test failed, found a string that was never inserted" << std::endl;
+        return -1;
+    }
+
+    // Roundtrip keeps the ids
+    Eng3D::Deser::Archive ar{};
+    Eng3D::Deser::serialize(ar, pool);
+    const auto size = pool.size();
+    const auto stats = pool.get_stats();
+    pool.clear();
+    ar.rewind();
+    Eng3D::Deser::deserialize(ar, pool);
+    if(pool.size() != size) {
+        std::cout << "Test failed, deserialized pool has a different size" << std::endl;
+        return -1;
+    }
+    for(const auto& ref : refs) {
+        if(pool.find(ref.get_string()) != ref) {
+            std::cout << "Test failed, deserialized pool has different ids" << std::endl;
+            return -1;
+        }
+    }
+
+    // Concurrent reads, as done by the renderer and the simulation threads
+    LockedPool locked_pool;
+    std::vector<size_t> locked_ids;
+    for(const auto& text : texts)
+        locked_ids.push_back(locked_pool.insert(text));
+    const size_t n_threads = std::max(2u, std::thread::hardware_concurrency());
+    std::vector<size_t> checksums(n_threads);
+    const auto locked_ms = time_ms([&] {
+        run_threads(n_threads, [&](size_t t) {
+            for(size_t i = 0; i < n_reads / n_threads; i++)
+                checksums[t] += locked_pool.get_by_id(locked_ids[(i * 7 + t) % locked_ids.size()]).size();
+        });
+    });
+    const auto interned_ms = time_ms([&] {
+        run_threads(n_threads, [&](size_t t) {
+            for(size_t i = 0; i < n_reads / n_threads; i++)
+                checksums[t] += pool.get_by_id(refs[(i * 7 + t) % refs.size()]).size();
+        });
+    });
+
+    std::cout << "Strings: " << stats.unique_strings << " unique of " << stats.total_inserts << " inserted" << std::endl;
+    std::cout << "Memory: " << stats.unique_bytes << "B text (" << stats.total_bytes << "B without interning), " << stats.reserved_bytes << "B reserved" << std::endl;
+    std::cout << n_reads << " reads on " << n_threads << " threads: locked " << locked_ms << "ms, lock-free " << interned_ms << "ms" << std::endl;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Eng3D::StringManager" << std::endl;
+    return test_string_pool();
+}
@@ -0,0 +1,153 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      bench/bench_fixture.hpp
+//
+// Abstract:
+//      Synthetic worlds, command line options and timing shared by the
+//      benches that compare a part of the AI against what it did before.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "eng3d/string.hpp"
+#include "world.hpp"
+
+namespace Bench {
+    template<typename F>
+    double time_ms(F&& fn) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// @brief Numeric options of a bench given as "--name N"
+    class Arguments {
+        struct Option {
+            std::string flag;
+            std::function<void(size_t)> set;
+            bool is_list;
+        };
+    public:
+        Arguments(const std::string_view _bench_name)
+            : bench_name{ _bench_name }
+        {
+
+        }
+
+        template<typename T>
+        void add(const std::string_view flag, T& value) {
+            this->options.push_back(Option{ std::string(flag), [&value](size_t n) { value = static_cast<T>(n); }, false });
+        }
+
+        /// @brief Option that can be given many times, the first one replaces the defaults
+        void add_list(const std::string_view flag, std::vector<size_t>& values) {
+            this->options.push_back(Option{ std::string(flag), [&values, is_default = true](size_t n) mutable {
+                if(is_default) values.clear();
+                is_default = false;
+                values.push_back(n);
+            }, true });
+        }
+
+        /// @return False if only the usage was asked for
+        bool parse(int argc, char** argv) const {
+            for(int i = 1; i < argc; i++) {
+                const std::string_view arg = argv[i];
+                if(arg == "--help") {
+                    std::string usage = "Usage: " + this->bench_name;
+                    for(const auto& option : this->options)
+                        usage += " [" + option.flag + " N]" + (option.is_list ? "..." : "");
+                    fprintf(stderr, "%s\n", usage.data());
+                    return false;
+                }
+                const auto it = std::find_if(this->options.begin(), this->options.end(), [arg](const auto& option) {
+                    return option.flag == arg;
+                });
+                if(it == this->options.end())
+                    CXX_THROW(std::runtime_error, "Unknown argument " + std::string(arg));
+                if(++i >= argc)
+                    CXX_THROW(std::runtime_error, string_format("Expected a number after %s", argv[i - 1]));
+                it->set(std::strtoull(argv[i], nullptr, 10));
+            }
+            return true;
+        }
+    private:
+        std::string bench_name;
+        std::vector<Option> options;
+    };
+
+    /// @brief Square grid of land provinces split onto bands of nations, which own and control
+    /// them, with the relations of every pair of nations. Anything else a bench needs of a
+    /// province is filled in by on_province before it's inserted
+    inline void generate_grid_world(World& world, size_t n_provinces, size_t n_nations, const std::function<void(Province&)>& on_province = {}) {
+        world.nations.clear();
+        world.provinces.clear();
+        world.relations.clear();
+        for(size_t i = 0; i < n_nations; i++) {
+            Nation nation{};
+            nation.ref_name = string_format("nation_%zu", i);
+            nation.name = nation.ref_name;
+            world.insert(nation);
+        }
+
+        const size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(n_provinces))));
+        for(size_t i = 0; i < n_provinces; i++) {
+            const size_t x = i % columns, y = i / columns;
+            Province province{};
+            province.ref_name = string_format("province_%zu", i);
+            province.name = province.ref_name;
+            if(x > 0) province.neighbour_ids.push_back(ProvinceId(i - 1));
+            if(x + 1 < columns && i + 1 < n_provinces) province.neighbour_ids.push_back(ProvinceId(i + 1));
+            if(y > 0) province.neighbour_ids.push_back(ProvinceId(i - columns));
+            if(i + columns < n_provinces) province.neighbour_ids.push_back(ProvinceId(i + columns));
+            if(on_province) on_province(province);
+            world.insert(province);
+        }
+
+        for(auto& province : world.provinces) {
+            const auto nation_id = NationId(static_cast<size_t>(province.get_id()) * n_nations / n_provinces);
+            province.owner_id = province.controller_id = nation_id;
+            world.nations[nation_id].owned_provinces.push_back(province);
+            world.nations[nation_id].controlled_provinces.push_back(province);
+        }
+        world.relations.resize(world.nations.size() * world.nations.size());
+    }
+
+    /// @brief Runs the bench, reporting what it threw
+    template<typename F>
+    int run(const char* bench_name, F&& fn) {
+        try {
+            return fn();
+        } catch(const std::exception& e) {
+            fprintf(stderr, "%s: %s\n", bench_name, e.what());
+            return -1;
+        }
+    }
+}
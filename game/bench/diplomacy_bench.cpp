@@ -0,0 +1,243 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      bench/diplomacy_bench.cpp
+//
+// Abstract:
+//      Compares the diplomacy of the AI over the shortlists of the diplomacy
+//      index against every nation looking at every other nation.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+
+#include "eng3d/rand.hpp"
+
+#include "world.hpp"
+#include "server/diplomacy_index.hpp"
+#include "bench_fixture.hpp"
+
+/// @brief Shape of the synthetic world
+struct DiplomacyBenchConfig {
+    std::vector<size_t> nations = { 100, 300, 1000 };
+    size_t provinces_per_nation = 20;
+    size_t wars = 0; // Pairs of nations at war, a tenth of the nations if zero
+    size_t alliances = 0; // Pairs of allied nations, a fifth of the nations if zero
+    size_t changes = 10; // Wars, alliances and provinces that change hands between each tick
+    size_t ticks = 20;
+    uint32_t seed = 1;
+};
+
+using Proposals = std::vector<std::pair<NationId, NationId>>;
+
+/// @brief Grid of land provinces split onto bands of nations, with random wars and alliances.
+/// Only what the diplomacy of the AI looks at is filled in
+static void generate_world(World& world, const DiplomacyBenchConfig& config, size_t n_nations) {
+    Eng3D::Rand rand(config.seed);
+    Bench::generate_grid_world(world, n_nations * config.provinces_per_nation, n_nations);
+    for(size_t i = 0; i < world.nations.size(); i++) {
+        for(size_t j = 0; j < i; j++) {
+            auto& relation = world.get_relation(NationId(i), NationId(j));
+            relation.relation = static_cast<float>(rand() % 200) / 100.f - 1.f;
+        }
+    }
+    const auto alliances = config.alliances > 0 ? config.alliances : n_nations / 5;
+    for(size_t i = 0; i < alliances && world.nations.size() > 1; i++) {
+        const auto a = NationId(rand() % world.nations.size());
+        const auto b = NationId(rand() % world.nations.size());
+        if(a != b) world.get_relation(a, b).alliance = 1.f;
+    }
+    const auto wars = config.wars > 0 ? config.wars : n_nations / 10;
+    for(size_t i = 0; i < wars && world.nations.size() > 1; i++) {
+        const auto a = NationId(rand() % world.nations.size());
+        const auto b = NationId((static_cast<size_t>(a) + 1 + rand() % 4) % world.nations.size());
+        if(a == b) continue;
+        auto& relation = world.get_relation(a, b);
+        relation.alliance = 0.f;
+        relation.has_war = true;
+    }
+}
+
+/// @brief What the AI of each nation did before the index: look at every other
+/// nation for its enemies and allies, and again for anyone sharing an enemy
+static void reference_diplomacy(const World& world, const std::vector<float>& strengths, float strength_threshold, Proposals& proposals) {
+    for(const auto& nation : world.nations) {
+        if(!nation.exists()) continue;
+        auto our_strength = strengths[nation];
+        auto enemy_strength = 0.f;
+        std::vector<NationId> enemy_ids;
+        for(const auto& other : world.nations) {
+            if(other.get_id() != nation.get_id()) {
+                const auto& relation = world.get_relation(nation, other);
+                if(relation.has_war) {
+                    enemy_strength += strengths[other];
+                    enemy_ids.push_back(other);
+                } else if(relation.is_allied()) {
+                    our_strength += strengths[other];
+                }
+            }
+        }
+        const auto advantage = std::max(our_strength, 1.f) / std::max(enemy_strength, 1e-6f);
+        if(advantage >= strength_threshold) continue;
+        for(const auto& other : world.nations) {
+            if(other.get_id() != nation.get_id() && !world.get_relation(nation, other).has_war)
+                for(const auto enemy_id : enemy_ids)
+                    if(world.get_relation(other, enemy_id).has_war)
+                        proposals.emplace_back(nation, other);
+        }
+    }
+}
+
+/// @brief The same decisions, as the diplomacy phase of the AI takes them now
+static void indexed_diplomacy(const World& world, const std::vector<float>& strengths, float strength_threshold, Proposals& proposals) {
+    for(const auto& nation : world.nations) {
+        if(!nation.exists()) continue;
+        auto our_strength = strengths[nation];
+        auto enemy_strength = 0.f;
+        const auto& enemy_ids = diplomacy_index.get_enemies(nation);
+        for(const auto enemy_id : enemy_ids)
+            enemy_strength += strengths[enemy_id];
+        for(const auto ally_id : diplomacy_index.get_allies(nation))
+            our_strength += strengths[ally_id];
+        const auto advantage = std::max(our_strength, 1.f) / std::max(enemy_strength, 1e-6f);
+        if(advantage >= strength_threshold) continue;
+        diplomacy_index.for_each_candidate(nation, [&](const NationId other_id) {
+            if(!world.get_relation(nation, other_id).has_war)
+                for(const auto enemy_id : enemy_ids)
+                    if(world.get_relation(other_id, enemy_id).has_war)
+                        proposals.emplace_back(nation, other_id);
+        });
+    }
+}
+
+/// @brief Start or end some wars and alliances and hand some provinces over, telling the
+/// index the same way Nation::declare_war and Nation::control_province do
+static void change_world(World& world, Eng3D::Rand& rand, size_t changes) {
+    const auto n_nations = world.nations.size();
+    for(size_t i = 0; i < changes && n_nations > 1; i++) {
+        const auto a = NationId(rand() % n_nations);
+        const auto b = NationId((static_cast<size_t>(a) + 1 + rand() % 4) % n_nations);
+        if(a == b) continue;
+        auto& relation = world.get_relation(a, b);
+        if(rand() % 2 == 0) {
+            relation.has_war = !relation.has_war;
+            relation.alliance = 0.f;
+        } else if(!relation.has_war) {
+            relation.alliance = relation.is_allied() ? 0.f : 1.f;
+        }
+        diplomacy_index.on_relation_change(a, b);
+    }
+
+    for(size_t i = 0; i < changes; i++) {
+        auto& province = world.provinces[rand() % world.provinces.size()];
+        if(province.neighbour_ids.empty()) continue;
+        const auto new_controller_id = world.provinces[province.neighbour_ids[rand() % province.neighbour_ids.size()]].controller_id;
+        const auto old_controller_id = province.controller_id;
+        if(new_controller_id == old_controller_id) continue;
+        std::erase(world.nations[old_controller_id].controlled_provinces, province.get_id());
+        world.nations[new_controller_id].controlled_provinces.push_back(province);
+        province.controller_id = new_controller_id;
+        diplomacy_index.on_control_change(world, province, old_controller_id, new_controller_id);
+    }
+}
+
+static bool parse_arguments(int argc, char** argv, DiplomacyBenchConfig& config) {
+    Bench::Arguments arguments("diplomacy_bench");
+    arguments.add_list("--nations", config.nations);
+    arguments.add("--provinces-per-nation", config.provinces_per_nation);
+    arguments.add("--wars", config.wars);
+    arguments.add("--alliances", config.alliances);
+    arguments.add("--changes", config.changes);
+    arguments.add("--ticks", config.ticks);
+    arguments.add("--seed", config.seed);
+    if(!arguments.parse(argc, argv))
+        return false;
+    if(config.provinces_per_nation == 0 || config.ticks == 0 || std::count(config.nations.begin(), config.nations.end(), 0))
+        CXX_THROW(std::runtime_error, "Nations, provinces and ticks can't be zero");
+    return true;
+}
+
+int main(int argc, char** argv) {
+    return Bench::run("diplomacy_bench", [&] {
+        DiplomacyBenchConfig config{};
+        if(!parse_arguments(argc, argv, config))
+            return 0;
+
+        Eng3D::StringManager string_man;
+        auto& world = World::get_instance();
+        size_t total_mismatches = 0;
+        for(const auto n_nations : config.nations) {
+            generate_world(world, config, n_nations);
+            Eng3D::Rand rand(config.seed);
+            std::vector<float> strengths(n_nations);
+            diplomacy_index.invalidate();
+            const auto build_ms = Bench::time_ms([&] {
+                diplomacy_index.update(world, strengths);
+            });
+
+            // Worst case, every nation thinks its enemies are stronger and re-evaluates its stances
+            const auto strength_threshold = std::numeric_limits<float>::max();
+            double reference_ms = 0.0, update_ms = 0.0, query_ms = 0.0;
+            size_t refreshed = 0, proposals = 0, mismatches = 0;
+            Proposals reference_proposals, indexed_proposals;
+            for(size_t tick = 0; tick < config.ticks; tick++) {
+                change_world(world, rand, config.changes);
+                for(auto& strength : strengths)
+                    strength = static_cast<float>(rand() % 10000);
+                reference_proposals.clear();
+                indexed_proposals.clear();
+                reference_ms += Bench::time_ms([&] {
+                    reference_diplomacy(world, strengths, strength_threshold, reference_proposals);
+                });
+                update_ms += Bench::time_ms([&] {
+                    diplomacy_index.update(world, strengths);
+                });
+                refreshed += diplomacy_index.get_refreshed();
+                query_ms += Bench::time_ms([&] {
+                    indexed_diplomacy(world, strengths, strength_threshold, indexed_proposals);
+                });
+
+                // Order doesn't matter since proposals are gathered from many threads
+                std::sort(reference_proposals.begin(), reference_proposals.end());
+                std::sort(indexed_proposals.begin(), indexed_proposals.end());
+                proposals += reference_proposals.size();
+                if(reference_proposals != indexed_proposals)
+                    mismatches++;
+            }
+
+            // What was kept up to date change by change must match an index built from scratch
+            DiplomacyIndex rebuilt{};
+            rebuilt.update(world, strengths);
+            for(const auto& nation : world.nations)
+                if(rebuilt.get_enemies(nation) != diplomacy_index.get_enemies(nation) || rebuilt.get_allies(nation) != diplomacy_index.get_allies(nation)
+                    || rebuilt.get_neighbours(nation) != diplomacy_index.get_neighbours(nation) || rebuilt.get_candidates(nation) != diplomacy_index.get_candidates(nation))
+                    mismatches++;
+
+            const auto indexed_ms = update_ms + query_ms;
+            printf("{ \"nations\": %zu, \"provinces\": %zu, \"changes\": %zu, \"ticks\": %zu, \"build_ms\": %.3f, \"reference_ms\": %.3f, \"update_ms\": %.3f, \"query_ms\": %.3f, \"speedup\": %.2f, \"refreshed\": %.1f, \"proposals\": %.1f, \"mismatches\": %zu }\n",
+                n_nations, world.provinces.size(), config.changes, config.ticks, build_ms,
+                reference_ms / config.ticks, update_ms / config.ticks, query_ms / config.ticks, reference_ms / std::max(indexed_ms, 1e-9),
+                static_cast<double>(refreshed) / config.ticks, static_cast<double>(proposals) / config.ticks, mismatches);
+            total_mismatches += mismatches;
+        }
+        return total_mismatches == 0 ? 0 : 1;
+    });
+}
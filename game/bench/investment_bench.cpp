@@ -0,0 +1,291 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      bench/investment_bench.cpp
+//
+// Abstract:
+//      Compares the investments of the AI popped off the investment index
+//      against every province sorting its commodities on every tick.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "eng3d/string.hpp"
+#include "eng3d/rand.hpp"
+
+#include "world.hpp"
+#include "server/investment_index.hpp"
+#include "bench_fixture.hpp"
+
+/// @brief Shape of the synthetic world
+struct InvestmentBenchConfig {
+    size_t provinces = 10'000;
+    size_t nations = 200;
+    size_t commodities = 40;
+    size_t building_types = 50; // The ones past the commodities make the same as another one
+    float volatility = 0.01f; // Relative noise on every market between each tick
+    float shocks = 0.005f; // Ratio of markets that move a lot between each tick
+    size_t changes = 50; // Buildings whose budget or level changes, and provinces that change hands
+    size_t ticks = 20;
+    uint32_t seed = 1;
+};
+
+/// @brief Grid of provinces split onto bands of nations, with random markets and buildings.
+/// Only what the investments of the AI look at is filled in
+static void generate_world(World& world, const InvestmentBenchConfig& config) {
+    Eng3D::Rand rand(config.seed);
+    const auto rand_float = [&rand]() {
+        return static_cast<float>(rand()) / static_cast<float>(Eng3D::Rand::max());
+    };
+
+    for(size_t i = 0; i < config.commodities; i++) {
+        Commodity commodity{};
+        commodity.ref_name = string_format("commodity_%zu", i);
+        commodity.name = commodity.ref_name;
+        world.insert(commodity);
+    }
+    for(size_t i = 0; i < config.building_types; i++) {
+        BuildingType building_type{};
+        building_type.ref_name = string_format("building_%zu", i);
+        building_type.name = building_type.ref_name;
+        // A few commodities aren't made by any building
+        if(i % 8 != 7)
+            building_type.output_id = CommodityId(i % config.commodities);
+        world.insert(building_type);
+    }
+    Bench::generate_grid_world(world, config.provinces, config.nations, [&](Province& province) {
+        province.products.resize(world.commodities.size());
+        for(auto& product : province.products) {
+            product.supply = rand_float() < 0.2f ? 0.f : rand_float() * 1000.f;
+            product.demand = rand_float() < 0.1f ? 0.f : rand_float() * 1000.f;
+        }
+        province.buildings.resize(world.building_types.size());
+        for(auto& building : province.buildings) {
+            building.level = static_cast<float>(rand() % 4);
+            building.budget = rand_float() * 2000.f - 1000.f;
+        }
+    });
+}
+
+/// @brief Markets drift a bit everywhere and a lot in a few places, some buildings
+/// run out of money or get upgraded, and some provinces change hands, as the economy would
+static void change_world(World& world, Eng3D::Rand& rand, const InvestmentBenchConfig& config) {
+    const auto rand_float = [&rand]() {
+        return static_cast<float>(rand()) / static_cast<float>(Eng3D::Rand::max());
+    };
+    for(auto& province : world.provinces) {
+        for(auto& product : province.products) {
+            const auto scale = rand_float() < config.shocks ? 0.5f + rand_float() : 1.f;
+            product.supply *= scale * (1.f + config.volatility * (rand_float() * 2.f - 1.f));
+            product.demand *= 1.f + config.volatility * (rand_float() * 2.f - 1.f);
+        }
+    }
+    for(size_t i = 0; i < config.changes; i++) {
+        auto& building = world.provinces[rand() % world.provinces.size()].buildings[rand() % world.building_types.size()];
+        if(rand() % 2 == 0) building.budget = -building.budget;
+        else building.level += 1.f;
+    }
+    for(size_t i = 0; i < config.changes && world.nations.size() > 1; i++) {
+        auto& province = world.provinces[rand() % world.provinces.size()];
+        const auto old_controller_id = province.controller_id;
+        const auto new_controller_id = NationId((static_cast<size_t>(old_controller_id) + 1) % world.nations.size());
+        std::erase(world.nations[old_controller_id].controlled_provinces, province.get_id());
+        world.nations[new_controller_id].controlled_provinces.push_back(province);
+        province.controller_id = new_controller_id;
+    }
+}
+
+/// @brief What the AI of each nation did before the index: sort the commodities of
+/// every province it controls and look for the building type making each of them
+static size_t reference_investments(const World& world, float alloc) {
+    std::atomic<size_t> investments = 0;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, world.nations.size()), [&](const auto& range) {
+        for(size_t i = range.begin(); i != range.end(); i++) {
+            const auto& nation = world.nations[i];
+            size_t nation_investments = 0;
+            for(const auto province_id : nation.controlled_provinces) {
+                const auto& province = world.provinces[province_id];
+                std::vector<CommodityId> v(world.commodities.size());
+                for(const auto& commodity : world.commodities)
+                    v[commodity] = commodity;
+                std::sort(v.begin(), v.end(), [&](const auto& a, const auto& b) {
+                    return province.products[a].sd_ratio() > province.products[b].sd_ratio();
+                });
+                const auto total_demand = std::accumulate(province.products.begin(), province.products.end(), 0.f, [](const auto a, const auto& product) {
+                    return a + product.demand;
+                });
+                auto investment_alloc = alloc;
+                for(const auto& commodity_id : v) {
+                    if(investment_alloc <= 0.f) break;
+                    const auto it = std::find_if(world.building_types.begin(), world.building_types.end(), [&](const auto& e) {
+                        return e.output_id.has_value() && e.output_id.value() == commodity_id;
+                    });
+                    if(it == world.building_types.end()) continue;
+                    if(province.buildings[*it].budget > 0.f) continue;
+                    const auto& product = province.products[commodity_id];
+                    if(product.demand == 0.f) continue;
+                    investment_alloc -= investment_alloc * product.demand / total_demand;
+                    nation_investments++;
+                }
+            }
+            investments += nation_investments;
+        }
+    });
+    return investments;
+}
+
+/// @brief What the economy does once it's done with each province
+static void check_provinces(const World& world, InvestmentIndex& index) {
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, world.provinces.size()), [&](const auto& range) {
+        for(size_t i = range.begin(); i != range.end(); i++)
+            index.on_economy_tick(world.provinces[i]);
+    });
+}
+
+/// @brief The investments as the AI makes them now, popping the heap of each nation
+static size_t indexed_investments(const World& world, const InvestmentIndex& index, float alloc) {
+    std::atomic<size_t> investments = 0;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, world.nations.size()), [&](const auto& range) {
+        for(size_t i = range.begin(); i != range.end(); i++) {
+            const auto& nation = world.nations[i];
+            auto heap = index.get_heap(nation);
+            auto investment_alloc = alloc;
+            size_t nation_investments = 0;
+            while(!heap.empty() && investment_alloc > 0.f) {
+                std::pop_heap(heap.begin(), heap.end());
+                const auto opportunity = heap.back();
+                heap.pop_back();
+                const auto& province = world.provinces[opportunity.province_id];
+                if(province.controller_id != nation.get_id() || province.buildings[opportunity.building_type_id].budget > 0.f) continue;
+                investment_alloc -= investment_alloc * opportunity.priority;
+                nation_investments++;
+            }
+            investments += nation_investments;
+        }
+    });
+    return investments;
+}
+
+static bool same_heaps(const World& world, const InvestmentIndex& a, const InvestmentIndex& b, size_t& mismatches) {
+    const auto key = [](const auto& e) {
+        return std::make_pair(e.province_id, e.building_type_id);
+    };
+    for(const auto& nation : world.nations) {
+        auto x = a.get_heap(nation), y = b.get_heap(nation);
+        std::sort_heap(x.begin(), x.end());
+        std::sort_heap(y.begin(), y.end());
+        if(x.size() != y.size() || !std::equal(x.begin(), x.end(), y.begin(), [&](const auto& l, const auto& r) { return key(l) == key(r); }))
+            mismatches++;
+    }
+    return mismatches == 0;
+}
+
+static bool parse_arguments(int argc, char** argv, InvestmentBenchConfig& config) {
+    Bench::Arguments arguments("investment_bench");
+    arguments.add("--provinces", config.provinces);
+    arguments.add("--nations", config.nations);
+    arguments.add("--commodities", config.commodities);
+    arguments.add("--building-types", config.building_types);
+    arguments.add("--changes", config.changes);
+    arguments.add("--ticks", config.ticks);
+    arguments.add("--seed", config.seed);
+    if(!arguments.parse(argc, argv))
+        return false;
+    if(config.provinces == 0 || config.nations == 0 || config.commodities == 0 || config.building_types == 0 || config.ticks == 0)
+        CXX_THROW(std::runtime_error, "Provinces, nations, commodities, building types and ticks can't be zero");
+    config.nations = std::min(config.nations, config.provinces);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    return Bench::run("investment_bench", [&] {
+        InvestmentBenchConfig config{};
+        if(!parse_arguments(argc, argv, config))
+            return 0;
+
+        Eng3D::StringManager string_man;
+        auto& world = World::get_instance();
+        generate_world(world, config);
+        const auto build_ms = Bench::time_ms([&] {
+            investment_index.update(world);
+        });
+        // Same index scoring again on any change, to tell apart what the threshold leaves stale
+        InvestmentIndex exact{};
+        exact.refresh_threshold = 0.f;
+        exact.update(world);
+
+        Eng3D::Rand rand(config.seed);
+        constexpr auto alloc = 1000.f;
+        double reference_ms = 0.0, check_ms = 0.0, update_ms = 0.0, query_ms = 0.0;
+        size_t refreshed = 0, churn = 0, reference_count = 0, count = 0, kept = 0, kept_total = 0;
+        for(size_t tick = 0; tick < config.ticks; tick++) {
+            change_world(world, rand, config);
+            reference_ms += Bench::time_ms([&] {
+                reference_count += reference_investments(world, alloc);
+            });
+            // The economy has the province in cache when checking it, here it's cold
+            check_ms += Bench::time_ms([&] {
+                check_provinces(world, investment_index);
+            });
+            update_ms += Bench::time_ms([&] {
+                investment_index.update(world);
+            });
+            refreshed += investment_index.get_refreshed();
+            churn += investment_index.get_churn();
+            query_ms += Bench::time_ms([&] {
+                count += indexed_investments(world, investment_index, alloc);
+            });
+
+            // How many of the best buildings are still picked despite not scoring every change
+            check_provinces(world, exact);
+            exact.update(world);
+            for(const auto& nation : world.nations) {
+                const auto& heap = investment_index.get_heap(nation);
+                const auto& exact_heap = exact.get_heap(nation);
+                kept_total += exact_heap.size();
+                kept += std::count_if(exact_heap.begin(), exact_heap.end(), [&heap](const auto& e) {
+                    return std::any_of(heap.begin(), heap.end(), [&e](const auto& x) {
+                        return x.province_id == e.province_id && x.building_type_id == e.building_type_id;
+                    });
+                });
+            }
+        }
+
+        // What was scored change by change must match an index scored from scratch
+        size_t mismatches = 0;
+        InvestmentIndex rebuilt{};
+        rebuilt.update(world);
+        same_heaps(world, exact, rebuilt, mismatches);
+
+        const auto indexed_ms = check_ms + update_ms + query_ms;
+        const auto heap_slots = static_cast<double>(config.nations * investment_index.top_k);
+        printf("{ \"provinces\": %zu, \"nations\": %zu, \"commodities\": %zu, \"building_types\": %zu, \"ticks\": %zu, \"build_ms\": %.3f, \"reference_ms\": %.3f, \"check_ms\": %.3f, \"update_ms\": %.3f, \"query_ms\": %.3f, \"speedup\": %.2f, \"refreshed\": %.1f, \"churn\": %.4f, \"reference_investments\": %.1f, \"investments\": %.1f, \"agreement\": %.3f, \"mismatches\": %zu }\n",
+            config.provinces, config.nations, config.commodities, config.building_types, config.ticks, build_ms,
+            reference_ms / config.ticks, check_ms / config.ticks, update_ms / config.ticks, query_ms / config.ticks, reference_ms / std::max(indexed_ms, 1e-9),
+            static_cast<double>(refreshed) / config.ticks, static_cast<double>(churn) / config.ticks / heap_slots,
+            static_cast<double>(reference_count) / config.ticks, static_cast<double>(count) / config.ticks,
+            kept_total > 0 ? static_cast<double>(kept) / kept_total : 1.0, mismatches);
+        return mismatches == 0 ? 0 : 1;
+    });
+}
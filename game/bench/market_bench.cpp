@@ -0,0 +1,216 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      bench/market_bench.cpp
+//
+// Abstract:
+//      Benchmark of the market clearing over synthetic markets, checked
+//      against the per-province clearing it replaces.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "eng3d/string.hpp"
+#include "eng3d/rand.hpp"
+
+#include "world.hpp"
+#include "server/market_clearing.hpp"
+#include "bench_fixture.hpp"
+
+/// @brief Shape of the synthetic markets
+struct MarketBenchConfig {
+    size_t provinces = 5'000;
+    size_t nations = 100;
+    size_t commodities = 16;
+    size_t iterations = 20;
+    float coastal_ratio = 0.1f; // Provinces that aren't cleared, like the coastal ones of the game
+    uint32_t seed = 1;
+};
+
+/// @brief Provinces on a grid split onto nations of random sizes, with markets
+/// of random prices, supplies and demands
+struct SyntheticMarkets {
+    std::vector<NationId> owners;
+    std::vector<std::vector<ProvinceId>> owned_provinces;
+    std::vector<ProvinceId> cost_eval;
+    std::vector<std::vector<float>> trade_costs;
+    std::vector<Economy::Market> markets;
+};
+
+static SyntheticMarkets generate_markets(const MarketBenchConfig& config) {
+    Eng3D::Rand rand(config.seed);
+    const auto rand_float = [&rand]() {
+        return static_cast<float>(rand()) / static_cast<float>(Eng3D::Rand::max());
+    };
+
+    SyntheticMarkets synthetic{};
+    synthetic.owners.resize(config.provinces);
+    synthetic.owned_provinces.resize(config.nations);
+    // Nations own contiguous runs of provinces, a few are much bigger than the rest
+    size_t nation_id = 0;
+    for(size_t i = 0; i < config.provinces; i++) {
+        if(i > 0 && nation_id + 1 < config.nations && rand_float() < static_cast<float>(config.nations) / config.provinces)
+            nation_id++;
+        synthetic.owners[i] = NationId(nation_id);
+        synthetic.owned_provinces[nation_id].push_back(ProvinceId(i));
+        if(rand_float() >= config.coastal_ratio)
+            synthetic.cost_eval.push_back(ProvinceId(i));
+    }
+
+    const auto width = static_cast<size_t>(std::ceil(std::sqrt(static_cast<float>(config.provinces))));
+    synthetic.trade_costs.assign(config.provinces, std::vector<float>(config.provinces, 0.f));
+    tbb::parallel_for(static_cast<size_t>(0), config.provinces, [&](const auto province_id) {
+        for(size_t i = 0; i < config.provinces; i++) {
+            const auto dx = static_cast<float>(province_id % width) - static_cast<float>(i % width);
+            const auto dy = static_cast<float>(province_id / width) - static_cast<float>(i / width);
+            synthetic.trade_costs[province_id][i] = std::sqrt(dx * dx + dy * dy);
+        }
+    });
+
+    synthetic.markets.resize(config.commodities);
+    for(size_t i = 0; i < config.commodities; i++) {
+        auto& market = synthetic.markets[i];
+        market.commodity = CommodityId(i);
+        market.price.resize(config.provinces);
+        market.supply.resize(config.provinces);
+        market.demand.resize(config.provinces);
+        market.global_demand.assign(config.provinces, 0.f);
+        for(size_t j = 0; j < config.provinces; j++) {
+            market.price[j] = 0.5f + rand_float() * 10.f;
+            market.supply[j] = rand_float() < 0.2f ? 0.f : rand_float() * 1000.f;
+            market.demand[j] = rand_float() * 1000.f;
+        }
+    }
+    return synthetic;
+}
+
+/// @brief Same grouping as the economy, one trade group per nation
+static std::vector<Economy::TradeGroup> make_trade_groups(const SyntheticMarkets& synthetic) {
+    std::vector<Economy::TradeGroup> groups(synthetic.owned_provinces.size());
+    for(const auto province_id : synthetic.cost_eval)
+        groups[synthetic.owners[province_id]].destinations.push_back(province_id);
+    tbb::parallel_for(static_cast<size_t>(0), groups.size(), [&](const auto nation_id) {
+        auto& group = groups[nation_id];
+        if(group.destinations.empty()) return;
+        group.members = synthetic.owned_provinces[nation_id];
+        group.costs.resize(group.destinations.size() * group.members.size());
+        auto* costs = group.costs.data();
+        for(const auto province_id : group.destinations)
+            for(const auto other_province_id : group.members)
+                *(costs++) = 0.01f * synthetic.trade_costs[province_id][other_province_id] + glm::epsilon<float>();
+    });
+    std::erase_if(groups, [](const auto& group) { return group.destinations.empty(); });
+    return groups;
+}
+
+/// @brief Clearing as the economy did it before, a province at a time through the
+/// whole trade cost matrix
+static void clear_reference(const SyntheticMarkets& synthetic, std::vector<Economy::Market>& markets, float price_change_speed) {
+    tbb::parallel_for(tbb::blocked_range(markets.begin(), markets.end()), [&](const auto& markets_range) {
+        std::vector<float> values(synthetic.owners.size(), 0.f);
+        for(auto& market : markets_range) {
+            for(const auto province_id : synthetic.cost_eval) {
+                const auto& owned_provinces = synthetic.owned_provinces[synthetic.owners[province_id]];
+                auto sum_weightings = 0.f;
+                for(const auto other_province_id : owned_provinces) {
+                    auto apparent_price = market.price[other_province_id] + 0.01f * synthetic.trade_costs[province_id][other_province_id];
+                    apparent_price += glm::epsilon<float>();
+                    values[other_province_id] = market.supply[other_province_id] / (apparent_price * apparent_price);
+                    sum_weightings += values[other_province_id];
+                }
+                if(sum_weightings == 0.f) continue;
+                for(const auto other_province_id : owned_provinces)
+                    market.global_demand[province_id] += market.demand[other_province_id] * values[other_province_id] / sum_weightings;
+            }
+            for(const auto province_id : synthetic.cost_eval) {
+                const auto price_factor = market.global_demand[province_id] / (market.supply[province_id] + 0.01f);
+                market.price[province_id] = market.price[province_id] * (1.f - price_change_speed) + (market.price[province_id] * price_factor) * price_change_speed;
+            }
+        }
+    });
+}
+
+static bool parse_arguments(int argc, char** argv, MarketBenchConfig& config) {
+    Bench::Arguments arguments("market_bench");
+    arguments.add("--provinces", config.provinces);
+    arguments.add("--nations", config.nations);
+    arguments.add("--commodities", config.commodities);
+    arguments.add("--iterations", config.iterations);
+    arguments.add("--seed", config.seed);
+    if(!arguments.parse(argc, argv))
+        return false;
+    if(config.provinces == 0 || config.nations == 0 || config.commodities == 0 || config.iterations == 0)
+        CXX_THROW(std::runtime_error, "Provinces, nations, commodities and iterations can't be zero");
+    config.nations = std::min(config.nations, config.provinces);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    return Bench::run("market_bench", [&] {
+        MarketBenchConfig config{};
+        if(!parse_arguments(argc, argv, config))
+            return 0;
+
+        const auto trade_matrix_mb = static_cast<double>(config.provinces) * config.provinces * sizeof(float) / (1024.0 * 1024.0);
+        fprintf(stderr, "Trade cost matrix will use %.0f MB\n", trade_matrix_mb);
+        const auto synthetic = generate_markets(config);
+
+        Economy::MarketClearing clearing{};
+        const auto groups_ms = Bench::time_ms([&] {
+            clearing.set_groups(make_trade_groups(synthetic));
+        });
+
+        // Every iteration starts from the same markets, copying them isn't timed
+        double reference_ms = 0.0, clearing_ms = 0.0;
+        std::vector<Economy::Market> reference_markets, cleared_markets;
+        for(size_t i = 0; i < config.iterations; i++) {
+            reference_markets = synthetic.markets;
+            reference_ms += Bench::time_ms([&] {
+                clear_reference(synthetic, reference_markets, clearing.price_change_speed);
+            });
+            cleared_markets = synthetic.markets;
+            clearing_ms += Bench::time_ms([&] {
+                clearing.clear(cleared_markets);
+            });
+        }
+
+        // Sums are made in another order, so allow for some rounding
+        size_t mismatches = 0;
+        for(size_t i = 0; i < config.commodities; i++) {
+            for(const auto province_id : synthetic.cost_eval) {
+                const auto close = [](float a, float b) {
+                    return std::abs(a - b) <= 1e-3f * std::max(1.f, std::max(std::abs(a), std::abs(b)));
+                };
+                if(!close(reference_markets[i].global_demand[province_id], cleared_markets[i].global_demand[province_id])
+                || !close(reference_markets[i].price[province_id], cleared_markets[i].price[province_id]))
+                    mismatches++;
+            }
+        }
+
+        printf("{ \"provinces\": %zu, \"nations\": %zu, \"commodities\": %zu, \"iterations\": %zu, \"groups_ms\": %.3f, \"reference_ms\": %.3f, \"clearing_ms\": %.3f, \"speedup\": %.2f, \"mismatches\": %zu }\n",
+            config.provinces, config.nations, config.commodities, config.iterations, groups_ms,
+            reference_ms / config.iterations, clearing_ms / config.iterations, reference_ms / std::max(clearing_ms, 1e-9), mismatches);
+        return mismatches == 0 ? 0 : 1;
+    });
+}
@@ -0,0 +1,189 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      bench/pop_needs_bench.cpp
+//
+// Abstract:
+//      Benchmark of the consumption of the pops, checked against the per-pop
+//      evaluation of the needs it replaces.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "eng3d/string.hpp"
+#include "eng3d/rand.hpp"
+
+#include "world.hpp"
+#include "server/pop_needs.hpp"
+#include "bench_fixture.hpp"
+
+/// @brief Shape of the synthetic provinces
+struct PopNeedsBenchConfig {
+    size_t provinces = 20'000;
+    size_t commodities = 32;
+    size_t pop_types = 6;
+    size_t iterations = 20;
+    uint32_t seed = 1;
+};
+
+/// @brief Synthetic province, only what the consumption reads and writes
+struct SyntheticProvince {
+    std::array<Pop, 6> pops;
+    std::vector<PopNeed> pop_needs;
+    std::vector<Product> products;
+};
+
+/// @brief Consumption as the economy did it before, the needs of the pop type are
+/// normalized again for every pop. Empty pops are skipped rather than ending the province
+static float consume_reference(const std::vector<PopType>& pop_types, SyntheticProvince& province, float pop_tax, std::vector<float>& to_borrow) {
+    auto state_payment = 0.f;
+    for(size_t i = 0; i < province.pops.size(); i++) {
+        auto& pop_need = province.pop_needs[i];
+        const auto& pop = province.pops[i];
+        const auto& needs_amounts = pop_types[pop.type_id].basic_needs_amount;
+        to_borrow[i] = 0.f;
+        if(pop.size < 1.f) continue;
+
+        if(pop_need.budget > 0.f) {
+            const auto budget_alloc = pop_need.budget * 0.8f;
+            state_payment += budget_alloc * pop_tax;
+            const auto budget_per_pop = budget_alloc * (1.f - pop_tax) / pop.size;
+            auto total_factor = std::reduce(needs_amounts.begin(), needs_amounts.end());
+            for(size_t j = 0; j < province.products.size(); j++) {
+                if(needs_amounts[j] <= 0.f) continue;
+                auto& product = province.products[j];
+                const auto need_factor = needs_amounts[j] / total_factor;
+                const auto wanted_amount = glm::clamp((budget_per_pop * need_factor) / product.price, 0.f, pop.size * need_factor);
+                auto amount = 0.f;
+                pop_need.budget -= product.buy(wanted_amount, amount);
+                pop_need.life_needs_met += (amount / pop.size) * need_factor;
+            }
+        }
+        pop_need.life_needs_met = glm::clamp(pop_need.life_needs_met, -1.f, 1.f);
+        if(pop_need.life_needs_met < 0.f) {
+            auto total_to_borrow = 0.f;
+            for(size_t j = 0; j < province.products.size(); j++)
+                total_to_borrow += pop.size * needs_amounts[j] * province.products[j].price;
+            to_borrow[i] = total_to_borrow;
+        }
+    }
+    return state_payment;
+}
+
+static bool parse_arguments(int argc, char** argv, PopNeedsBenchConfig& config) {
+    Bench::Arguments arguments("pop_needs_bench");
+    arguments.add("--provinces", config.provinces);
+    arguments.add("--commodities", config.commodities);
+    arguments.add("--pop-types", config.pop_types);
+    arguments.add("--iterations", config.iterations);
+    arguments.add("--seed", config.seed);
+    if(!arguments.parse(argc, argv))
+        return false;
+    if(config.provinces == 0 || config.commodities == 0 || config.pop_types == 0 || config.iterations == 0)
+        CXX_THROW(std::runtime_error, "Provinces, commodities, pop types and iterations can't be zero");
+    return true;
+}
+
+int main(int argc, char** argv) {
+    return Bench::run("pop_needs_bench", [&] {
+        PopNeedsBenchConfig config{};
+        if(!parse_arguments(argc, argv, config))
+            return 0;
+
+        Eng3D::Rand rand(config.seed);
+        const auto rand_float = [&rand]() {
+            return static_cast<float>(rand()) / static_cast<float>(Eng3D::Rand::max());
+        };
+        // Each pop type needs a handful of the commodities
+        std::vector<PopType> pop_types(config.pop_types);
+        for(size_t i = 0; i < config.pop_types; i++) {
+            pop_types[i].cached_id = PopTypeId(i);
+            pop_types[i].basic_needs_amount.assign(config.commodities, 0.f);
+            for(auto& amount : pop_types[i].basic_needs_amount)
+                if(rand_float() < 0.25f)
+                    amount = rand_float() * 4.f;
+        }
+        std::vector<SyntheticProvince> provinces(config.provinces);
+        for(auto& province : provinces) {
+            for(size_t i = 0; i < province.pops.size(); i++) {
+                province.pops[i].type_id = PopTypeId(rand() % config.pop_types);
+                province.pops[i].size = rand_float() < 0.1f ? 0.f : rand_float() * 10'000.f;
+            }
+            province.pop_needs.resize(province.pops.size());
+            for(auto& pop_need : province.pop_needs)
+                pop_need = PopNeed{ rand_float() * 2.f - 1.f, rand_float() * 100'000.f, 0.f };
+            province.products.resize(config.commodities);
+            for(auto& product : province.products) {
+                product.price = 0.5f + rand_float() * 10.f;
+                product.supply = rand_float() * 5'000.f;
+            }
+        }
+
+        Economy::PopNeedsTable table{};
+        const auto table_ms = Bench::time_ms([&] {
+            table.build(pop_types, config.commodities);
+        });
+
+        // Every iteration starts from the same provinces, copying them isn't timed
+        double reference_ms = 0.0, table_kernel_ms = 0.0;
+        size_t mismatches = 0;
+        std::vector<float> reference_borrow(6), kernel_borrow(6);
+        std::vector<SyntheticProvince> reference_provinces, kernel_provinces;
+        for(size_t i = 0; i < config.iterations; i++) {
+            // Pops can't be assigned, only copied
+            reference_provinces = std::vector<SyntheticProvince>(provinces);
+            kernel_provinces = std::vector<SyntheticProvince>(provinces);
+            std::vector<float> reference_payments(config.provinces), kernel_payments(config.provinces);
+            std::vector<float> reference_borrows(config.provinces * 6), kernel_borrows(config.provinces * 6);
+            reference_ms += Bench::time_ms([&] {
+                for(size_t j = 0; j < config.provinces; j++) {
+                    reference_payments[j] = consume_reference(pop_types, reference_provinces[j], 0.1f, reference_borrow);
+                    std::copy(reference_borrow.begin(), reference_borrow.end(), reference_borrows.begin() + j * 6);
+                }
+            });
+            table_kernel_ms += Bench::time_ms([&] {
+                for(size_t j = 0; j < config.provinces; j++) {
+                    auto& province = kernel_provinces[j];
+                    Economy::consume_pop_needs(table, province.pops, province.pop_needs, province.products, 0.1f, kernel_payments[j], std::span<float>(kernel_borrows.data() + j * 6, 6));
+                }
+            });
+
+            // Same operations in the same order, so the results must be equal to the bit
+            for(size_t j = 0; j < config.provinces; j++) {
+                bool same = reference_payments[j] == kernel_payments[j];
+                for(size_t k = 0; k < 6; k++) {
+                    same = same && reference_provinces[j].pop_needs[k].budget == kernel_provinces[j].pop_needs[k].budget
+                        && reference_provinces[j].pop_needs[k].life_needs_met == kernel_provinces[j].pop_needs[k].life_needs_met
+                        && reference_borrows[j * 6 + k] == kernel_borrows[j * 6 + k];
+                }
+                for(size_t k = 0; k < config.commodities; k++)
+                    same = same && reference_provinces[j].products[k].bought == kernel_provinces[j].products[k].bought
+                        && reference_provinces[j].products[k].demand == kernel_provinces[j].products[k].demand;
+                if(!same) mismatches++;
+            }
+        }
+
+        printf("{ \"provinces\": %zu, \"commodities\": %zu, \"pop_types\": %zu, \"iterations\": %zu, \"table_ms\": %.3f, \"reference_ms\": %.3f, \"kernel_ms\": %.3f, \"speedup\": %.2f, \"mismatches\": %zu }\n",
+            config.provinces, config.commodities, config.pop_types, config.iterations, table_ms,
+            reference_ms / config.iterations, table_kernel_ms / config.iterations, reference_ms / std::max(table_kernel_ms, 1e-9), mismatches);
+        return mismatches == 0 ? 0 : 1;
+    });
+}
@@ -0,0 +1,548 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      bench/sim_bench.cpp
+//
+// Abstract:
+//      Headless benchmark of the world tick over synthetic worlds.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <memory>
+
+#include "eng3d/string.hpp"
+#include "eng3d/log.hpp"
+#include "eng3d/rand.hpp"
+#include "eng3d/utils.hpp"
+#include "eng3d/heap_ext.hpp"
+#include "eng3d/chunked_archive.hpp"
+
+#include "world.hpp"
+#include "server/replay.hpp"
+
+namespace AI {
+    void init(World& world);
+}
+
+/// @brief Shape of the synthetic world
+struct SimBenchConfig {
+    size_t provinces = 5'000;
+    size_t nations = 100;
+    size_t commodities = 16;
+    size_t building_types = 8;
+    size_t languages = 8;
+    size_t religions = 4;
+    size_t units = 1'000;
+    size_t wars = 10; // Pairs of nations at war
+    float pop_size = 10'000.f; // Size of each of the pops of a province
+    size_t ticks = 100;
+    size_t warmup_ticks = 5;
+    uint32_t seed = 1;
+    std::string json_path;
+    std::string save_path; // Benchmark saving and loading the world after the ticks
+    std::string record_path; // Record the measured ticks onto a replay
+    std::string replay_path; // Play back a replay instead of generating a world
+    size_t checkpoint_interval = 10; // Ticks between the world hashes of a recording
+};
+
+/// @brief Timings of a single phase (profiler zone) over all the measured ticks
+struct PhaseSamples {
+    std::vector<double> times_ms;
+    size_t allocations = 0;
+};
+
+static double percentile(std::vector<double> values, double p) {
+    if(values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const auto index = static_cast<size_t>(std::ceil(p * values.size())) - 1;
+    return values[std::min(index, values.size() - 1)];
+}
+
+static std::string json_escape(const std::string_view str) {
+    std::string out;
+    for(const auto c : str) {
+        if(c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+/// @brief Populate the world with a grid of land provinces split between nations,
+/// there are no map tiles since nothing is rendered, neighbours are the adjacent cells
+static void generate_world(World& world, const SimBenchConfig& config) {
+    Eng3D::Rand rand(config.seed);
+    const auto rand_float = [&rand]() {
+        return static_cast<float>(rand()) / static_cast<float>(Eng3D::Rand::max());
+    };
+
+    TerrainType land{};
+    land.ref_name = "land";
+    land.name = "Land";
+    land.penalty = 1.f;
+    world.insert(land);
+
+    for(size_t i = 0; i < config.commodities; i++) {
+        Commodity commodity{};
+        commodity.ref_name = string_format("commodity_%zu", i);
+        commodity.name = commodity.ref_name;
+        world.insert(commodity);
+    }
+
+    for(size_t i = 0; i < config.languages; i++) {
+        Language language{};
+        language.ref_name = string_format("language_%zu", i);
+        language.name = language.adjective = language.noun = language.combo_form = language.ref_name;
+        language.color = rand() | 0xff000000;
+        world.insert(language);
+    }
+
+    for(size_t i = 0; i < config.religions; i++) {
+        Religion religion{};
+        religion.ref_name = string_format("religion_%zu", i);
+        religion.name = religion.ref_name;
+        religion.color = rand() | 0xff000000;
+        world.insert(religion);
+    }
+
+    Ideology ideology{};
+    ideology.ref_name = "ideology_0";
+    ideology.name = ideology.ref_name;
+    Ideology::Subideology subideology{};
+    subideology.ref_name = "subideology_0";
+    subideology.name = subideology.ref_name;
+    ideology.subideologies.push_back(subideology);
+    world.insert(ideology);
+
+    // One pop type per pop group, every one of them needs a couple of commodities
+    for(size_t i = 0; i < 6; i++) {
+        PopType pop_type{};
+        pop_type.ref_name = string_format("pop_type_%zu", i);
+        pop_type.name = pop_type.ref_name;
+        pop_type.basic_needs_amount.resize(config.commodities, 0.f);
+        pop_type.luxury_needs_satisfaction.resize(config.commodities, 0.f);
+        pop_type.luxury_needs_deminishing_factor.resize(config.commodities, 0.f);
+        pop_type.basic_needs_amount[rand() % config.commodities] = 1.f;
+        const auto luxury_id = rand() % config.commodities;
+        pop_type.luxury_needs_satisfaction[luxury_id] = 1.f;
+        pop_type.luxury_needs_deminishing_factor[luxury_id] = 0.5f;
+        world.insert(pop_type);
+    }
+
+    // Each building type makes a commodity out of up to two others
+    for(size_t i = 0; i < config.building_types; i++) {
+        BuildingType building_type{};
+        building_type.ref_name = string_format("building_type_%zu", i);
+        building_type.name = building_type.ref_name;
+        building_type.can_build_land_units(i == 0);
+        building_type.output_id.emplace(CommodityId(i % config.commodities));
+        building_type.num_req_workers = 100.f;
+        const size_t num_inputs = rand() % 3;
+        for(size_t j = 0; j < num_inputs; j++) {
+            building_type.input_ids.push_back(CommodityId(rand() % config.commodities));
+            building_type.num_req_workers += 100.f;
+        }
+        world.insert(building_type);
+    }
+
+    UnitType unit_type{};
+    unit_type.ref_name = "infantry";
+    unit_type.name = unit_type.ref_name;
+    unit_type.attack = unit_type.defense = 1.f;
+    unit_type.max_health = 100.f;
+    unit_type.is_ground = true;
+    unit_type.speed = 1.f;
+    world.insert(unit_type);
+
+    for(size_t i = 0; i < config.nations; i++) {
+        Nation nation{};
+        nation.ref_name = string_format("nation_%zu", i);
+        nation.name = nation.ref_name;
+        nation.ideology_id = IdeologyId(0);
+        nation.commodity_production.resize(world.commodities.size(), 1.f);
+        nation.religion_acceptance.resize(world.religions.size(), 0.f);
+        nation.language_acceptance.resize(world.languages.size(), 0.f);
+        nation.client_hints.resize(world.ideologies.size());
+        nation.research.resize(world.technologies.size());
+        nation.ai_controlled = true;
+        world.insert(nation);
+    }
+
+    // Provinces are laid on a grid of 16x16 pixel cells, nations own contiguous bands of it
+    const size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(config.provinces))));
+    const size_t rows = (config.provinces + columns - 1) / columns;
+    constexpr size_t cell_size = 16;
+    world.width = columns * cell_size;
+    world.height = rows * cell_size;
+    for(size_t i = 0; i < config.provinces; i++) {
+        const size_t x = i % columns, y = i / columns;
+        Province province{};
+        province.ref_name = string_format("province_%zu", i);
+        province.name = province.ref_name;
+        province.color = static_cast<uint32_t>(i) | 0xff000000;
+        province.terrain_type_id = TerrainTypeId(0);
+        province.box_area = Eng3D::Rect(x * cell_size, y * cell_size, cell_size, cell_size);
+        province.rgo_size.resize(world.commodities.size(), 0);
+        province.rgo_size[rand() % world.commodities.size()] = 1000;
+        province.products.resize(world.commodities.size(), Product{});
+        province.products[0].supply += 50'000.f;
+        province.languages.resize(world.languages.size(), 0.f);
+        province.religions.resize(world.religions.size(), 0.f);
+        province.buildings.resize(world.building_types.size());
+        for(auto& building : province.buildings) {
+            if(rand() % 4 == 0) {
+                building.level = 1.f + rand() % 3;
+                building.budget += 1000.f;
+            }
+        }
+        for(size_t j = 0; j < province.pops.size(); j++) {
+            auto& pop = province.pops[j];
+            pop.type_id = PopTypeId(j);
+            pop.size = config.pop_size * (0.5f + rand_float());
+            pop.literacy = rand_float();
+            pop.budget = pop.size;
+        }
+        if(x > 0) province.neighbour_ids.push_back(ProvinceId(i - 1));
+        if(x + 1 < columns && i + 1 < config.provinces) province.neighbour_ids.push_back(ProvinceId(i + 1));
+        if(y > 0) province.neighbour_ids.push_back(ProvinceId(i - columns));
+        if(i + columns < config.provinces) province.neighbour_ids.push_back(ProvinceId(i + columns));
+        world.insert(province);
+    }
+
+    for(auto& province : world.provinces) {
+        const auto nation_id = NationId(static_cast<size_t>(province.get_id()) * config.nations / config.provinces);
+        auto& nation = world.nations[nation_id];
+        province.owner_id = province.controller_id = nation_id;
+        province.nuclei.push_back(nation_id);
+        province.languages[static_cast<size_t>(nation_id) % world.languages.size()] = 1.f;
+        province.religions[static_cast<size_t>(nation_id) % world.religions.size()] = 1.f;
+        nation.owned_provinces.push_back(province);
+        nation.controlled_provinces.push_back(province);
+    }
+
+    world.unit_manager.init(world);
+    world.relations.resize(world.nations.size() * world.nations.size());
+    for(size_t i = 0; i < config.wars && world.nations.size() > 1; i++) {
+        const auto a = NationId(rand() % world.nations.size());
+        const auto b = NationId((static_cast<size_t>(a) + 1) % world.nations.size()); // Neighbouring band
+        world.get_relation(a, b).has_war = true;
+    }
+
+    for(size_t i = 0; i < config.units; i++) {
+        const auto& province = world.provinces[rand() % world.provinces.size()];
+        Unit unit{};
+        unit.set_owner(world.nations[province.owner_id]);
+        unit.type_id = UnitTypeId(0);
+        unit.experience = 1.f;
+        unit.size = 100.f;
+        unit.base = world.unit_types[0].max_health;
+        world.unit_manager.add_unit(unit, province);
+    }
+
+    for(auto& nation : world.nations)
+        if(nation.exists())
+            nation.auto_relocate_capital();
+    world.update_aggregates();
+    AI::init(world);
+}
+
+static bool parse_arguments(int argc, char** argv, SimBenchConfig& config) {
+    const auto next_number = [&](int& i) -> size_t {
+        if(++i >= argc)
+            CXX_THROW(std::runtime_error, string_format("Expected a number after %s", argv[i - 1]));
+        return std::strtoull(argv[i], nullptr, 10);
+    };
+    for(int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if(arg == "--preset") {
+            if(++i >= argc)
+                CXX_THROW(std::runtime_error, "Expected small, medium or large after --preset");
+            const std::string preset = argv[i];
+            if(preset == "small") {
+                config.provinces = 5'000;
+                config.nations = 100;
+                config.units = 1'000;
+            } else if(preset == "medium") {
+                config.provinces = 20'000;
+                config.nations = 300;
+                config.units = 5'000;
+            } else if(preset == "large") {
+                config.provinces = 50'000;
+                config.nations = 1'000;
+                config.units = 20'000;
+            } else {
+                CXX_THROW(std::runtime_error, "Unknown preset " + preset);
+            }
+        } else if(arg == "--provinces") config.provinces = next_number(i);
+        else if(arg == "--nations") config.nations = next_number(i);
+        else if(arg == "--commodities") config.commodities = next_number(i);
+        else if(arg == "--buildings") config.building_types = next_number(i);
+        else if(arg == "--units") config.units = next_number(i);
+        else if(arg == "--wars") config.wars = next_number(i);
+        else if(arg == "--pop-size") config.pop_size = static_cast<float>(next_number(i));
+        else if(arg == "--ticks") config.ticks = next_number(i);
+        else if(arg == "--warmup") config.warmup_ticks = next_number(i);
+        else if(arg == "--seed") config.seed = static_cast<uint32_t>(next_number(i));
+        else if(arg == "--json") {
+            if(++i >= argc)
+                CXX_THROW(std::runtime_error, "Expected a path after --json");
+            config.json_path = argv[i];
+        } else if(arg == "--save") {
+            if(++i >= argc)
+                CXX_THROW(std::runtime_error, "Expected a path after --save");
+            config.save_path = argv[i];
+        } else if(arg == "--record") {
+            if(++i >= argc)
+                CXX_THROW(std::runtime_error, "Expected a path after --record");
+            config.record_path = argv[i];
+        } else if(arg == "--replay") {
+            if(++i >= argc)
+                CXX_THROW(std::runtime_error, "Expected a path after --replay");
+            config.replay_path = argv[i];
+        } else if(arg == "--checkpoint") config.checkpoint_interval = next_number(i);
+        else if(arg == "--help") {
+            printf("Usage: sim_bench [--preset small|medium|large] [--provinces N] [--nations N]\n"
+                "    [--commodities N] [--buildings N] [--units N] [--wars N] [--pop-size N]\n"
+                "    [--ticks N] [--warmup N] [--seed N] [--json path] [--save path]\n"
+                "    [--record path] [--checkpoint N] [--replay path]\n");
+            return false;
+        } else {
+            CXX_THROW(std::runtime_error, "Unknown argument " + arg);
+        }
+    }
+
+    // Limits imposed by the width of the ids
+    if(config.provinces == 0 || config.provinces >= static_cast<size_t>(ProvinceId(-2)))
+        CXX_THROW(std::runtime_error, "Number of provinces out of range");
+    if(config.nations == 0 || config.nations > config.provinces || config.nations >= static_cast<size_t>(NationId(-2)))
+        CXX_THROW(std::runtime_error, "Number of nations out of range");
+    if(config.units >= static_cast<size_t>(UnitId(-2)))
+        CXX_THROW(std::runtime_error, "Number of units out of range");
+    if(config.commodities == 0 || config.commodities >= static_cast<size_t>(CommodityId(-2)))
+        CXX_THROW(std::runtime_error, "Number of commodities out of range");
+    if(config.building_types == 0 || config.building_types >= static_cast<size_t>(BuildingTypeId(-2)))
+        CXX_THROW(std::runtime_error, "Number of building types out of range");
+    return true;
+}
+
+/// @brief Total time and allocations of each profiler zone so far
+static std::map<std::string, std::pair<double, size_t>> take_totals(World& world) {
+    std::map<std::string, std::pair<double, size_t>> totals;
+    for(const auto* task : world.profiler.get_tasks())
+        totals[task->name] = std::make_pair(task->total_time_ms, task->total_allocations);
+    return totals;
+}
+
+/// @brief Play back a recording as fast as possible, printing a line of JSON per tick
+/// with the time of each phase. Fails if the playback diverges from the recording
+static int run_replay(World& world, const SimBenchConfig& config) {
+    ReplayPlayer player{};
+    player.open(config.replay_path);
+    player.load_world(world);
+    fprintf(stderr, "Replaying %zu ticks of %s\n", player.get_ticks(), config.replay_path.data());
+
+    std::unique_ptr<FILE, int(*)(FILE*)> fp(nullptr, fclose);
+    if(!config.json_path.empty()) {
+        fp.reset(fopen(config.json_path.data(), "wt"));
+        if(fp == nullptr)
+            CXX_THROW(std::runtime_error, "Can't open " + config.json_path);
+    }
+
+    auto last_totals = take_totals(world);
+    double total_ms = 0.0;
+    size_t checkpoints = 0;
+    while(const auto result = player.step(world)) {
+        const auto totals = take_totals(world);
+        std::string phases_json;
+        for(const auto& [name, total] : totals)
+            phases_json += string_format("%s\"%s\": %.3f", phases_json.empty() ? "" : ", ", json_escape(name).data(), total.first - last_totals[name].first);
+        last_totals = totals;
+        total_ms += result->tick_ms;
+        checkpoints += result->checked;
+
+        const auto line = string_format("{ \"tick\": %i, \"tick_ms\": %.3f, \"commands\": %zu, \"checkpoint\": %s, \"matches\": %s, \"phases\": { %s } }\n",
+            result->time, result->tick_ms, result->commands, result->checked ? "true" : "false", result->matches ? "true" : "false", phases_json.data());
+        fputs(line.data(), stdout);
+        if(fp != nullptr)
+            fputs(line.data(), fp.get());
+    }
+
+    fprintf(stderr, "Replayed %zu ticks in %.2f ms, %zu checkpoints\n", player.get_ticks(), total_ms, checkpoints);
+    if(const auto tick = player.get_first_divergent_tick()) {
+        fprintf(stderr, "sim_bench: replay diverged on tick %i\n", *tick);
+        return 1;
+    }
+    return 0;
+}
+
+template<typename F>
+static double time_ms(F&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string save_list_json(const Eng3D::Deser::ChunkedArchive& ar) {
+    std::string json;
+    for(const auto& stats : ar.get_stats())
+        json += string_format("%s\"%s\": { \"elements\": %zu, \"chunks\": %zu, \"bytes\": %zu, \"ms\": %.3f }",
+            json.empty() ? "" : ", ", json_escape(stats.name).data(), stats.elements, stats.chunks, stats.bytes, stats.ms);
+    return json;
+}
+
+/// @brief Save and load the world with the plain and the chunked archives. Floats
+/// are stored as fixed point so a load isn't bit exact, instead both formats must
+/// load back the exact same world
+static std::string benchmark_save(World& world, const std::string& path) {
+    const auto plain_path = path + ".plain";
+    Eng3D::Deser::Archive plain_ar{};
+    const auto plain_save_ms = time_ms([&] {
+        Eng3D::Deser::serialize(plain_ar, world);
+        plain_ar.to_file(plain_path);
+    });
+    Eng3D::Deser::ChunkedArchive save_ar{};
+    const auto chunked_save_ms = time_ms([&] {
+        world.save(save_ar);
+        save_ar.to_file(path);
+    });
+
+    Eng3D::Deser::ChunkedArchive load_ar{};
+    const auto chunked_load_ms = time_ms([&] {
+        load_ar.from_file(path);
+        world.load(load_ar);
+    });
+    Eng3D::Deser::Archive chunked_result{};
+    Eng3D::Deser::serialize(chunked_result, world);
+
+    const auto plain_load_ms = time_ms([&] {
+        Eng3D::Deser::Archive ar{};
+        ar.from_file(plain_path);
+        Eng3D::Deser::deserialize(ar, world);
+    });
+    Eng3D::Deser::Archive plain_result{};
+    Eng3D::Deser::serialize(plain_result, world);
+    std::remove(plain_path.data());
+    if(chunked_result.buffer != plain_result.buffer)
+        CXX_THROW(std::runtime_error, "Chunked archive loaded a different world");
+
+    fprintf(stderr, "Save: plain %.2f ms, chunked %.2f ms; load: plain %.2f ms, chunked %.2f ms\n", plain_save_ms, chunked_save_ms, plain_load_ms, chunked_load_ms);
+    std::string json = "  \"save\": {\n";
+    json += string_format("    \"plain\": { \"save_ms\": %.3f, \"load_ms\": %.3f, \"bytes\": %zu },\n", plain_save_ms, plain_load_ms, plain_ar.size());
+    json += string_format("    \"chunked\": { \"save_ms\": %.3f, \"load_ms\": %.3f },\n", chunked_save_ms, chunked_load_ms);
+    json += "    \"save_lists\": { " + save_list_json(save_ar) + " },\n";
+    json += "    \"load_lists\": { " + save_list_json(load_ar) + " }\n";
+    json += "  }\n";
+    return json;
+}
+
+int main(int argc, char** argv) try {
+    SimBenchConfig config{};
+    if(!parse_arguments(argc, argv, config))
+        return 0;
+
+    Eng3D::StringManager string_man;
+    auto& world = World::get_instance();
+    if(!config.replay_path.empty())
+        return run_replay(world, config);
+
+    const auto gen_start = std::chrono::steady_clock::now();
+    generate_world(world, config);
+    const auto gen_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gen_start).count();
+    fprintf(stderr, "Generated %zu provinces, %zu nations, %zu units in %.2f ms\n", world.provinces.size(), world.nations.size(), config.units, gen_ms);
+    // The trade cost matrix is provinces^2 floats, warn before it eats the machine
+    const auto trade_matrix_mb = static_cast<double>(config.provinces) * config.provinces * sizeof(float) / (1024.0 * 1024.0);
+    fprintf(stderr, "Trade cost matrix will use %.0f MB\n", trade_matrix_mb);
+
+    for(size_t i = 0; i < config.warmup_ticks; i++)
+        world.do_tick();
+
+    ReplayRecorder recorder{};
+    if(!config.record_path.empty())
+        recorder.start(world, config.record_path, config.seed, config.checkpoint_interval);
+
+    // Per-phase samples are the difference of the profiler totals across each tick
+    std::map<std::string, PhaseSamples> phases;
+    auto last_totals = take_totals(world); // (time, allocations)
+
+    std::vector<double> tick_times;
+    tick_times.reserve(config.ticks);
+    const auto heap_start = Eng3D::Heap::get_stats();
+    for(size_t i = 0; i < config.ticks; i++) {
+        const auto tick_start = std::chrono::steady_clock::now();
+        world.do_tick();
+        tick_times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tick_start).count());
+        // There's no server to do it, and hashing the world isn't part of the tick
+        recorder.end_tick(world);
+
+        const auto totals = take_totals(world);
+        for(const auto& [name, total] : totals) {
+            const auto last = last_totals[name];
+            auto& phase = phases[name];
+            phase.times_ms.push_back(total.first - last.first);
+            phase.allocations += total.second - last.second;
+        }
+        last_totals = totals;
+    }
+    const auto heap_end = Eng3D::Heap::get_stats();
+    recorder.stop();
+
+    std::string save_json;
+    if(!config.save_path.empty())
+        save_json = benchmark_save(world, config.save_path);
+
+    // Machine readable summary
+    std::string json = "{\n";
+    json += string_format("  \"world\": { \"provinces\": %zu, \"nations\": %zu, \"commodities\": %zu, \"building_types\": %zu, \"units\": %zu, \"wars\": %zu, \"pop_size\": %.0f, \"seed\": %u },\n",
+        config.provinces, config.nations, config.commodities, config.building_types, config.units, config.wars, config.pop_size, config.seed);
+    json += string_format("  \"generation_ms\": %.3f,\n", gen_ms);
+    json += string_format("  \"ticks\": %zu,\n", config.ticks);
+    json += string_format("  \"warmup_ticks\": %zu,\n", config.warmup_ticks);
+    const auto total_ms = std::accumulate(tick_times.begin(), tick_times.end(), 0.0);
+    json += string_format("  \"tick_ms\": { \"total\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"max\": %.3f },\n",
+        total_ms, tick_times.empty() ? 0.0 : total_ms / tick_times.size(), percentile(tick_times, 0.5), percentile(tick_times, 0.95), percentile(tick_times, 1.0));
+    json += string_format("  \"allocations_per_tick\": %.1f,\n", config.ticks ? static_cast<double>(heap_end.allocations - heap_start.allocations) / config.ticks : 0.0);
+    json += "  \"phases\": {\n";
+    size_t n = 0;
+    for(const auto& [name, phase] : phases) {
+        const auto phase_total = std::accumulate(phase.times_ms.begin(), phase.times_ms.end(), 0.0);
+        json += string_format("    \"%s\": { \"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p95_ms\": %.3f, \"max_ms\": %.3f, \"allocations_per_tick\": %.1f }%s\n",
+            json_escape(name).data(), phase_total / phase.times_ms.size(), percentile(phase.times_ms, 0.5), percentile(phase.times_ms, 0.95), percentile(phase.times_ms, 1.0),
+            static_cast<double>(phase.allocations) / phase.times_ms.size(), ++n < phases.size() ? "," : "");
+    }
+    json += save_json.empty() ? "  }\n" : "  },\n" + save_json;
+    json += "}\n";
+
+    fputs(json.data(), stdout);
+    if(!config.json_path.empty()) {
+        std::unique_ptr<FILE, int(*)(FILE*)> fp(fopen(config.json_path.data(), "wt"), fclose);
+        if(fp == nullptr)
+            CXX_THROW(std::runtime_error, "Can't open " + config.json_path);
+        fputs(json.data(), fp.get());
+    }
+    return 0;
+} catch(const std::exception& e) {
+    fprintf(stderr, "sim_bench: %s\n", e.what());
+    return -1;
+}
@@ -0,0 +1,283 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      bench/threat_bench.cpp
+//
+// Abstract:
+//      Compares the shared threat map against every nation working out the
+//      risk of the provinces on its own.
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "eng3d/rand.hpp"
+
+#include "world.hpp"
+#include "server/ai.hpp"
+#include "server/threat_map.hpp"
+#include "bench_fixture.hpp"
+
+namespace AI {
+    void init(World& world);
+}
+
+/// @brief Shape of the synthetic world
+struct ThreatBenchConfig {
+    size_t provinces = 10'000;
+    size_t nations = 200;
+    size_t units = 5'000;
+    size_t wars = 40; // Pairs of nations at war
+    size_t moves = 250; // Units moved, and units replenished or handed over, between each tick
+    size_t ticks = 20;
+    uint32_t seed = 1;
+};
+
+/// @brief Grid of land provinces split onto bands of nations, with units scattered
+/// over it. Only what the risk of the provinces looks at is filled in
+static void generate_world(World& world, const ThreatBenchConfig& config) {
+    Eng3D::Rand rand(config.seed);
+
+    TerrainType land{};
+    land.ref_name = "land";
+    land.name = "Land";
+    world.insert(land);
+
+    UnitType unit_type{};
+    unit_type.ref_name = "infantry";
+    unit_type.name = unit_type.ref_name;
+    unit_type.attack = unit_type.defense = 1.f;
+    unit_type.max_health = 100.f;
+    unit_type.is_ground = true;
+    world.insert(unit_type);
+
+    Bench::generate_grid_world(world, config.provinces, config.nations, [&](Province& province) {
+        province.terrain_type_id = TerrainTypeId(0);
+        province.is_coastal = rand() % 8 == 0;
+    });
+    world.unit_manager.init(world);
+    for(size_t i = 0; i < world.nations.size(); i++) {
+        for(size_t j = 0; j < i; j++) {
+            auto& relation = world.get_relation(NationId(i), NationId(j));
+            relation.relation = static_cast<float>(rand() % 200) / 100.f - 1.f;
+        }
+    }
+    for(size_t i = 0; i < config.wars && world.nations.size() > 1; i++) {
+        const auto a = NationId(rand() % world.nations.size());
+        const auto b = NationId((static_cast<size_t>(a) + 1) % world.nations.size()); // Neighbouring band
+        world.get_relation(a, b).has_war = true;
+    }
+
+    for(size_t i = 0; i < config.units; i++) {
+        const auto& province = world.provinces[rand() % world.provinces.size()];
+        Unit unit{};
+        unit.set_owner(world.nations[province.owner_id]);
+        unit.type_id = UnitTypeId(0);
+        unit.size = static_cast<float>(100 + rand() % 900);
+        unit.base = unit.size + static_cast<float>(100 + rand() % 400); // Worn out, so it replenishes
+        world.unit_manager.add_unit(unit, province);
+    }
+    AI::init(world);
+}
+
+/// @brief What the AI of each nation did before the threat map: gather the provinces it
+/// can evaluate, add up every unit on them and spread the result onto the neighbours
+struct ReferenceRisk {
+    std::vector<float> potential_risk;
+    std::vector<ProvinceId> eval_provinces;
+
+    void calc(const World& world, const Nation& nation, const AIManager& ai) {
+        eval_provinces.clear();
+        for(const auto& province : world.provinces)
+            if(world.terrain_types[province.terrain_type_id].is_water_body)
+                eval_provinces.push_back(province);
+        eval_provinces.insert(eval_provinces.end(), nation.controlled_provinces.begin(), nation.controlled_provinces.end());
+        for(const auto& other : world.nations)
+            if(&other != &nation && world.get_relation(nation, other).has_landpass())
+                eval_provinces.insert(eval_provinces.end(), other.controlled_provinces.begin(), other.controlled_provinces.end());
+
+        potential_risk.assign(world.provinces.size(), 1.f);
+        for(const auto province_id : eval_provinces) {
+            const auto& province = world.provinces[province_id];
+            auto draw_in_force = 1.f;
+            for(const auto unit_id : world.unit_manager.get_province_units(province_id)) {
+                const auto& unit = world.unit_manager.units[unit_id];
+                const auto unit_weight = unit.on_battle ? ai.unit_battle_weight : ai.unit_exist_weight;
+                draw_in_force += unit.get_strength() * unit_weight * ai.nations_risk_factor[unit.owner_id];
+            }
+            if(province.is_coastal)
+                draw_in_force *= ai.coastal_weight;
+            if(province.owner_id == nation && province.controller_id != nation)
+                draw_in_force *= ai.reconquer_weight;
+            draw_in_force += ai.nations_risk_factor[province.controller_id];
+            potential_risk[province_id] += draw_in_force;
+        }
+        for(const auto province_id : eval_provinces) {
+            const auto& province = world.provinces[province_id];
+            for(const auto neighbour_id : province.neighbour_ids)
+                potential_risk[neighbour_id] += potential_risk[province_id] / province.neighbour_ids.size();
+        }
+    }
+
+    ProvinceId get_highest(const World& world, const Province& start, const Unit& unit) const {
+        const auto* highest_risk = &start;
+        for(const auto neighbour_id : start.neighbour_ids) {
+            const auto& neighbour = world.provinces[neighbour_id];
+            if(potential_risk[neighbour_id] >= potential_risk[highest_risk->get_id()]) {
+                if(neighbour.controller_id == unit.owner_id || world.get_relation(neighbour.controller_id, unit.owner_id).has_landpass())
+                    highest_risk = &neighbour;
+            }
+        }
+        return highest_risk->get_id();
+    }
+};
+
+/// @brief Move some units to a neighbouring province, as the previous tick would have
+static void move_units(World& world, Eng3D::Rand& rand, size_t units, size_t moves) {
+    auto& unit_manager = world.unit_manager;
+    for(size_t i = 0; i < moves && units > 0; i++) {
+        const auto unit_id = UnitId(rand() % units);
+        const auto& province = world.provinces[unit_manager.get_unit_current_province(unit_id)];
+        if(province.neighbour_ids.empty()) continue;
+        unit_manager.move_unit(unit_id, province.neighbour_ids[rand() % province.neighbour_ids.size()]);
+    }
+}
+
+/// @brief Replenish some units and hand some others to another nation, without moving
+/// them, as the units recovering from battles and the revolts would
+static void change_units(World& world, Eng3D::Rand& rand, size_t units, size_t changes) {
+    for(size_t i = 0; i < changes && units > 0; i++) {
+        auto& unit = world.unit_manager.units[UnitId(rand() % units)];
+        if(rand() % 4 == 0)
+            unit.set_owner(world.nations[rand() % world.nations.size()]);
+        else
+            unit.replenish();
+    }
+}
+
+static bool parse_arguments(int argc, char** argv, ThreatBenchConfig& config) {
+    Bench::Arguments arguments("threat_bench");
+    arguments.add("--provinces", config.provinces);
+    arguments.add("--nations", config.nations);
+    arguments.add("--units", config.units);
+    arguments.add("--wars", config.wars);
+    arguments.add("--moves", config.moves);
+    arguments.add("--ticks", config.ticks);
+    arguments.add("--seed", config.seed);
+    if(!arguments.parse(argc, argv))
+        return false;
+    if(config.provinces == 0 || config.nations == 0 || config.ticks == 0)
+        CXX_THROW(std::runtime_error, "Provinces, nations and ticks can't be zero");
+    config.nations = std::min(config.nations, config.provinces);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    return Bench::run("threat_bench", [&] {
+        ThreatBenchConfig config{};
+        if(!parse_arguments(argc, argv, config))
+            return 0;
+
+        Eng3D::StringManager string_man;
+        auto& world = World::get_instance();
+        generate_world(world, config);
+        const auto build_ms = Bench::time_ms([&] {
+            threat_map.update(world);
+        });
+
+        // Both sides decide where every unit that can move would go, on a single thread
+        Eng3D::Rand rand(config.seed);
+        ReferenceRisk reference{};
+        double reference_ms = 0.0, update_ms = 0.0, query_ms = 0.0;
+        size_t decisions = 0, agreements = 0, refreshed = 0;
+        std::vector<ProvinceId> reference_targets, targets;
+        for(size_t tick = 0; tick < config.ticks; tick++) {
+            move_units(world, rand, config.units, config.moves);
+            change_units(world, rand, config.units, config.moves);
+            reference_targets.assign(config.units, Province::invalid());
+            targets.assign(config.units, Province::invalid());
+            reference_ms += Bench::time_ms([&] {
+                for(const auto& nation : world.nations) {
+                    auto& ai = ai_man[nation];
+                    ai.calc_nation_risk(world, nation);
+                    reference.calc(world, nation, ai);
+                    for(const auto province_id : reference.eval_provinces) {
+                        const auto& province = world.provinces[province_id];
+                        for(const auto unit_id : world.unit_manager.get_province_units(province_id)) {
+                            const auto& unit = world.unit_manager.units[unit_id];
+                            if(unit.owner_id == nation && unit.can_move())
+                                reference_targets[unit_id] = reference.get_highest(world, province, unit);
+                        }
+                    }
+                }
+            });
+            update_ms += Bench::time_ms([&] {
+                threat_map.update(world);
+            });
+            refreshed += threat_map.get_refreshed();
+            query_ms += Bench::time_ms([&] {
+                for(const auto& nation : world.nations) {
+                    auto& ai = ai_man[nation];
+                    ai.calc_nation_risk(world, nation);
+                    for(const auto province_id : threat_map.get_unit_provinces(nation)) {
+                        const auto& province = world.provinces[province_id];
+                        if(!ai.can_evaluate(world, nation, province)) continue;
+                        for(const auto unit_id : world.unit_manager.get_province_units(province_id)) {
+                            const auto& unit = world.unit_manager.units[unit_id];
+                            if(unit.owner_id == nation && unit.can_move())
+                                targets[unit_id] = ai.get_highest_priority_province(world, nation, province, unit).get_id();
+                        }
+                    }
+                }
+            });
+
+            // The spread isn't the same (the neighbours pass on their units, not their whole risk),
+            // so this is how often both would send the unit to the same place
+            for(size_t i = 0; i < config.units; i++) {
+                if(Province::is_invalid(reference_targets[i]) && Province::is_invalid(targets[i])) continue;
+                decisions++;
+                agreements += reference_targets[i] == targets[i] ? 1 : 0;
+            }
+        }
+
+        // What was kept up to date move by move must match a map built from scratch
+        size_t mismatches = 0;
+        ThreatMap rebuilt{};
+        rebuilt.update(world);
+        const auto same_presences = [](const auto& a, const auto& b) {
+            const auto close = [](float x, float y) {
+                return std::abs(x - y) <= 1e-3f * std::max(1.f, std::max(std::abs(x), std::abs(y)));
+            };
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [&](const auto& x, const auto& y) {
+                return x.nation_id == y.nation_id && close(x.strength, y.strength) && close(x.battle_strength, y.battle_strength);
+            });
+        };
+        for(const auto& province : world.provinces)
+            if(!same_presences(threat_map.get_local(province), rebuilt.get_local(province)) || !same_presences(threat_map.get_nearby(province), rebuilt.get_nearby(province)))
+                mismatches++;
+
+        const auto threat_ms = update_ms + query_ms;
+        printf("{ \"provinces\": %zu, \"nations\": %zu, \"units\": %zu, \"moves\": %zu, \"ticks\": %zu, \"build_ms\": %.3f, \"reference_ms\": %.3f, \"update_ms\": %.3f, \"query_ms\": %.3f, \"speedup\": %.2f, \"refreshed\": %.1f, \"agreement\": %.3f, \"mismatches\": %zu }\n",
+            config.provinces, config.nations, config.units, config.moves, config.ticks, build_ms,
+            reference_ms / config.ticks, update_ms / config.ticks, query_ms / config.ticks, reference_ms / std::max(threat_ms, 1e-9),
+            static_cast<double>(refreshed) / config.ticks, decisions > 0 ? static_cast<double>(agreements) / decisions : 1.0, mismatches);
+        return mismatches == 0 ? 0 : 1;
+    });
+}
@@ -49,6 +49,7 @@ Eng3D::Networking::Packet DiploDeclareWar::form_packet(const Nation& nation) {
 
 Eng3D::Networking::Packet ProvinceUpdate::form_packet(const std::vector<Province>& list) {
     return action_handler_sr<ActionType::PROVINCE_UPDATE>([&list](auto& ar) {
+        Eng3D::Deser::serialize<ProvinceId>(ar, ProvinceId(list.size()));
         for(const auto& province : list) {
             Eng3D::Deser::serialize(ar, province.get_id()); // ProvinceRef
             Eng3D::Deser::serialize(ar, province); // ProvinceObj
@@ -56,6 +57,27 @@ Eng3D::Networking::Packet ProvinceUpdate::form_packet(const std::vector<Province
     });
 }
 
+Eng3D::Networking::Packet ProvinceUpdate::form_packet(const std::vector<Province>& list, const std::vector<ProvinceId>& ids) {
+    return action_handler_sr<ActionType::PROVINCE_UPDATE>([&](auto& ar) {
+        Eng3D::Deser::serialize<ProvinceId>(ar, ProvinceId(ids.size()));
+        for(const auto province_id : ids) {
+            Eng3D::Deser::serialize(ar, province_id); // ProvinceRef
+            Eng3D::Deser::serialize(ar, list[province_id]); // ProvinceObj
+        }
+    });
+}
+
+Eng3D::Networking::Packet ProvinceControlUpdate::form_packet(const std::vector<Province>& list, const std::vector<ProvinceId>& ids) {
+    return action_handler_sr<ActionType::PROVINCE_CONTROL_UPDATE>([&](auto& ar) {
+        Eng3D::Deser::serialize<ProvinceId>(ar, ProvinceId(ids.size()));
+        for(const auto province_id : ids) {
+            Eng3D::Deser::serialize(ar, province_id);
+            Eng3D::Deser::serialize(ar, list[province_id].owner_id);
+            Eng3D::Deser::serialize(ar, list[province_id].controller_id);
+        }
+    });
+}
+
 Eng3D::Networking::Packet NationUpdate::form_packet(const std::vector<Nation>& list) {
     return action_handler_sr<ActionType::NATION_UPDATE>([&list](auto& ar) {
         for(const auto& nation : list) {
@@ -109,16 +131,13 @@ Eng3D::Networking::Packet UnitAdd::form_packet(const Unit& unit) {
     });
 }
 
-Eng3D::Networking::Packet UnitUpdate::form_packet(const Eng3D::Freelist<Unit>& units) {
+Eng3D::Networking::Packet UnitUpdate::form_packet(const UnitManager& unit_manager, const std::vector<UnitId>& unit_ids) {
     return action_handler_sr<ActionType::UNIT_UPDATE>([&](auto& ar) {
-        size_t size = 0;
-        units.for_each([&](const auto&) {
-            size++;
-        });
-        Eng3D::Deser::serialize<UnitId>(ar, UnitId(size));
-        units.for_each([&](const auto& unit) {
-            Eng3D::Deser::serialize(ar, unit);
-        });
+        Eng3D::Deser::serialize<UnitId>(ar, UnitId(unit_ids.size()));
+        for(const auto unit_id : unit_ids) {
+            Eng3D::Deser::serialize(ar, unit_manager.units[unit_id]);
+            Eng3D::Deser::serialize(ar, unit_manager.get_unit_current_province(unit_id));
+        }
     });
 }
 
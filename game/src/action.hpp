@@ -59,6 +59,7 @@ enum ActionType {
     DIPLO_DECLARE_WAR,
     DIPLO_ALLOW_MIL_ACCESS,
     FOCUS_TECH, // Technology
+    PROVINCE_CONTROL_UPDATE, // Province
 };
 template<>
 struct Eng3D::Deser::Serializer<ActionType>: public Eng3D::Deser::SerializerMemcpy<ActionType> {};
@@ -69,6 +70,7 @@ class Province;
 struct Building;
 struct BuildingType;
 class Unit;
+class UnitManager;
 struct UnitType;
 struct Decision;
 struct Event;
@@ -81,6 +83,13 @@ namespace Action {
 
     struct ProvinceUpdate {
         static Eng3D::Networking::Packet form_packet(const std::vector<Province>& list);
+        /// @brief Only the given provinces of the list
+        static Eng3D::Networking::Packet form_packet(const std::vector<Province>& list, const std::vector<ProvinceId>& ids);
+    };
+
+    /// @brief Owner and controller of the given provinces, without the rest of their data
+    struct ProvinceControlUpdate {
+        static Eng3D::Networking::Packet form_packet(const std::vector<Province>& list, const std::vector<ProvinceId>& ids);
     };
 
     struct NationUpdate {
@@ -112,7 +121,9 @@ namespace Action {
     };
 
     struct UnitUpdate {
-        static Eng3D::Networking::Packet form_packet(const Eng3D::Freelist<Unit>& units);
+        /// @brief The given units along with their current province, the receiver drops
+        /// any unit not in the packet
+        static Eng3D::Networking::Packet form_packet(const UnitManager& unit_manager, const std::vector<UnitId>& unit_ids);
     };
 
     struct UnitRemove {
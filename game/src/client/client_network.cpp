@@ -119,12 +119,48 @@ void Client::netloop() {
                 }
             } break;
             case ActionType::UNIT_UPDATE: {
+                // We get every unit we can see, the ones missing went out of sight
+                auto& unit_manager = gs.world->unit_manager;
                 UnitId size;
                 Eng3D::Deser::deserialize(ar, size);
+                std::vector<bool> is_seen(unit_manager.units.data.size(), false);
                 for(size_t i = 0; i < static_cast<size_t>(size); i++) {
                     Unit unit;
                     Eng3D::Deser::deserialize(ar, unit);
-                    gs.world->unit_manager.units[unit] = unit;
+                    ProvinceId province_id;
+                    Eng3D::Deser::deserialize(ar, province_id);
+                    const auto unit_id = unit.get_id();
+                    unit_manager.set_unit(unit, province_id);
+                    if(static_cast<size_t>(unit_id) >= is_seen.size())
+                        is_seen.resize(static_cast<size_t>(unit_id) + 1, false);
+                    is_seen[unit_id] = true;
+                }
+                std::vector<UnitId> unseen_ids;
+                unit_manager.units.for_each([&is_seen, &unseen_ids](const auto& unit) {
+                    if(!is_seen[unit])
+                        unseen_ids.push_back(unit.get_id());
+                });
+                for(const auto unit_id : unseen_ids)
+                    unit_manager.remove_unit(unit_id);
+            } break;
+            case ActionType::PROVINCE_CONTROL_UPDATE: {
+                ProvinceId size;
+                Eng3D::Deser::deserialize(ar, size);
+                for(size_t i = 0; i < static_cast<size_t>(size); i++) {
+                    ProvinceId province_id;
+                    Eng3D::Deser::deserialize(ar, province_id);
+                    auto& province = gs.world->provinces.at(province_id);
+                    NationId owner_id, controller_id;
+                    Eng3D::Deser::deserialize(ar, owner_id);
+                    Eng3D::Deser::deserialize(ar, controller_id);
+                    if(province.owner_id != owner_id) {
+                        province.owner_id = owner_id;
+                        gs.world->province_manager.mark_province_owner_changed(province);
+                    }
+                    if(province.controller_id != controller_id) {
+                        province.controller_id = controller_id;
+                        gs.world->province_manager.mark_province_control_changed(province);
+                    }
                 }
             } break;
             case ActionType::UNIT_ADD: {
@@ -175,6 +211,9 @@ void Client::netloop() {
                 // Give up the world mutex for now
                 gs.update_tick = true;
                 gs.world->time++;
+                // Provinces and nations are updated by the server, so our cached
+                // aggregates must be refreshed from them
+                gs.world->update_aggregates();
 
                 decltype(gs.world->time) new_time;
                 Eng3D::Deser::deserialize(ar, new_time);
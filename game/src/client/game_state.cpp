@@ -28,6 +28,8 @@
 #include <cstring>
 #include <sys/types.h>
 #include <filesystem>
+#include <random>
+#include <utility>
 
 #include "eng3d/ui/ui.hpp"
 #include "eng3d/ui/input.hpp"
@@ -171,8 +173,15 @@ void GameState::world_thread() {
             const auto start_time = std::chrono::system_clock::now();
             Eng3D::Log::debug("world_thread", "World tick performed!");
             try {
+                // Record from right before the first tick, commands can only be recorded with a server
+                if(!record_path.empty() && server != nullptr) {
+                    const auto path = std::exchange(record_path, std::string{});
+                    server->recorder.start(*world, path, std::random_device{}(), record_checkpoint_interval);
+                }
                 world->do_tick();
                 update_tick = true;
+                if(curr_nation != nullptr)
+                    save_writer.on_tick(*world, curr_nation->get_id());
             } catch(const std::exception& e) {
                 std::scoped_lock lock(render_lock);
                 ui_ctx.prompt("Runtime exception", e.what());
@@ -328,6 +337,22 @@ void GameState::handle_key(const Eng3D::Event::Key& e) {
     }
 }
 
+// Autosave settings given on the command line, applied once the GameState exists
+static struct {
+    size_t interval = World::ticks_per_month * 12;
+    size_t max_files = 3;
+    std::string directory = ".";
+} autosave_args;
+
+// Replay recording settings given on the command line
+static struct {
+    std::string path;
+    size_t checkpoint_interval = World::ticks_per_month;
+} record_args;
+
+// Memory the economy history may take, in megabytes
+static size_t history_budget_mb = 32;
+
 // Get the list of paths to the packages
 std::pair<std::vector<std::string>, bool> parse_arguments(int argc, char** argv) {
     std::vector<std::string> pkg_paths;
@@ -350,6 +375,44 @@ std::pair<std::vector<std::string>, bool> parse_arguments(int argc, char** argv)
         } else if(arg == "--echo") {
             is_early_exit = true;
             is_echo = true;
+        } else if(arg == "--debug") {
+            Eng3D::Log::debug_show = true;
+        } else if(arg == "--log") {
+            i++;
+            if(i >= argc)
+                CXX_THROW(std::runtime_error, translate("Expected a file path after --log"));
+            if(!Eng3D::Log::open_file(argv[i]))
+                CXX_THROW(std::runtime_error, translate_format("Can't open log file %s", argv[i]));
+        } else if(arg == "--autosave") {
+            i++;
+            if(i >= argc)
+                CXX_THROW(std::runtime_error, translate("Expected a number of ticks after --autosave"));
+            autosave_args.interval = std::stoul(argv[i]);
+        } else if(arg == "--autosave-keep") {
+            i++;
+            if(i >= argc)
+                CXX_THROW(std::runtime_error, translate("Expected a number of files after --autosave-keep"));
+            autosave_args.max_files = std::stoul(argv[i]);
+        } else if(arg == "--autosave-dir") {
+            i++;
+            if(i >= argc)
+                CXX_THROW(std::runtime_error, translate("Expected a directory after --autosave-dir"));
+            autosave_args.directory = argv[i];
+        } else if(arg == "--record") {
+            i++;
+            if(i >= argc)
+                CXX_THROW(std::runtime_error, translate("Expected a file path after --record"));
+            record_args.path = argv[i];
+        } else if(arg == "--record-checkpoint") {
+            i++;
+            if(i >= argc)
+                CXX_THROW(std::runtime_error, translate("Expected a number of ticks after --record-checkpoint"));
+            record_args.checkpoint_interval = std::stoul(argv[i]);
+        } else if(arg == "--history-budget") {
+            i++;
+            if(i >= argc)
+                CXX_THROW(std::runtime_error, translate("Expected a number of megabytes after --history-budget"));
+            history_budget_mb = std::stoul(argv[i]);
         }
     }
     if(is_echo) putchar('\n');
@@ -475,18 +538,25 @@ void client_update(GameState& gs, std::vector<TreatyId>& displayed_treaties) {
 void client_render(GameState& gs) {
     std::scoped_lock render_lock(gs.render_lock);
     if(gs.current_mode != MapMode::NO_MAP) {
-        const std::scoped_lock update_lock(gs.world->world_mutex);
+        // Rendering only reads the world
+        const std::shared_lock update_lock(gs.world->world_mutex);
         gs.map->camera->update();
         gs.map->draw();
     }
     gs.world->profiler.render_done();
 }
 
+// Tools built from the game sources (i.e sim_bench) provide their own entry point
+#ifndef SOE_NO_MAIN
 int main(int argc, char** argv) try {
     const auto& [pkg_paths, is_early_exit] = parse_arguments(argc, argv);
     if(is_early_exit)
         return 0;
     GameState gs(pkg_paths);
+    gs.save_writer.set_autosave(autosave_args.interval, autosave_args.max_files, autosave_args.directory);
+    gs.record_path = record_args.path;
+    gs.record_checkpoint_interval = record_args.checkpoint_interval;
+    World::get_instance().economy_state.history.set_memory_budget(history_budget_mb * 1024 * 1024);
 
     startup(gs);
     // LuaAPI::invoke_registered_callback(gs.world->lua, "map_dev_view_invoke");
@@ -503,8 +573,11 @@ int main(int argc, char** argv) try {
         ([&gs]() { client_render(gs); })
     );
     world_th.join();
+    Eng3D::Log::flush();
     return 0;
 } catch(const std::exception& e) {
     Eng3D::Log::error("Exception thrown", e.what());
+    Eng3D::Log::flush();
     return -1;
 }
+#endif
@@ -39,6 +39,7 @@
 #include "world.hpp"
 #include "client/client_network.hpp"
 #include "server/server_network.hpp"
+#include "server/save_writer.hpp"
 #include "client/map.hpp"
 #include "eventpp/callbacklist.h"
 
@@ -142,6 +143,10 @@ public:
 
     std::unique_ptr<Client> client;
     std::unique_ptr<Server> server;
+    SaveWriter save_writer;
+    /// @brief Replay to record the session onto when the world starts ticking, empty to not record
+    std::string record_path;
+    size_t record_checkpoint_interval = World::ticks_per_month;
 
     std::atomic<bool> loaded_world;
     std::atomic<bool> loaded_map;
@@ -215,20 +215,12 @@ Minimap::Minimap(GameState& _gs, int _x, int _y, UI::Origin _origin)
         this->gs.map->set_selection([](const World&, Map& map, const Province& selected_province) {
             map.set_map_mode(([](ProvinceId id) {
                 return [id](const World& world) {
-                    const auto& province = world.provinces[id];
-                    const auto& nation = world.nations[province.owner_id];
-                    const auto& ai = ai_man[nation];
-
-                    auto max_amount = 0.f;
-                    for(const auto& province : world.provinces)
-                        max_amount = glm::max(ai.potential_risk[province], max_amount);
-
                     // Mix each color depending of how many live there compared to max_amount
                     auto min = Eng3D::Color::rgb8(128, 128, 255);
                     auto max = Eng3D::Color::rgb8(255, 64, 64);
                     std::vector<ProvinceColor> province_color;
                     for(const auto& province : world.provinces) {
-                        auto ratio = province.average_militancy();
+                        auto ratio = province.stats.militancy;
                         province_color.emplace_back(province.get_id(), Eng3D::Color::lerp(min, max, ratio));
                     }
                     return province_color;
@@ -237,7 +229,7 @@ Minimap::Minimap(GameState& _gs, int _x, int _y, UI::Origin _origin)
             ([](ProvinceId province_id) {
                 return [province_id](const World& world, const ProvinceId id) -> std::string {
                     const auto& province = world.provinces[id];
-                    return translate_format("Average militancy: %.2f\nAverage life needs met: %.2f", province.average_militancy(), province.average_life_needs());
+                    return translate_format("Average militancy: %.2f\nAverage life needs met: %.2f", province.stats.militancy, province.stats.life_needs_met);
                 };
             })(selected_province));
         });
@@ -254,16 +246,22 @@ Minimap::Minimap(GameState& _gs, int _x, int _y, UI::Origin _origin)
                     const auto& nation = world.nations[province.owner_id];
                     const auto& ai = ai_man[nation];
 
-                    auto max_amount = 0.f;
-                    for(const auto& province : world.provinces)
-                        max_amount = glm::max(ai.potential_risk[province], max_amount);
+                    // As the AI saw it the last time it moved the units
+                    std::vector<float> potential_risk(world.provinces.size(), 1.f);
+                    auto max_amount = 1.f;
+                    if(ai.has_province_risk(world)) {
+                        for(const auto& province : world.provinces) {
+                            potential_risk[province] = ai.get_province_risk(world, nation, province);
+                            max_amount = glm::max(potential_risk[province], max_amount);
+                        }
+                    }
 
                     // Mix each color depending of how many live there compared to max_amount
                     auto min = Eng3D::Color::rgb8(128, 128, 255);
                     auto max = Eng3D::Color::rgb8(255, 64, 64);
                     std::vector<ProvinceColor> province_color;
                     for(const auto& province : world.provinces) {
-                        auto ratio = ai.potential_risk[province] / max_amount;
+                        auto ratio = potential_risk[province] / max_amount;
                         province_color.emplace_back(province.get_id(), Eng3D::Color::lerp(min, max, ratio));
                     }
                     return province_color;
@@ -274,7 +272,8 @@ Minimap::Minimap(GameState& _gs, int _x, int _y, UI::Origin _origin)
                     const auto& province = world.provinces[id];
                     const auto& nation = world.nations[province.owner_id];
                     const auto& ai = ai_man[nation];
-                    return translate_format("Potential risk: %.2f (Our strenght: %.2f)\nWar weight: %.2f\nUnit battle weight: %.2f\nUnit exist weight: %.2f\nCoastal weight: %.2f\nReconquer weight: %.2f\nStrength threshold: %.2f\nErratic: %.2f\nOverride threshold: %.2f\nGains/losses: %zu/%zu\nMilitary strength: %.2f", ai.potential_risk[province], ai.military_strength, ai.war_weight, ai.unit_battle_weight, ai.unit_exist_weight, ai.coastal_weight, ai.reconquer_weight, ai.strength_threshold, ai.erratic, ai.override_threshold, ai.gains, ai.losses);
+                    const auto potential_risk = ai.has_province_risk(world) ? ai.get_province_risk(world, nation, province) : 0.f;
+                    return translate_format("Potential risk: %.2f (Our strenght: %.2f)\nWar weight: %.2f\nUnit battle weight: %.2f\nUnit exist weight: %.2f\nCoastal weight: %.2f\nReconquer weight: %.2f\nStrength threshold: %.2f\nErratic: %.2f\nOverride threshold: %.2f\nGains/losses: %zu/%zu\nMilitary strength: %.2f", potential_risk, ai.military_strength, ai.war_weight, ai.unit_battle_weight, ai.unit_exist_weight, ai.coastal_weight, ai.reconquer_weight, ai.strength_threshold, ai.erratic, ai.override_threshold, ai.gains, ai.losses);
                 };
             })(selected_province));
         });
@@ -373,7 +372,7 @@ MapmodeCommodityOptions::MapmodeCommodityOptions(GameState& _gs)
         auto& row = table.get_row(commodity);
         auto commodity_row = row.get_element(0);
         commodity_row->flex = UI::Flex::ROW;
-        auto good_str = Eng3D::Locale::translate(commodity.name.get_string());
+        auto good_str = Eng3D::Locale::translate(commodity.name);
         auto good_tex = gs.tex_man.load(gs.package_man.get_unique(commodity.get_icon_path()));
         commodity_row->make_widget<UI::Image>(0, 0, 35, 35, good_tex);
         commodity_row->make_widget<UI::Label>(0, 0, good_str);
@@ -530,7 +529,7 @@ std::vector<ProvinceColor> religion_map_mode(const World& world) {
     for(size_t i = 0; i < world.provinces.size(); i++) {
         const auto& province = world.provinces[i];
         std::vector<size_t> religion_amounts(world.religions.size());
-        size_t total_amount = province.total_pops();
+        size_t total_amount = province.stats.total_pops;
         size_t max_amount = 0;
         size_t max_religion_id = 0;
         for(const auto& religion : world.religions) {
@@ -562,7 +561,7 @@ std::vector<ProvinceColor> language_map_mode(const World& world) {
     for(size_t i = 0; i < world.provinces.size(); i++) {
         const auto& province = world.provinces[i];
         std::vector<size_t> language_amounts(world.languages.size());
-        size_t total_amount = province.total_pops();
+        size_t total_amount = province.stats.total_pops;
         size_t max_amount = 0;
         size_t max_language_id = 0;
         for(const auto& language : world.languages) {
@@ -594,10 +593,7 @@ std::vector<ProvinceColor> population_map_mode(const World& world) {
     std::vector<std::pair<ProvinceId, float>> province_amounts;
     float max_amount = 1.f;
     for(auto const& province : world.provinces) {
-        float amount = std::accumulate(province.pops.cbegin(), province.pops.cend(), 0, [](const float a, const auto& e) {
-            return a + e.size;
-        });
-        amount = std::log2(amount);
+        auto amount = std::log2(province.stats.total_pops);
         max_amount = glm::max(amount, max_amount);
         province_amounts.emplace_back(province.get_id(), amount);
     }
@@ -622,7 +618,7 @@ std::vector<ProvinceColor> population_map_mode(const World& world) {
 std::string population_tooltip(const World& world, const ProvinceId id) {
     const auto& province = world.provinces[id];
     if(!province.is_populated()) return "";
-    size_t amount = province.total_pops();
+    size_t amount = province.stats.total_pops;
     return string_format("%s\nPopulation: %zu", province.name.data(), amount);
 }
 
@@ -91,12 +91,7 @@ PoliciesView::PoliciesView(GameState& _gs)
     militancy_lab.set_on_each_tick([this](UI::Widget& w) {
         if(this->gs.world->time % this->gs.world->ticks_per_month) return;
 
-        auto num = 0.f;
-        for(const auto province_id : this->gs.curr_nation->owned_provinces)
-            for(const auto& pop : this->gs.world->provinces[province_id].pops)
-                num += pop.militancy;
-        num /= this->gs.curr_nation->owned_provinces.size();
-        w.set_text(translate_format("Militancy: %.2f%%", num * 100.f));
+        w.set_text(translate_format("Militancy: %.2f%%", this->gs.curr_nation->stats.militancy * 100.f));
     });
     militancy_lab.on_each_tick(militancy_lab);
 
@@ -145,6 +145,12 @@ UI::Widget& ProvincePopulationTab::create_stock_table() {
 
             auto* price = row.get_element(row_index++);
             price->set_key(product.price, "%.2f");
+            // Averages of the last months, read while the economy may be recording
+            const auto monthly_prices = this->gs.world->economy_state.history.get_province_history(this->province.get_id(), commodity.get_id(), Economy::History::Channel::PRICE, Economy::History::Resolution::MONTH);
+            std::string price_tooltip = translate("Average price of the last months:");
+            for(size_t i = monthly_prices.size() - std::min<size_t>(monthly_prices.size(), 6); i < monthly_prices.size(); i++)
+                price_tooltip += string_format(" %.2f", monthly_prices[i]);
+            price->set_tooltip(price_tooltip);
         }
     });
     stock_table.on_each_tick(stock_table);
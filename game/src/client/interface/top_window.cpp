@@ -84,18 +84,16 @@ TopWindow::TopWindow(GameState& _gs)
     population_img.set_tooltip("Population");
     auto& population_lab = population_grp.make_widget< UI::Label>(0, 0, " ");
     population_lab.set_on_each_tick([this](UI::Widget& w) {
-        const auto total = std::accumulate(gs.curr_nation->owned_provinces.cbegin(), gs.curr_nation->owned_provinces.cend(), 0.f, [this](auto&& a, const auto province_id) -> float {
-            return a + gs.world->provinces[province_id].total_pops();
-        });
+        const auto total = gs.curr_nation->stats.total_pops;
         w.set_text(Eng3D::Locale::format_number(total));
 
         const auto [it1, it2] = std::minmax_element(gs.curr_nation->owned_provinces.cbegin(), gs.curr_nation->owned_provinces.cend(), [this](const auto province_id, const auto other_province_id) {
-            return gs.world->provinces[province_id].total_pops() < gs.world->provinces[other_province_id].total_pops();
+            return gs.world->provinces[province_id].stats.total_pops < gs.world->provinces[other_province_id].stats.total_pops;
         });
         const auto& smallest_province = gs.world->provinces[*it1];
         const auto& largest_province = gs.world->provinces[*it2];
 
-        w.set_tooltip(Eng3D::string_format("Average population density: %.0f\nLargest province: %s (%.0f)\nSmallest province: %s (%.0f)", total / gs.curr_nation->owned_provinces.size(), largest_province.name.data(), largest_province.total_pops(), smallest_province.name.data(), smallest_province.total_pops()));
+        w.set_tooltip(Eng3D::string_format("Average population density: %.0f\nLargest province: %s (%.0f)\nSmallest province: %s (%.0f)", total / gs.curr_nation->owned_provinces.size(), largest_province.name.data(), largest_province.stats.total_pops, smallest_province.name.data(), smallest_province.stats.total_pops));
     });
     population_lab.on_each_tick(population_lab);
 
@@ -123,14 +121,7 @@ TopWindow::TopWindow(GameState& _gs)
     industrial_score_img.set_tooltip("Industrial score");
     auto& industrial_score_lab = industrial_score_grp.make_widget<UI::Label>(0, 0, " ");
     industrial_score_lab.set_on_each_tick([this](UI::Widget& w) {
-        const auto total = std::accumulate(gs.curr_nation->owned_provinces.cbegin(), gs.curr_nation->owned_provinces.cend(), 0.f, [this](const auto a, const auto province_id) -> float {
-            const auto& province = this->gs.world->provinces[province_id];
-            const auto& buildings = province.get_buildings();
-            return a + std::accumulate(buildings.cbegin(), buildings.cend(), 0.f, [](const auto a2, const auto& building) {
-                return a2 + (building.production_scale * building.level);
-            });
-        });
-        w.set_text(Eng3D::string_format("%.0f", total));
+        w.set_text(Eng3D::string_format("%.0f", this->gs.curr_nation->stats.industrial_score));
     });
     industrial_score_lab.on_each_tick(industrial_score_lab);
 
@@ -195,7 +186,9 @@ TopWindow::TopWindow(GameState& _gs)
 
     auto& load_ibtn = flex_column.make_widget<UI::Image>(9, 275, 25, 25, "gfx/top_bar/save.png", true);
     load_ibtn.set_on_click([this](UI::Widget&) {
-        LUA_util::load(this->gs, "autosave.sc4");
+        this->gs.save_writer.wait();
+        const auto latest = this->gs.save_writer.get_latest_autosave();
+        LUA_util::load(this->gs, latest.empty() ? "autosave.sc4" : latest);
     });
     load_ibtn.set_tooltip("Load latest autosave");
 
@@ -30,6 +30,9 @@
 #include "eng3d/utils.hpp"
 #include "client/game_state.hpp"
 #include "world.hpp"
+#include "server/threat_map.hpp"
+#include "server/diplomacy_index.hpp"
+#include "server/investment_index.hpp"
 
 static void save_province(GameState& gs, FILE* fp, Province& province)
 {
@@ -228,23 +231,31 @@ void LUA_util::save(GameState& gs, const std::string_view savefile_path) {
 
         gs.ui_ctx.prompt("Save", "Editor data saved! (check editor folder)");
     } else {
-        Eng3D::Deser::Archive ar{};
-        const auto nation_id = gs.curr_nation->get_id();
-        Eng3D::Deser::serialize(ar, nation_id);
-        Eng3D::Deser::serialize(ar, *gs.world);
-        ar.to_file(savefile_path);
-        gs.ui_ctx.prompt("Save", "Saved sucessfully!");
+        // Only the snapshot blocks the world, compression and disk writes are done in the background.
+        // The UI saves from client_update, which already holds the world lock
+        gs.save_writer.save_locked(*gs.world, gs.curr_nation->get_id(), savefile_path);
+        // Keep the commands applied in this session alongside, so it can be replayed
+        if(gs.server)
+            gs.server->save_command_log(std::string(savefile_path) + ".log");
+        gs.ui_ctx.prompt("Save", "Saving in the background...");
     }
 }
 
 void LUA_util::load(GameState& gs, const std::string_view savefile_path) {
     gs.paused = true;
+    // A savefile may still be in the middle of being written
+    gs.save_writer.wait();
 
-    Eng3D::Deser::Archive ar{};
+    Eng3D::Deser::ChunkedArchive ar{};
     ar.from_file(savefile_path);
     auto nation_id = gs.curr_nation->get_id();
-    Eng3D::Deser::deserialize(ar, nation_id);
-    Eng3D::Deser::deserialize(ar, *gs.world);
+    Eng3D::Deser::deserialize(ar.header, nation_id);
+    gs.world->load(ar);
+    if(gs.server)
+        gs.server->visibility.invalidate();
+    threat_map.invalidate();
+    diplomacy_index.invalidate();
+    investment_index.invalidate();
 
     /// @todo Events aren't properly saved yet
     gs.world->events.clear();
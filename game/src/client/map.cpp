@@ -216,7 +216,7 @@ void Map::update_nation_label(const Nation& nation) {
 
 	if(min_point_x.x == max_point_x.x || min_point_x.y == max_point_x.y
 	|| min_point_y.x == max_point_y.x || min_point_y.y == max_point_y.y) {
-		Eng3D::Log::warning("game", string_format("Nation %s is too small", nation.ref_name.data()));
+		Eng3D::Log::warning("game", "Nation %s is too small", nation.ref_name.data());
 		return;
 	}
 
@@ -241,13 +241,13 @@ void Map::create_labels() {
 
         if(glm::length(max_point - min_point) >= this->gs.world->width / 3.f) {
             const auto color = std::byteswap<std::uint32_t>((province.color & 0x00ffffff) << 8);
-            Eng3D::Log::warning("game", string_format("Province %s (color %x) is too big", province.ref_name.data(), color));
+            Eng3D::Log::warning("game", "Province %s (color %x) is too big", province.ref_name.data(), color);
             continue;
         }
         
         if(max_point.x == min_point.x || max_point.y == min_point.y) {
 			const auto color = std::byteswap<std::uint32_t>((province.color & 0x00ffffff) << 8);
-            Eng3D::Log::warning("game", string_format("Province %s (color %x) is too small", province.ref_name.data(), color));
+            Eng3D::Log::warning("game", "Province %s (color %x) is too small", province.ref_name.data(), color);
             continue;
 		}
 
@@ -74,12 +74,12 @@ MapRender::MapRender(GameState& _gs, Map& _map)
     // | 16 bit Province id | 8 bit terrain index | 8 bit "flags" |
     // ------------------------------------------------------------
     Eng3D::Log::debug("game", "Creating tile map & tile sheet");
-    assert((this->terrain_map->width* this->terrain_map->height) % 5400 == 0);
-
-    tbb::parallel_for(static_cast<size_t>(0), (this->terrain_map->width* this->terrain_map->height) / 5400, [this](const auto y) {
-        const auto i = y * 5400;
-        for(size_t x = 0; x < 5400; x++)
-            this->terrain_map->buffer.get()[i + x] |= static_cast<size_t>(this->gs.world->tiles[i + x]) & 0xffff;
+    tbb::parallel_for(static_cast<size_t>(0), this->terrain_map->height, [this](const auto y) {
+        auto* row = &this->terrain_map->buffer.get()[y * this->terrain_map->width];
+        this->gs.world->tiles.for_each_run(y, [row](size_t x_start, size_t x_end, ProvinceId province_id) {
+            for(size_t x = x_start; x < x_end; x++)
+                row[x] |= static_cast<size_t>(province_id) & 0xffff;
+        });
     });
 
     Eng3D::TextureOptions terrain_map_options{};
@@ -88,7 +88,7 @@ MapRender::MapRender(GameState& _gs, Map& _map)
     terrain_map_options.compressed = false;
     this->terrain_map->upload(terrain_map_options);
     // After this snippet of code we won't ever need tiles ever again
-    this->gs.world->tiles.reset();
+    this->gs.world->tiles.clear();
 
     // Texture holding each province color
     // The x & y coords are the province Red & Green color of the tile_map
@@ -393,7 +393,7 @@ void MapRender::update_visibility() {
     
     // Fill out density information for city lights
     for(const auto& province : gs.world->provinces) {
-        const auto total = glm::max(province.total_pops(), 0.1f);
+        const auto total = glm::max(province.stats.total_pops, 0.1f);
         const auto density = glm::clamp(total / 100'000.f, 0.f, 1.f) * 255.f;
         this->province_opt->buffer[province] |= (static_cast<uint8_t>(density) & 0xff) << 8;
     }
@@ -28,6 +28,8 @@
 #include "eng3d/rand.hpp"
 
 #include "world.hpp"
+#include "server/server_network.hpp"
+#include "server/diplomacy_index.hpp"
 
 //
 // Nation
@@ -86,6 +88,7 @@ void Nation::declare_war(Nation& nation, std::vector<TreatyClause::BaseClause*>
             relation.has_war = true;
             relation.alliance = 0.f;
             relation.relation = -1.f;
+            diplomacy_index.on_relation_change(defender_id, attacker_id);
         }
     }
 
@@ -116,7 +119,7 @@ bool Nation::is_enemy(const Nation& nation) const {
 void Nation::auto_relocate_capital() {
     const auto& world = World::get_instance();
     auto best_candidate = std::max_element(owned_provinces.cbegin(), owned_provinces.cend(), [&world](const auto& lhs, const auto& rhs) {
-        return world.provinces[lhs].total_pops() < world.provinces[rhs].total_pops();
+        return world.provinces[lhs].stats.total_pops < world.provinces[rhs].stats.total_pops;
     });
     capital_id = *best_candidate;
 }
@@ -170,8 +173,12 @@ void Nation::control_province(Province& province) {
     auto& provinces = world.nations[province.controller_id].controlled_provinces;
     std::erase(provinces, province);
 
+    const auto old_controller_id = province.controller_id;
     this->controlled_provinces.push_back(province);
     province.controller_id = this->get_id();
+    if(g_server != nullptr)
+        g_server->visibility.on_control_change(world, province, old_controller_id, this->get_id());
+    diplomacy_index.on_control_change(world, province, old_controller_id, this->get_id());
 
     // Update the province changed
     world.province_manager.mark_province_control_changed(province);
@@ -41,6 +41,28 @@ float Province::get_attractiveness(const Pop& pop) const {
     return attractive;
 }
 
+/// @brief Computes the aggregates of this province from scratch
+AggregateStats Province::calc_stats() const noexcept {
+    AggregateStats result{};
+    for(const auto& pop : this->pops) {
+        result.total_pops += pop.size;
+        result.militancy += pop.militancy * pop.size;
+        result.literacy += pop.literacy * pop.size;
+        result.life_needs_met += pop.life_needs_met * pop.size;
+    }
+    if(result.total_pops > 0.f) {
+        result.militancy /= result.total_pops;
+        result.literacy /= result.total_pops;
+        result.life_needs_met /= result.total_pops;
+    }
+
+    for(const auto& building : this->buildings) {
+        result.gdp += building.revenue.outputs;
+        result.industrial_score += building.production_scale * building.level;
+    }
+    return result;
+}
+
 void Province::add_building(const BuildingType& building_type) {
     // Now build the building
     this->buildings[building_type].level += 1.f;
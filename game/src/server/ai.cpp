@@ -26,11 +26,13 @@
 #include <cstdlib>
 #include <cstring>
 #include <set>
+#include <chrono>
 #include <tbb/blocked_range.h>
 #include <tbb/concurrent_vector.h>
 #include <tbb/parallel_for.h>
 #include <tbb/combinable.h>
 
+#include "eng3d/arena.hpp"
 #include "eng3d/binary_image.hpp"
 #include "eng3d/serializer.hpp"
 #include "eng3d/log.hpp"
@@ -42,25 +44,37 @@
 #include "server/lua_api.hpp"
 #include "server/server_network.hpp"
 #include "server/ai.hpp"
+#include "server/ai_scheduler.hpp"
+#include "server/diplomacy_index.hpp"
+#include "server/investment_index.hpp"
 
 namespace AI {
     void init(World& world);
     void do_tick(World& world);
+    void set_seed(uint32_t seed);
 }
 
-std::vector<ProvinceId> g_water_provinces;
 std::vector<AIManager> ai_man;
+static uint32_t ai_seed = 1;
+
+/// @brief Seed used by the next AI::init, recorded by replays
+void AI::set_seed(uint32_t seed) {
+    ai_seed = seed;
+}
 
 void AI::init(World& world) {
-    g_water_provinces.reserve(world.provinces.size());
-    for(const auto& province : world.provinces)
-        if(world.terrain_types[province.terrain_type_id].is_water_body)
-            g_water_provinces.push_back(province);
+    ai_man.clear();
     ai_man.resize(world.nations.size());
-    for(auto& ai : ai_man) {
+    for(size_t i = 0; i < ai_man.size(); i++) {
+        auto& ai = ai_man[i];
+        ai.rng = Eng3D::Rand(ai_seed + static_cast<uint32_t>(i) * 0x9e3779b9);
         ai.recalc_military_weights();
         ai.recalc_economic_weights();
     }
+    ai_scheduler.init(world.nations.size(), world.time);
+    threat_map.invalidate();
+    diplomacy_index.invalidate();
+    investment_index.invalidate();
 }
 
 void AI::do_tick(World& world) {
@@ -92,13 +106,13 @@ void AI::do_tick(World& world) {
         BuildingId building_id;
     };
     tbb::combinable<std::vector<BuildUnit>> build_units;
-    struct BuildingInvestment {
+    struct InvestOnBuilding {
         NationId nation_id;
         ProvinceId province_id;
         BuildingId building_id;
         float amount;
     };
-    tbb::combinable<std::vector<BuildingInvestment>> building_investments;
+    tbb::combinable<std::vector<InvestOnBuilding>> building_investments;
     struct LoanPoolUpdate {
         NationId nation_id;
         float new_amount;
@@ -106,37 +120,60 @@ void AI::do_tick(World& world) {
     };
     tbb::combinable<std::vector<LoanPoolUpdate>> loan_pool_updates;
 
+    // Shared by the units movement of all the nations
+    world.profiler.start("AI-threats");
+    threat_map.update(world);
+    world.profiler.stop("AI-threats");
+    world.profiler.start("AI-diplomacy-index");
+    diplomacy_index.update(world, nation_strengths);
+    world.profiler.stop("AI-diplomacy-index");
+    world.profiler.start("AI-investment-index");
+    investment_index.update(world);
+    world.profiler.stop("AI-investment-index");
+
+    // Each phase only runs for the nations the scheduler hands it on this tick, timing them
+    // so the scheduler can keep the next ticks within the budget of the phase
+    ai_scheduler.update_urgency(world);
+    const auto run_phase = [&world](AIPhase phase, auto&& is_eligible, auto&& fn) {
+        const auto& nation_ids = ai_scheduler.plan(phase, world.time, [&](const NationId nation_id) {
+            return is_eligible(world.nations[nation_id]);
+        });
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, nation_ids.size()), [&](const auto& range) {
+            for(size_t i = range.begin(); i != range.end(); i++) {
+                auto& nation = world.nations[nation_ids[i]];
+                const auto start = std::chrono::steady_clock::now();
+                fn(nation, ai_man[nation]);
+                ai_scheduler.add_cost(phase, nation, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+        });
+        ai_scheduler.finish(phase, world.profiler);
+    };
+
     // --- UNITS MOVEMENT
-    tbb::parallel_for(tbb::blocked_range(world.nations.begin(), world.nations.end()), [&](auto& nations_range) {
-        for(auto& nation : nations_range) {
-            auto& ai = ai_man[nation];
-            if(!nation.ai_do_cmd_troops)
-                continue;
-            ai.calc_weights(nation);
-            ai.collect_eval_provinces(world, nation);
-            ai.calc_nation_risk(world, nation);
-            ai.calc_province_risk(world, nation);
-            // Move units to provinces with highest risk
-            for(const auto province_id : ai.eval_provinces) {
-                const auto& province = world.provinces[province_id];
-                const auto& unit_ids = world.unit_manager.get_province_units(province_id);
-                for(const auto unit_id : unit_ids) {
-                    auto& unit = world.unit_manager.units[unit_id];
-                    if(unit.owner_id != nation || !unit.can_move()) continue;
-                    bool can_set_target = true;
-                    if(unit.has_target_province())
-                        can_set_target = ai.get_rand() > ai.override_threshold;
-                    if(can_set_target) {
-                        const auto& highest_risk = ai.get_highest_priority_province(world, province, unit);
-                        // Above we made sure high_risk province is valid for us to step in
-                        //if(!world.terrain_types[highest_risk->terrain_type_id].is_water_body) continue;
-                        if(highest_risk.get_id() != province.get_id()) {
-                            UnitMove cmd{};
-                            cmd.nation_id = nation.get_id();
-                            cmd.unit_id = unit.get_id();
-                            cmd.target_province_id = highest_risk.get_id();
-                            unit_movements.local().push_back(cmd);
-                        }
+    run_phase(AIPhase::UNITS, [](const auto& nation) { return nation.ai_do_cmd_troops; }, [&](auto& nation, auto& ai) {
+        ai.calc_weights(nation);
+        ai.calc_nation_risk(world, nation);
+        // Move units to provinces with highest risk
+        for(const auto province_id : threat_map.get_unit_provinces(nation)) {
+            const auto& province = world.provinces[province_id];
+            if(!ai.can_evaluate(world, nation, province)) continue;
+            const auto& unit_ids = world.unit_manager.get_province_units(province_id);
+            for(const auto unit_id : unit_ids) {
+                auto& unit = world.unit_manager.units[unit_id];
+                if(unit.owner_id != nation || !unit.can_move()) continue;
+                bool can_set_target = true;
+                if(unit.has_target_province())
+                    can_set_target = ai.get_rand() > ai.override_threshold;
+                if(can_set_target) {
+                    const auto& highest_risk = ai.get_highest_priority_province(world, nation, province, unit);
+                    // Above we made sure high_risk province is valid for us to step in
+                    //if(!world.terrain_types[highest_risk->terrain_type_id].is_water_body) continue;
+                    if(highest_risk.get_id() != province.get_id()) {
+                        UnitMove cmd{};
+                        cmd.nation_id = nation.get_id();
+                        cmd.unit_id = unit.get_id();
+                        cmd.target_province_id = highest_risk.get_id();
+                        unit_movements.local().push_back(cmd);
                     }
                 }
             }
@@ -144,152 +181,100 @@ void AI::do_tick(World& world) {
     });
 
     // --- DIPLOMACY
-    tbb::parallel_for(tbb::blocked_range(world.nations.begin(), world.nations.end()), [&](auto& nations_range) {
-        for(auto& nation : nations_range) {
-            auto& ai = ai_man[nation];
-            if(!nation.ai_controlled)
-                continue;
-            // Ally other people also warring the people we're warring
-            auto our_strength = ai.military_strength;
-            auto enemy_strength = 0.f;
-            std::vector<NationId> enemy_ids, ally_ids;
-            for(const auto& other : world.nations) {
-                if(other.get_id() != nation.get_id()) {
-                    const auto& relation = world.get_relation(nation, other);
-                    if(relation.has_war) {
-                        enemy_strength += ai_man[other].military_strength;
-                        enemy_ids.push_back(other);
-                    } else if(relation.is_allied()) {
-                        our_strength += ai_man[other].military_strength;
-                        ally_ids.push_back(other);
+    run_phase(AIPhase::DIPLOMACY, [](const auto& nation) { return nation.ai_controlled; }, [&](auto& nation, auto& ai) {
+        // Ally other people also warring the people we're warring
+        auto our_strength = ai.military_strength;
+        auto enemy_strength = 0.f;
+        const auto& enemy_ids = diplomacy_index.get_enemies(nation);
+        for(const auto enemy_id : enemy_ids)
+            enemy_strength += ai_man[enemy_id].military_strength;
+        for(const auto ally_id : diplomacy_index.get_allies(nation))
+            our_strength += ai_man[ally_id].military_strength;
+        auto advantage = glm::max(our_strength, 1.f) / glm::max(enemy_strength, glm::epsilon<float>());
+        if(advantage < ai.strength_threshold) {
+            // The enemy is bigger; so re-evaluate stances, anyone sharing an enemy
+            // with us is a rival of it and therefore shortlisted
+            diplomacy_index.for_each_candidate(nation, [&](const NationId other_id) {
+                const auto& relation = world.get_relation(nation, other_id);
+                if(!relation.has_war) {
+                    // Propose an alliance iff we have mutual enemies
+                    for(const auto enemy_id : enemy_ids) {
+                        const auto& enemy_rel = world.get_relation(other_id, enemy_id);
+                        if(enemy_rel.has_war)
+                            alliance_proposals.local().emplace_back(nation, other_id);
                     }
                 }
-            }
-            auto advantage = glm::max(our_strength, 1.f) / glm::max(enemy_strength, glm::epsilon<float>());
-            if(advantage < ai.strength_threshold) {
-                // The enemy is bigger; so re-evaluate stances
-                for(const auto& other : world.nations) {
-                    if(other.get_id() != nation.get_id()) {
-                        const auto& relation = world.get_relation(nation, other);
-                        if(!relation.has_war) {
-                            // Propose an alliance iff we have mutual enemies
-                            for(const auto enemy_id : enemy_ids) {
-                                const auto& enemy_rel = world.get_relation(other, enemy_id);
-                                if(enemy_rel.has_war)
-                                    alliance_proposals.local().emplace_back(nation, other);
-                            }
-                        }
-                    }
-                }
-            }
+            });
         }
     });
 
     // --- WAR EFFORTS
-    tbb::parallel_for(tbb::blocked_range(world.nations.begin(), world.nations.end()), [&](auto& nations_range) {
-        for(auto& nation : nations_range) {
-            auto& ai = ai_man[nation];
-            if(!nation.ai_controlled)
-                continue;
-            // Build units inside buildings that are not doing anything
-            for(const auto province_id : nation.controlled_provinces) {
-                auto& province = world.provinces[province_id];
-                for(const auto& building_type : world.building_types) {
-                    if(!building_type.can_build_military()) continue;
-                    auto& building = province.buildings[static_cast<size_t>(building_type.get_id())];
-                    if(!building.can_do_output(province, building_type.input_ids))
-                        continue;
-                    /// @todo Actually produce something appropriate
-                    auto& unit_type = world.unit_types[rand() % world.unit_types.size()];
+    run_phase(AIPhase::WAR, [](const auto& nation) { return nation.ai_controlled; }, [&](auto& nation, auto& ai) {
+        // Build units inside buildings that are not doing anything
+        for(const auto province_id : nation.controlled_provinces) {
+            auto& province = world.provinces[province_id];
+            for(const auto& building_type : world.building_types) {
+                if(!building_type.can_build_military()) continue;
+                auto& building = province.buildings[static_cast<size_t>(building_type.get_id())];
+                if(!building.can_do_output(province, building_type.input_ids))
+                    continue;
+                /// @todo Actually produce something appropriate
+                auto& unit_type = world.unit_types[ai.rng() % world.unit_types.size()];
 
-                    BuildUnit cmd{};
-                    cmd.nation_id = nation.get_id();
-                    cmd.province_id = province_id;
-                    cmd.building_id = BuildingId(static_cast<size_t>(building_type.get_id()));
-                    cmd.unit_type_id = unit_type.get_id();
-                    //build_units.local().push_back(cmd);
-                }
+                BuildUnit cmd{};
+                cmd.nation_id = nation.get_id();
+                cmd.province_id = province_id;
+                cmd.building_id = BuildingId(static_cast<size_t>(building_type.get_id()));
+                cmd.unit_type_id = unit_type.get_id();
+                //build_units.local().push_back(cmd);
             }
         }
     });
 
     // -- ECONOMY INVESTMENTS
-    tbb::parallel_for(tbb::blocked_range(world.nations.begin(), world.nations.end()), [&](auto& nations_range) {
-        for(auto& nation : nations_range) {
-            auto& ai = ai_man[nation];
-            if(!(nation.ai_controlled && nation.can_directly_control_factories()))
-                continue;
-            // How do we know which factories we should be investing om? We first have to know
-            // if we can invest them in the first place, which is what "can_directly_control_factories"
-            // answers for us.
-            for(const auto province_id : nation.controlled_provinces) {
-                auto& province = world.provinces[province_id];
+    run_phase(AIPhase::INVESTMENTS, [](const auto& nation) { return nation.ai_controlled && nation.can_directly_control_factories(); }, [&](auto& nation, auto& ai) {
+        // How do we know which factories we should be investing om? We first have to know
+        // if we can invest them in the first place, which is what "can_directly_control_factories"
+        // answers for us.
+        // The investment index already ranked the buildings of all our provinces by how much
+        // their commodity is needed, so we only have to pop the best ones off its heap
+        const auto& best = investment_index.get_heap(nation);
+        std::pmr::vector<InvestmentIndex::Opportunity> heap(best.begin(), best.end(), Eng3D::TickArena::get());
 
-                // Obtain list of products
-                std::vector<CommodityId> v;
-                v.resize(world.commodities.size());
-                for(const auto& commodity : world.commodities)
-                    v[commodity] = commodity;
-                // Sort by most important to fullfill (higher D/S ratio)
-                std::sort(v.begin(), v.end(), [&](const auto& a, const auto& b) {
-                    return province.products[a].sd_ratio() > province.products[b].sd_ratio();
-                });
+        /// @todo Dynamically allocate investment funds
+        // Invest for every tick since the last time, so the period doesn't change how much is spent
+        auto investment_alloc = nation.revenue.get_total() * ai.investment_aggressiveness * ai_scheduler.get_elapsed(AIPhase::INVESTMENTS, nation);
+        while(!heap.empty() && investment_alloc > 0.f) {
+            std::pop_heap(heap.begin(), heap.end());
+            const auto opportunity = heap.back();
+            heap.pop_back();
 
-                const auto total_demand = std::accumulate(province.products.begin(), province.products.end(), 0.f,
-                    [](const auto a, const auto& product) {
-                    return a + product.demand;
-                });
+            // Do not invest in buildings that are not in need of money (eg. not in the red)
+            const auto& province = world.provinces[opportunity.province_id];
+            if(province.controller_id != nation.get_id() || province.buildings[opportunity.building_type_id].budget > 0.f) continue;
+            // The priority to invest here is the share of the demand of the province that this
+            // commodity represents, the more demand the more priority it would be given
+            const auto investment = investment_alloc * opportunity.priority;
+            investment_alloc -= investment;
 
-                /// @todo Dynamically allocate investment funds
-                auto investment_alloc = nation.revenue.get_total() * ai.investment_aggressiveness;
-                for(const auto& commodity_id : v) {
-                    if(investment_alloc <= 0.f) break;
-
-                    // We now have the most demanded product indice, we will now find an industry type
-                    // we should invest on to make more of that product
-                    const auto it = std::find_if(world.building_types.begin(), world.building_types.end(), [&](const auto& e) {
-                        return e.output_id.has_value() && e.output_id.value() == commodity_id;
-                    });
-
-                    if(it == world.building_types.end()) continue;
-
-                    // Do not invest in buildings that are not in need of money (eg. not in the red)
-                    if(province.buildings[*it].budget > 0.f) continue;
-
-                    const auto& product = province.products[commodity_id];
-                    if(product.demand == 0.f) continue;
-                    // Obtain the priority to invest here, the more demand this represents of the total
-                    // demand on the given province, the more priority it would be given
-                    const auto priority = product.demand / total_demand;
-                    const auto investment = investment_alloc * priority;
-                    investment_alloc -= investment;
-
-                    BuildingInvestment cmd{};
-                    cmd.nation_id = nation.get_id();
-                    cmd.province_id = province_id;
-                    cmd.building_id = BuildingId(static_cast<size_t>(it->get_id()));
-                    cmd.amount = investment;
-                    building_investments.local().push_back(cmd);
-                }
-            }
+            InvestOnBuilding cmd{};
+            cmd.nation_id = nation.get_id();
+            cmd.province_id = opportunity.province_id;
+            cmd.building_id = BuildingId(static_cast<size_t>(opportunity.building_type_id));
+            cmd.amount = investment;
+            building_investments.local().push_back(cmd);
         }
     });
 
     // -- LOANS
-    tbb::parallel_for(tbb::blocked_range(world.nations.begin(), world.nations.end()), [&](auto& nations_range) {
-        for(auto& nation : nations_range) {
-            auto& ai = ai_man[nation];
-            if(!nation.ai_controlled)
-                continue;
-            
-            LoanPoolUpdate cmd{};
-            cmd.nation_id = nation.get_id();
-            cmd.new_amount = nation.revenue.get_total() * ai.loan_aggressiveness;
-            cmd.new_interest = ai.current_interest_rate;
-            // Increment rates for loans
-            ai.current_interest_rate += 0.01f * (nation.expenses.public_loans > nation.revenue.public_loans ? 1 : -1);
-            loan_pool_updates.local().push_back(cmd);
-        }
+    run_phase(AIPhase::LOANS, [](const auto& nation) { return nation.ai_controlled; }, [&](auto& nation, auto& ai) {
+        LoanPoolUpdate cmd{};
+        cmd.nation_id = nation.get_id();
+        cmd.new_amount = nation.revenue.get_total() * ai.loan_aggressiveness;
+        cmd.new_interest = ai.current_interest_rate;
+        // Increment rates for loans, as much as if it had been done on every tick
+        ai.current_interest_rate += 0.01f * ai_scheduler.get_elapsed(AIPhase::LOANS, nation) * (nation.expenses.public_loans > nation.revenue.public_loans ? 1 : -1);
+        loan_pool_updates.local().push_back(cmd);
     });
 
     unit_movements.combine_each([&](const auto& list) {
@@ -316,7 +301,7 @@ void AI::do_tick(World& world) {
             if(province.controller_id == e.nation_id)
                 province.buildings[e.building_id].estate_state.invest(e.amount);
             else
-                province.buildings[e.building_id].estate_foreign[e.nation_id].invest(e.amount);
+                province.buildings[e.building_id].get_foreign_investment(e.nation_id).invest(e.amount);
         }
     });
 
@@ -333,10 +318,7 @@ void AI::do_tick(World& world) {
     /// @todo AI reject alliance proposals and so on; also allow the player to reject
     /// their alliance proposals too!
     alliance_proposals.combine_each([&](const auto& alliance_proposals_range) {
-        for(const auto& [nation_id, other_id] : alliance_proposals_range) {
-            const auto& nation = world.nations[nation_id];
-            const auto& other_nation = world.nations[other_id];
-            world.fire_special_event("special_alliance", nation.ref_name.data(), other_nation.ref_name.data());
-        }
+        for(const auto& [nation_id, other_id] : alliance_proposals_range)
+            world.fire_special_event("special_alliance", nation_id, other_id);
     });
 }
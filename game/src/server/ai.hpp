@@ -26,9 +26,9 @@
 
 #include <vector>
 #include "eng3d/entity.hpp"
+#include "eng3d/rand.hpp"
 #include "world.hpp"
-
-extern std::vector<ProvinceId> g_water_provinces;
+#include "server/threat_map.hpp"
 
 struct AIManager {
     // --- MILITARY ---
@@ -43,8 +43,6 @@ struct AIManager {
     float override_threshold = 1.f; // Threshold for overriding orders of units
     float conqueror_weight = 1.f; // How much this nation is going to conquer others for no reason
     std::vector<float> nations_risk_factor;
-    std::vector<float> potential_risk;
-    std::vector<ProvinceId> eval_provinces;
     size_t last_constrolled_cnt = 0;
     size_t gains = 0;
     size_t losses = 0;
@@ -56,12 +54,12 @@ struct AIManager {
     float interest_aggressiveness = 1.f; // Aggressiveness when setting the interest rates
     float loan_aggressiveness = 1.f; // Aggressiveness to loan out and murder the economy
 
-    AIManager() {
-        potential_risk.resize(g_world.provinces.size(), 1.f);
-    }
+    /// @brief Seeded per nation by AI::init, so the choices of the AI don't depend on
+    /// how the nations are scheduled between threads and a replay makes the same ones
+    mutable Eng3D::Rand rng;
 
     float get_rand() const {
-        return glm::max<float>(rand() % 100, 1.f) / 100.f;
+        return glm::max<float>(rng() % 100, 1.f) / 100.f;
     }
 
     /// @brief Reshuffle weights of the AI
@@ -99,20 +97,6 @@ struct AIManager {
         last_constrolled_cnt = new_controlled_cnt;
     }
 
-    void collect_eval_provinces(const World& world, const Nation& nation) {
-        // Provinces that can be evaluated in our AI
-        eval_provinces = g_water_provinces;
-        eval_provinces.reserve(world.provinces.size());
-        eval_provinces.insert(eval_provinces.end(), nation.controlled_provinces.begin(), nation.controlled_provinces.end()); // Add our own nation's province ids
-        for(const auto& other : world.nations) {
-            if(&other != &nation) {
-                const auto& relation = world.get_relation(nation, other);
-                if(relation.has_landpass())
-                    eval_provinces.insert(eval_provinces.end(), other.controlled_provinces.begin(), other.controlled_provinces.end());
-            }
-        }
-    }
-
     float get_nation_risk(const World& world, const Nation& nation, const Nation& other) {
         const auto& relation = world.get_relation(nation, other);
         float factor = relation.has_war ? war_weight : -relation.relation;
@@ -127,56 +111,69 @@ struct AIManager {
         nations_risk_factor[nation] = -1.f;
     }
 
-    void calc_province_risk(const World& world, const Nation& nation) {
-        std::fill(potential_risk.begin(), potential_risk.end(), 1.f);
-        // Calculate potential risk for every province
-        for(const auto province_id : eval_provinces) {
-            const auto& province = world.provinces[province_id];
-            auto draw_in_force = 1.f;
+    /// @brief Whether our units can be ordered around the province: water, ours or passable
+    bool can_evaluate(const World& world, const Nation& nation, const Province& province) const {
+        if(world.terrain_types[province.terrain_type_id].is_water_body || province.controller_id == nation)
+            return true;
+        return Nation::is_valid(province.controller_id) && world.get_relation(nation, province.controller_id).has_landpass();
+    }
+
+    /// @brief Forces weighted by how much we fear (or trust) their owners
+    float get_forces_risk(const std::vector<ThreatMap::Presence>& presences) const {
+        auto risk = 0.f;
+        for(const auto& presence : presences)
+            risk += (presence.strength * unit_exist_weight + presence.battle_strength * unit_battle_weight) * nations_risk_factor[presence.nation_id];
+        return risk;
+    }
+
+    /// @brief Whether calc_nation_risk was done and the threat map was built
+    bool has_province_risk(const World& world) const {
+        return nations_risk_factor.size() == world.nations.size() && threat_map.is_built();
+    }
+
+    /// @brief Potential risk of a province, out of the shared threat map, calc_nation_risk must be done beforehand
+    float get_province_risk(const World& world, const Nation& nation, ProvinceId province_id) const {
+        const auto& province = world.provinces[province_id];
+        auto risk = 1.f;
+        if(this->can_evaluate(world, nation, province)) {
             // The "cooling" value which basically makes us ignore some provinces with lots of defenses
             // so we don't rack up deathstacks on a border with some micronation
-            const auto& unit_ids = world.unit_manager.get_province_units(province_id);
-            for(const auto unit_id : unit_ids) {
-                const auto& unit = world.unit_manager.units[unit_id];
-                const auto& unit_owner = world.nations[unit.owner_id];
-                const auto unit_weight = unit.on_battle ? unit_battle_weight : unit_exist_weight;
-                draw_in_force += unit.get_strength() * unit_weight * nations_risk_factor[unit_owner];
-            }
-
+            auto draw_in_force = 1.f + this->get_forces_risk(threat_map.get_local(province_id));
             if(province.is_coastal)
                 draw_in_force *= coastal_weight;
             if(!world.terrain_types[province.terrain_type_id].is_water_body) {
                 // Try to recover our own lost provinces
                 if(province.owner_id == nation && province.controller_id != nation)
                     draw_in_force *= reconquer_weight;
-                draw_in_force += nations_risk_factor[province.controller_id];
+                if(Nation::is_valid(province.controller_id))
+                    draw_in_force += nations_risk_factor[province.controller_id];
             }
-            potential_risk[province_id] += draw_in_force;
-        }
-
-        // Spread out the heat
-        for(const auto province_id : eval_provinces) {
-            const auto& province = world.provinces[province_id];
-            for(const auto neighbour_id : province.neighbour_ids)
-                potential_risk[neighbour_id] += potential_risk[province_id] / province.neighbour_ids.size();
+            risk += draw_in_force;
         }
+        // Spread out the heat of the neighbours
+        return risk + this->get_forces_risk(threat_map.get_nearby(province_id));
     }
 
-    const Province& get_highest_priority_province(const World& world, const Province& start, const Unit& unit) {
-        // See which province has the most potential_risk so we cover it from potential threats
+    const Province& get_highest_priority_province(const World& world, const Nation& nation, const Province& start, const Unit& unit) const {
+        // See which province has the most potential risk so we cover it from potential threats
         const auto* highest_risk = &start;
+        auto highest_risk_value = this->get_province_risk(world, nation, start);
         for(const auto neighbour_id : start.neighbour_ids) {
             const auto& neighbour = world.provinces[neighbour_id];
             // If going to water, must be a naval/amphibious/airplane unit
             //if(!world.unit_types[unit.type_id].is_naval && world.terrain_types[neighbour.terrain_type_id].is_water_body) continue;
 
-            if(potential_risk[neighbour_id] >= potential_risk[highest_risk->get_id()]) {
+            const auto risk = this->get_province_risk(world, nation, neighbour_id);
+            if(risk >= highest_risk_value) {
                 if(neighbour.controller_id != unit.owner_id) {
                     const auto& relation = world.get_relation(neighbour.controller_id, unit.owner_id);
-                    if(relation.has_landpass())
+                    if(relation.has_landpass()) {
                         highest_risk = &neighbour;
+                        highest_risk_value = risk;
+                    }
                 } else {
                     highest_risk = &neighbour;
+                    highest_risk_value = risk;
                 }
             }
         }
@@ -0,0 +1,121 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/ai_scheduler.cpp
+//
+// Abstract:
+//      Decides which nations run each phase of the AI on a given tick.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <string>
+
+#include "world.hpp"
+#include "server/ai_scheduler.hpp"
+#include "server/diplomacy_index.hpp"
+
+AIScheduler ai_scheduler;
+
+static const std::array<std::string, ai_phase_count> phase_zones = {
+    "AI-units", "AI-diplomacy", "AI-war", "AI-investments", "AI-loans"
+};
+
+AIScheduler::AIScheduler() {
+    // Units react to the wars as they happen, the economy can wait a few days
+    this->set_config(AIPhase::UNITS, PhaseConfig{ 2, 1, 4.f });
+    this->set_config(AIPhase::DIPLOMACY, PhaseConfig{ 8, 2, 1.f });
+    this->set_config(AIPhase::WAR, PhaseConfig{ 4, 1, 1.f });
+    this->set_config(AIPhase::INVESTMENTS, PhaseConfig{ 4, 4, 2.f });
+    this->set_config(AIPhase::LOANS, PhaseConfig{ 8, 8, 0.5f });
+}
+
+void AIScheduler::init(size_t n_nations, int tick) {
+    this->urgent.assign(n_nations, 0);
+    for(auto& state : this->phases) {
+        const auto period = static_cast<int>(std::max<uint32_t>(state.config.period, 1));
+        state.stats = PhaseStats{};
+        state.last_run.resize(n_nations);
+        // Spread the nations over the period so they don't all come due on the same tick
+        for(size_t i = 0; i < n_nations; i++)
+            state.last_run[i] = tick - period + static_cast<int>(i % period);
+        state.elapsed.assign(n_nations, 0);
+        state.estimated_ms.assign(n_nations, -1.f);
+        state.last_ms.assign(n_nations, 0.f);
+        state.total_ms.assign(n_nations, 0.f);
+        state.mean_ms = 0.f;
+        state.planned.clear();
+    }
+}
+
+void AIScheduler::update_urgency(const World& world) {
+    for(const auto& nation : world.nations)
+        this->urgent[nation] = diplomacy_index.get_enemies(nation).empty() ? 0 : 1;
+
+    for(const auto& nation : world.nations)
+        if(!nation.ai_controlled)
+            for(const auto neighbour_id : diplomacy_index.get_neighbours(nation))
+                this->urgent[neighbour_id] = 1;
+}
+
+void AIScheduler::select(AIPhase phase, int tick) {
+    auto& state = this->phases[static_cast<size_t>(phase)];
+    state.planned.clear();
+    // Most overdue relative to their own period first, ties by id so the order doesn't
+    // depend on anything but the world
+    std::sort(this->candidates.begin(), this->candidates.end(), [&](const auto a, const auto b) {
+        const auto late_a = static_cast<int64_t>(tick - state.last_run[a]) * this->get_period(phase, b);
+        const auto late_b = static_cast<int64_t>(tick - state.last_run[b]) * this->get_period(phase, a);
+        if(late_a != late_b)
+            return late_a > late_b;
+        return a < b;
+    });
+
+    const bool has_budget = this->budgeted && state.config.budget_ms > 0.f;
+    auto estimated_ms = 0.f;
+    for(const auto nation_id : this->candidates) {
+        // Nations that never ran are guessed to cost as much as the average one
+        const auto nation_ms = state.estimated_ms[nation_id] >= 0.f ? state.estimated_ms[nation_id] : state.mean_ms;
+        if(has_budget && !state.planned.empty() && estimated_ms + nation_ms > state.config.budget_ms)
+            break;
+        estimated_ms += nation_ms;
+        state.elapsed[nation_id] = static_cast<uint32_t>(tick - state.last_run[nation_id]);
+        state.last_run[nation_id] = tick;
+        state.planned.push_back(nation_id);
+    }
+    state.stats.ran = state.planned.size();
+    state.stats.deferred = this->candidates.size() - state.planned.size();
+}
+
+void AIScheduler::finish(AIPhase phase, Eng3D::Profiler& profiler) {
+    auto& state = this->phases[static_cast<size_t>(phase)];
+    state.stats.ms = 0.f;
+    state.stats.max_nation_ms = 0.f;
+    for(const auto nation_id : state.planned) {
+        const auto ms = state.last_ms[nation_id];
+        state.stats.ms += ms;
+        state.stats.max_nation_ms = std::max(state.stats.max_nation_ms, ms);
+        auto& estimated_ms = state.estimated_ms[nation_id];
+        estimated_ms = estimated_ms >= 0.f ? estimated_ms * 0.75f + ms * 0.25f : ms;
+        state.mean_ms = state.mean_ms > 0.f ? state.mean_ms * 0.95f + ms * 0.05f : ms;
+    }
+    if(state.planned.empty()) return;
+    const auto& zone = phase_zones[static_cast<size_t>(phase)];
+    profiler.record(zone, state.stats.ms);
+    // The most expensive nation of the tick, so a single outlier can be told apart from many cheap nations
+    profiler.record(zone + "-nation", state.stats.max_nation_ms);
+}
@@ -0,0 +1,162 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/ai_scheduler.hpp
+//
+// Abstract:
+//      Decides which nations run each phase of the AI on a given tick.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "eng3d/profiler.hpp"
+#include "world.hpp"
+
+/// @brief Phases of the AI turn, each one is scheduled on its own
+enum class AIPhase : uint8_t {
+    UNITS,
+    DIPLOMACY,
+    WAR,
+    INVESTMENTS,
+    LOANS,
+};
+constexpr size_t ai_phase_count = 5;
+
+/// @brief Time slices the AI. A phase runs for a nation every `period` ticks, or every
+/// `urgent_period` ticks if the nation is at war or borders a player. The nations that
+/// are due are taken most overdue first until their estimated cost fills the budget of
+/// the phase, the rest stay due and are taken first on the next ticks
+class AIScheduler {
+public:
+    struct PhaseConfig {
+        uint32_t period = 1;
+        uint32_t urgent_period = 1;
+        float budget_ms = 0.f; // CPU time summed over all threads, 0 for no limit
+    };
+
+    /// @brief Counters of the last tick a phase was planned on
+    struct PhaseStats {
+        float ms = 0.f; // CPU time summed over all threads
+        float max_nation_ms = 0.f;
+        size_t ran = 0;
+        size_t deferred = 0; // Due but left for a later tick
+    };
+
+    AIScheduler();
+    void init(size_t n_nations, int tick);
+    /// @brief Marks the nations at war or bordering a player nation, once per tick after
+    /// the diplomacy index is updated
+    void update_urgency(const World& world);
+
+    /// @brief Nations that run the phase on this tick, most overdue first
+    template<typename F>
+    const std::vector<NationId>& plan(AIPhase phase, int tick, F&& is_eligible) {
+        auto& state = this->phases[static_cast<size_t>(phase)];
+        this->candidates.clear();
+        for(size_t i = 0; i < state.last_run.size(); i++) {
+            const NationId nation_id(i);
+            if(!this->is_due(phase, nation_id, tick))
+                continue;
+            // Nations the phase doesn't apply to start their period over, otherwise they
+            // would have every tick since init to catch up on once they become eligible
+            if(is_eligible(nation_id))
+                this->candidates.push_back(nation_id);
+            else
+                state.last_run[nation_id] = tick;
+        }
+        this->select(phase, tick);
+        return state.planned;
+    }
+
+    /// @brief Ticks since the phase last ran for the nation, as of the last plan
+    uint32_t get_elapsed(AIPhase phase, NationId nation_id) const {
+        return this->phases[static_cast<size_t>(phase)].elapsed[nation_id];
+    }
+
+    /// @brief Called by the workers once per planned nation, so no two threads write the same one
+    void add_cost(AIPhase phase, NationId nation_id, float ms) {
+        auto& state = this->phases[static_cast<size_t>(phase)];
+        state.last_ms[nation_id] = ms;
+        state.total_ms[nation_id] += ms;
+    }
+
+    /// @brief Sums the costs of the planned nations and records them onto the profiler
+    void finish(AIPhase phase, Eng3D::Profiler& profiler);
+
+    /// @brief Disables the budgets so the same nations run regardless of how fast the machine
+    /// is, replays need it. Periods still apply since they only depend on the tick
+    void set_budgeted(bool value) {
+        this->budgeted = value;
+    }
+
+    void set_config(AIPhase phase, const PhaseConfig& config) {
+        this->phases[static_cast<size_t>(phase)].config = config;
+    }
+
+    const PhaseConfig& get_config(AIPhase phase) const {
+        return this->phases[static_cast<size_t>(phase)].config;
+    }
+
+    const PhaseStats& get_stats(AIPhase phase) const {
+        return this->phases[static_cast<size_t>(phase)].stats;
+    }
+
+    /// @brief CPU time spent on the phase for the nation since init
+    float get_nation_ms(AIPhase phase, NationId nation_id) const {
+        return this->phases[static_cast<size_t>(phase)].total_ms[nation_id];
+    }
+
+    bool is_urgent(NationId nation_id) const {
+        return this->urgent[nation_id] != 0;
+    }
+private:
+    struct PhaseState {
+        PhaseConfig config;
+        PhaseStats stats;
+        std::vector<int> last_run;
+        std::vector<uint32_t> elapsed;
+        std::vector<float> estimated_ms; // Moving average of the cost of the nation
+        std::vector<float> last_ms;
+        std::vector<float> total_ms;
+        float mean_ms = 0.f; // Guess for the nations that haven't ran yet
+        std::vector<NationId> planned;
+    };
+
+    uint32_t get_period(AIPhase phase, NationId nation_id) const {
+        const auto& config = this->phases[static_cast<size_t>(phase)].config;
+        return this->urgent[nation_id] ? config.urgent_period : config.period;
+    }
+
+    bool is_due(AIPhase phase, NationId nation_id, int tick) const {
+        const auto& state = this->phases[static_cast<size_t>(phase)];
+        return tick - state.last_run[nation_id] >= static_cast<int>(this->get_period(phase, nation_id));
+    }
+
+    void select(AIPhase phase, int tick);
+
+    std::array<PhaseState, ai_phase_count> phases;
+    std::vector<uint8_t> urgent;
+    std::vector<NationId> candidates;
+    bool budgeted = true;
+};
+
+extern AIScheduler ai_scheduler;
@@ -0,0 +1,172 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/diplomacy_index.cpp
+//
+// Abstract:
+//      Shortlists of the nations the AI of each nation does diplomacy with.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "world.hpp"
+#include "server/diplomacy_index.hpp"
+
+DiplomacyIndex diplomacy_index;
+
+void DiplomacyIndex::update(const World& world, const std::vector<float>& strengths) {
+    if(!this->is_valid || this->entries.size() != world.nations.size()) {
+        this->entries.assign(world.nations.size(), Entry{});
+        this->relations_dirty.clear();
+        this->borders_dirty.clear();
+        this->candidates_dirty.clear();
+        this->is_valid = true;
+        for(const auto& nation : world.nations) {
+            this->mark_relations(nation);
+            this->mark_borders(nation);
+            this->mark_candidates(nation);
+        }
+    }
+
+    // Refreshing marks more nations, so these lists only grow candidates_dirty
+    for(const auto nation_id : this->relations_dirty)
+        this->refresh_relations(world, nation_id);
+    this->relations_dirty.clear();
+    for(const auto nation_id : this->borders_dirty)
+        this->refresh_borders(world, nation_id);
+    this->borders_dirty.clear();
+    for(const auto nation_id : this->candidates_dirty)
+        this->refresh_candidates(nation_id);
+    this->refreshed = this->candidates_dirty.size();
+    this->candidates_dirty.clear();
+
+    // Strengths change every tick, ranking them is cheap enough to do it every time
+    this->by_strength.clear();
+    for(const auto& nation : world.nations)
+        if(nation.exists())
+            this->by_strength.push_back(nation);
+    std::sort(this->by_strength.begin(), this->by_strength.end(), [&strengths](const auto a, const auto b) {
+        if(strengths[a] != strengths[b])
+            return strengths[a] > strengths[b];
+        return a < b;
+    });
+    this->strength_rank.assign(world.nations.size(), world.nations.size());
+    for(size_t i = 0; i < this->by_strength.size(); i++)
+        this->strength_rank[this->by_strength[i]] = i;
+}
+
+void DiplomacyIndex::on_relation_change(NationId nation_id, NationId other_id) {
+    this->mark_relations(nation_id);
+    this->mark_relations(other_id);
+}
+
+void DiplomacyIndex::on_control_change(const World& world, ProvinceId province_id, NationId old_controller_id, NationId new_controller_id) {
+    this->mark_borders(old_controller_id);
+    this->mark_borders(new_controller_id);
+    // Whoever is next to the province may have gained or lost a neighbour
+    for(const auto neighbour_id : world.provinces[province_id].neighbour_ids)
+        this->mark_borders(world.provinces[neighbour_id].controller_id);
+}
+
+void DiplomacyIndex::mark_relations(NationId nation_id) {
+    // Everything is rebuilt anyways
+    if(!this->is_valid || static_cast<size_t>(nation_id) >= this->entries.size()) return;
+    auto& entry = this->entries[nation_id];
+    if(!entry.relations_dirty) {
+        entry.relations_dirty = true;
+        this->relations_dirty.push_back(nation_id);
+    }
+}
+
+void DiplomacyIndex::mark_borders(NationId nation_id) {
+    if(!this->is_valid || static_cast<size_t>(nation_id) >= this->entries.size()) return;
+    auto& entry = this->entries[nation_id];
+    if(!entry.borders_dirty) {
+        entry.borders_dirty = true;
+        this->borders_dirty.push_back(nation_id);
+    }
+}
+
+void DiplomacyIndex::mark_candidates(NationId nation_id) {
+    if(!this->is_valid || static_cast<size_t>(nation_id) >= this->entries.size()) return;
+    auto& entry = this->entries[nation_id];
+    if(!entry.candidates_dirty) {
+        entry.candidates_dirty = true;
+        this->candidates_dirty.push_back(nation_id);
+    }
+}
+
+void DiplomacyIndex::refresh_relations(const World& world, NationId nation_id) {
+    auto& entry = this->entries[nation_id];
+    entry.relations_dirty = false;
+    std::vector<NationId> enemies, allies;
+    for(const auto& other : world.nations) {
+        if(other.get_id() == nation_id) continue;
+        const auto& relation = world.get_relation(nation_id, other);
+        if(relation.has_war)
+            enemies.push_back(other);
+        else if(relation.is_allied())
+            allies.push_back(other);
+    }
+    if(enemies == entry.enemies && allies == entry.allies) return;
+
+    // Our enemies see their rivals change, and our allies the allies of their allies
+    for(const auto other_id : entry.enemies) this->mark_candidates(other_id);
+    for(const auto other_id : entry.allies) this->mark_candidates(other_id);
+    for(const auto other_id : enemies) this->mark_candidates(other_id);
+    for(const auto other_id : allies) this->mark_candidates(other_id);
+    this->mark_candidates(nation_id);
+    entry.enemies = std::move(enemies);
+    entry.allies = std::move(allies);
+}
+
+void DiplomacyIndex::refresh_borders(const World& world, NationId nation_id) {
+    auto& entry = this->entries[nation_id];
+    entry.borders_dirty = false;
+    std::vector<NationId> neighbours;
+    for(const auto province_id : world.nations[nation_id].controlled_provinces) {
+        for(const auto neighbour_id : world.provinces[province_id].neighbour_ids) {
+            const auto controller_id = world.provinces[neighbour_id].controller_id;
+            if(Nation::is_valid(controller_id) && controller_id != nation_id)
+                neighbours.push_back(controller_id);
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    if(neighbours == entry.neighbours) return;
+    entry.neighbours = std::move(neighbours);
+    this->mark_candidates(nation_id);
+}
+
+void DiplomacyIndex::refresh_candidates(NationId nation_id) {
+    auto& entry = this->entries[nation_id];
+    entry.candidates_dirty = false;
+    auto& candidates = entry.candidates;
+    candidates = entry.neighbours;
+    for(const auto enemy_id : entry.enemies) {
+        const auto& rivals = this->entries[enemy_id].enemies;
+        candidates.insert(candidates.end(), rivals.begin(), rivals.end());
+    }
+    for(const auto ally_id : entry.allies) {
+        const auto& allies = this->entries[ally_id].allies;
+        candidates.insert(candidates.end(), allies.begin(), allies.end());
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    std::erase(candidates, nation_id);
+}
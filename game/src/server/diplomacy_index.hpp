@@ -0,0 +1,121 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/diplomacy_index.hpp
+//
+// Abstract:
+//      Shortlists of the nations the AI of each nation does diplomacy with.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "world.hpp"
+
+/// @brief Keeps the enemies and allies of every nation and a shortlist of the nations
+/// worth doing diplomacy with: the ones bordering it, the enemies of its enemies (rivals),
+/// the allies of its allies and the ones right above and below it in military strength.
+/// Wars, alliances and borders only mark the nations they affect, whose lists are then
+/// rebuilt on the next update, so the AI never has to scan every pair of nations.
+/// Must only be used by the world thread
+class DiplomacyIndex {
+public:
+    /// @brief Rebuild what was marked, or everything if invalidated, and rank the nations
+    /// by the given military strengths. Called once per tick
+    void update(const World& world, const std::vector<float>& strengths);
+    /// @brief Everything will be rebuilt on the next update, i.e after loading a savefile
+    void invalidate() noexcept {
+        this->is_valid = false;
+    }
+
+    /// @brief A war, alliance or relation between the two nations changed
+    void on_relation_change(NationId nation_id, NationId other_id);
+    void on_control_change(const World& world, ProvinceId province_id, NationId old_controller_id, NationId new_controller_id);
+
+    const std::vector<NationId>& get_enemies(NationId nation_id) const {
+        return this->entries[nation_id].enemies;
+    }
+
+    const std::vector<NationId>& get_allies(NationId nation_id) const {
+        return this->entries[nation_id].allies;
+    }
+
+    /// @brief Nations controlling a province next to one of ours, sorted by id
+    const std::vector<NationId>& get_neighbours(NationId nation_id) const {
+        return this->entries[nation_id].neighbours;
+    }
+
+    /// @brief Bordering nations, rivals and allies of allies, sorted by id
+    const std::vector<NationId>& get_candidates(NationId nation_id) const {
+        return this->entries[nation_id].candidates;
+    }
+
+    /// @brief Calls fn once for each nation of the shortlist, strength peers included
+    template<typename F>
+    void for_each_candidate(NationId nation_id, F&& fn) const {
+        const auto& candidates = this->entries[nation_id].candidates;
+        for(const auto other_id : candidates)
+            fn(other_id);
+        const auto rank = this->strength_rank[nation_id];
+        if(rank >= this->by_strength.size()) return; // Doesn't exist
+        const auto first = rank > this->strength_peers / 2 ? rank - this->strength_peers / 2 : 0;
+        const auto last = std::min(this->by_strength.size(), rank + this->strength_peers / 2 + 1);
+        for(size_t i = first; i < last; i++) {
+            const auto other_id = this->by_strength[i];
+            if(other_id != nation_id && !std::binary_search(candidates.begin(), candidates.end(), other_id))
+                fn(other_id);
+        }
+    }
+
+    /// @brief Nations whose shortlist was rebuilt on the last update
+    size_t get_refreshed() const {
+        return this->refreshed;
+    }
+
+    size_t strength_peers = 8; // Nations around in strength that are shortlisted
+private:
+    struct Entry {
+        std::vector<NationId> enemies;
+        std::vector<NationId> allies;
+        std::vector<NationId> neighbours;
+        std::vector<NationId> candidates;
+        bool relations_dirty = false;
+        bool borders_dirty = false;
+        bool candidates_dirty = false;
+    };
+
+    void mark_relations(NationId nation_id);
+    void mark_borders(NationId nation_id);
+    void mark_candidates(NationId nation_id);
+    void refresh_relations(const World& world, NationId nation_id);
+    void refresh_borders(const World& world, NationId nation_id);
+    void refresh_candidates(NationId nation_id);
+
+    bool is_valid = false;
+    std::vector<Entry> entries;
+    std::vector<NationId> relations_dirty;
+    std::vector<NationId> borders_dirty;
+    std::vector<NationId> candidates_dirty;
+    std::vector<NationId> by_strength; // Existing nations, strongest first
+    std::vector<size_t> strength_rank; // Position of each nation on by_strength
+    size_t refreshed = 0;
+};
+
+extern DiplomacyIndex diplomacy_index;
@@ -39,12 +39,15 @@
 #include <glm/geometric.hpp>
 
 #include "eng3d/pathfind.hpp"
+#include "eng3d/arena.hpp"
 #include "eng3d/log.hpp"
 #include "eng3d/serializer.hpp"
 #include "eng3d/rand.hpp"
 
 #include "action.hpp"
 #include "server/economy.hpp"
+#include "server/pop_needs.hpp"
+#include "server/investment_index.hpp"
 #include "server/server_network.hpp"
 #include "emigration.hpp"
 #include "world.hpp"
@@ -127,12 +130,6 @@ void Trade::initialize(const World& world) noexcept {
     }
 }
 
-struct PopNeed {
-    float life_needs_met = 0.f;
-    float budget = 0.f;
-    float debt = 0.f;
-};
-
 struct NewUnit {
     UnitTypeId type_id;
     float size;
@@ -165,7 +162,8 @@ struct ProvinceEconomyInfo {
 
     // Contributions
     /// @brief Produced amount by artisans and factories to calculate final payment to both
-    std::vector<std::pair<float, float>> produced;
+    /// Allocated on the arena of the thread that creates the info
+    std::pmr::vector<std::pair<float, float>> produced{ Eng3D::TickArena::get() };
 };
 
 std::vector<Economy::Market> init_markets(const World& world) {
@@ -189,7 +187,7 @@ std::vector<Economy::Market> init_markets(const World& world) {
     return markets;
 }
 
-void update_markets(const World& world, std::vector<Economy::Market> markets) {
+void update_markets(const World& world, std::vector<Economy::Market>& markets) {
     tbb::parallel_for(tbb::blocked_range(markets.begin(), markets.end()), [&world](const auto& markets_range) {
         for(auto& market : markets_range) {
             for(const auto& province : world.provinces) {
@@ -198,10 +196,44 @@ void update_markets(const World& world, std::vector<Economy::Market> markets) {
                 market.price[province] = product.price;
                 market.supply[province] = product.supply;
             }
+            // Global demand is cleared anew every tick
+            std::fill(market.global_demand.begin(), market.global_demand.end(), 0.f);
         }
     });
 }
 
+/// @brief A trade group for each nation, its cost-evaluatable provinces are
+/// cleared against all of its provinces
+static std::vector<Economy::TradeGroup> make_trade_groups(const World& world, const Economy::Trade& trade) {
+    std::vector<Economy::TradeGroup> groups(world.nations.size());
+    for(const auto province_id : trade.cost_eval) {
+        const auto& province = world.provinces[province_id];
+        if(Nation::is_invalid(province.owner_id)) continue;
+        groups[province.owner_id].destinations.push_back(province_id);
+    }
+    tbb::parallel_for(static_cast<size_t>(0), groups.size(), [&](const auto nation_id) {
+        auto& group = groups[nation_id];
+        if(group.destinations.empty()) return;
+        group.members = world.nations[nation_id].owned_provinces;
+        group.costs.resize(group.destinations.size() * group.members.size());
+        auto* costs = group.costs.data();
+        for(const auto province_id : group.destinations)
+            for(const auto other_province_id : group.members)
+                *(costs++) = 0.01f * trade.trade_costs[province_id][other_province_id] + glm::epsilon<float>();
+    });
+    std::erase_if(groups, [](const auto& group) { return group.destinations.empty(); });
+    return groups;
+}
+
+/// @brief Trade costs don't change, so the groups only have to be made again when
+/// the provinces change owners
+static uint64_t get_groups_signature(const World& world, const Economy::Trade& trade) {
+    uint64_t signature = 0xcbf29ce484222325 ^ trade.cost_eval.size();
+    for(const auto& province : world.provinces)
+        signature = (signature ^ static_cast<size_t>(province.owner_id)) * 0x100000001b3;
+    return signature;
+}
+
 // Updates supply, demand, and set wages for workers
 static void update_industry_production(World& world, Building& building, const BuildingType& building_type, Province& province, ProvinceEconomyInfo& info) {
     if(!building_type.output_id.has_value())
@@ -240,51 +272,18 @@ static void update_industry_production(World& world, Building& building, const B
 }
 
 /// @brief Calculate the budget that we spend on each needs
-void update_pop_needs(World& world, Province& province, std::vector<PopNeed>& pop_needs, ProvinceEconomyInfo& info) {
+void update_pop_needs(World& world, Province& province, std::vector<PopNeed>& pop_needs, ProvinceEconomyInfo& info, const Economy::PopNeedsTable& pop_needs_table) {
     auto& nation = world.nations[province.controller_id];
+    std::array<float, std::tuple_size_v<decltype(province.pops)>> to_borrow;
+    Economy::consume_pop_needs(pop_needs_table, province.pops, pop_needs, province.products, nation.current_policy.pop_tax, info.state_payment, to_borrow);
     for(size_t i = 0; i < province.pops.size(); i++) {
-        auto& pop_need = pop_needs[i];
         auto& pop = province.pops[i];
-        const auto& needs_amounts = world.pop_types[pop.type_id].basic_needs_amount;
-        if(pop.size < 1.f) return;
-        
-        if(pop_need.budget > 0.f) {
-            const auto percentage_to_spend = 0.8f;
-            const auto budget_alloc = pop_need.budget * percentage_to_spend;
-
-            // If we are going to have value added taxes we should separate them from income taxes
-            info.state_payment += budget_alloc * nation.current_policy.pop_tax;
-            const auto budget_after_VAT = budget_alloc * (1.f - nation.current_policy.pop_tax);
-            const auto budget_per_pop = budget_after_VAT / pop.size;
-
-            auto total_factor = std::reduce(needs_amounts.begin(), needs_amounts.end());
-            for(const auto& commodity : world.commodities) {
-                if(needs_amounts[commodity] <= 0.f) continue;
-                auto& product = province.products[commodity];
-                const auto need_factor = needs_amounts[commodity] / total_factor;
-                const auto maximum_demand = pop.size * need_factor;
-                const auto wanted_amount = glm::clamp((budget_per_pop * need_factor) / product.price, 0.f, pop.size * need_factor);
-                
-                auto amount = 0.f;
-                pop_need.budget -= product.buy(wanted_amount, amount);
-                pop_need.life_needs_met += (amount / pop.size) * need_factor;
-            }
-        }
-        // Should be between -1 and 1
-        pop_need.life_needs_met = glm::clamp(pop_need.life_needs_met, -1.f, 1.f);
+        if(pop.size < 1.f) continue;
 
         // Take a loan if this buying spree didn't satisfy us
-        if(pop_need.life_needs_met < 0.f) {
-            // Obtain total amount to borrow
-            auto total_to_borrow = 0.f;
-            for(const auto& commodity : world.commodities) {
-                const auto& product = province.products[commodity];
-                const auto need_factor = needs_amounts[commodity];
-                total_to_borrow += pop.size * need_factor * product.price;
-            }
-
+        if(pop_needs[i].life_needs_met < 0.f) {
             auto borrowed = 0.f;
-            auto [public_debt, private_debt] = province.borrow_loan(total_to_borrow, borrowed);
+            auto [public_debt, private_debt] = province.borrow_loan(to_borrow[i], borrowed);
             pop.public_debt += public_debt;
             pop.private_debt += private_debt;
             pop.budget += borrowed;
@@ -309,13 +308,11 @@ static void update_factories_employment(const World& world, Province& province,
     auto unallocated_workers = province.pops[(int)PopGroup::LABORER].size;
     // Sort factories by their operating ratio, or profitability in regards to their expenses
     // eg: revenue / expenses = proftability ratio
-    std::vector<std::pair<size_t, float>> factories_by_profitability;
-    for(const auto& building_type : world.building_types)
-        factories_by_profitability.emplace_back(
-            building_type.get_id(),
-            province.buildings[building_type].get_operating_ratio()
-        );
-    std::sort(factories_by_profitability.begin(), factories_by_profitability.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    // The order of the last tick is kept and only fixed where the ratios changed it
+    auto& factories_by_profitability = province.factories_by_profitability;
+    factories_by_profitability.update(world.building_types.size(), [&province](BuildingTypeId building_type_id) {
+        return province.buildings[building_type_id].get_operating_ratio();
+    });
 
     float is_operating = province.controller_id == province.owner_id ? 1.f : 0.f;
     for(const auto& [industry_index, _] : factories_by_profitability) {
@@ -354,15 +351,15 @@ static void update_industry_accounting(World& world, Building& building, const B
 
     // Pay the new funds to the building as a form of the new investment
     building.budget += building.estate_collective.today_funds;
-    for(const auto& estate_foreign : building.estate_foreign)
-        building.budget += estate_foreign.today_funds;
+    for(const auto& [nation_id, investment] : building.estate_foreign)
+        building.budget += investment.today_funds;
     building.budget += building.estate_individual.today_funds;
     building.budget += building.estate_private.today_funds;
     building.budget += building.estate_state.today_funds;
     // Reset today new funds given to the building
     building.estate_collective.today_funds = 0.f;
-    for(auto& estate_foreign : building.estate_foreign)
-        estate_foreign.today_funds = 0.f;
+    for(auto& [nation_id, investment] : building.estate_foreign)
+        investment.today_funds = 0.f;
     building.estate_individual.today_funds = 0.f;
     building.estate_private.today_funds = 0.f;
     building.estate_state.today_funds = 0.f;
@@ -471,52 +468,42 @@ void Economy::do_tick(World& world, EconomyState& economy_state) {
     if(markets.empty())
         markets = init_markets(world);
     update_markets(world, markets);
+    // Made once the pop types and commodities are loaded
+    if(!economy_state.pop_needs_table.is_built_for(world.pop_types.size(), world.commodities.size()))
+        economy_state.pop_needs_table.build(world.pop_types, world.commodities.size());
     world.profiler.stop("E-init");
 
     world.profiler.start("E-trade");
     economy_state.trade.recalculate(world);
     auto& trade = economy_state.trade;
 
+    const auto groups_signature = get_groups_signature(world, trade);
+    if(economy_state.clearing.get_groups().empty() || groups_signature != economy_state.groups_signature) {
+        economy_state.clearing.set_groups(make_trade_groups(world, trade));
+        economy_state.groups_signature = groups_signature;
+    }
+    // Cleared prices stay on the markets, the products keep their own prices for now
+    economy_state.clearing.clear(markets);
+
     tbb::parallel_for(tbb::blocked_range(markets.begin(), markets.end()), [&world, &trade](const auto& markets_range) {
-        std::vector<float> values(world.provinces.size(), 0.f);
-    for(auto& market : markets_range) {
-        for(const auto province_id : trade.cost_eval) {
-            auto& province = world.provinces[province_id];
-            if(Nation::is_invalid(province.owner_id)) continue;
-            auto& nation = world.nations[province.owner_id];
-            auto sum_weightings = 0.f;
-            for(const auto other_province_id : nation.owned_provinces) {
-                auto price = market.price[other_province_id];
-                auto apparent_price = price + 0.01f * trade.trade_costs[province_id][other_province_id];
-                apparent_price += glm::epsilon<float>();
-                values[other_province_id] = market.supply[other_province_id] / (apparent_price * apparent_price);
-                sum_weightings += values[other_province_id];
+        for(const auto& market : markets_range) {
+            for(const auto province_id : trade.cost_eval) {
+                auto& province = world.provinces[province_id];
+                if(Nation::is_invalid(province.owner_id)) continue;
+                auto& product = province.products[market.commodity];
+                product.global_demand = market.global_demand[province_id];
             }
-            if(sum_weightings == 0.f) continue;
-            for(const auto other_province_id : nation.owned_provinces) {
-                values[other_province_id] /= sum_weightings;
-                auto demand = market.demand[other_province_id];
-                market.global_demand[province_id] += demand * values[other_province_id];
-            }
-        }
-        for(const auto province_id : trade.cost_eval) {
-            const auto price_change_speed = 0.9f;
-            const auto price_factor = market.global_demand[province_id] / (market.supply[province_id] + 0.01f);
-            const auto new_price = market.price[province_id] * (1.f - price_change_speed) + (market.price[province_id] * price_factor) * price_change_speed;
-
-            auto& province = world.provinces[province_id];
-            if(Nation::is_invalid(province.owner_id)) continue;
-            auto& product = province.products[market.commodity];
-            //product.price = std::max(new_price, 0.01f);
-            product.global_demand = market.global_demand[province_id];
         }
-    }
     });
     world.profiler.stop("E-trade");
 
     world.profiler.start("E-big");
-    tbb::combinable<std::vector<NewUnit>> province_new_units;
-    tbb::combinable<std::vector<float>> paid_taxes;
+    // Thread-local lists live on the arena of the thread that first uses them
+    tbb::combinable<std::pmr::vector<NewUnit>> province_new_units([] {
+        return std::pmr::vector<NewUnit>(Eng3D::TickArena::get());
+    });
+    // Taxes paid by each province, summed onto the nations afterwards
+    std::pmr::vector<float> paid_taxes(world.provinces.size(), 0.f, Eng3D::TickArena::get());
     std::vector<std::vector<float>> buildings_new_worker(world.provinces.size());
     std::vector<std::vector<PopNeed>> pops_new_needs(world.provinces.size());
 
@@ -552,7 +539,7 @@ void Economy::do_tick(World& world, EconomyState& economy_state) {
         info.admin_funds = province_policy.admin_funding * province_policy.min_wage;
 
         // Pops buying up stockpile from the province
-        update_pop_needs(world, province, new_needs, info);
+        update_pop_needs(world, province, new_needs, info, economy_state.pop_needs_table);
 
         // Factory employment for laborers, and artisans making independent products
         auto& new_workers = buildings_new_worker[province_id];
@@ -562,6 +549,8 @@ void Economy::do_tick(World& world, EconomyState& economy_state) {
             auto& building = province.buildings[building_type];
             update_industry_accounting(world, building, building_type, province, info);
         }
+        // The markets and buildings of the province are still at hand
+        investment_index.on_economy_tick(province);
 
         // Payment to the pops, including soldier pop funds
         info.military_funds = province_policy.military_funding * province_policy.min_wage;
@@ -571,8 +560,7 @@ void Economy::do_tick(World& world, EconomyState& economy_state) {
         new_needs[(int)PopGroup::BUREAUCRAT].budget += info.pops_payment[(int)PopGroup::BUREAUCRAT];
         new_needs[(int)PopGroup::SOLDIER].budget += info.pops_payment[(int)PopGroup::SOLDIER];
 
-        paid_taxes.local().resize(world.nations.size());
-        paid_taxes.local()[province.controller_id] = info.state_payment;
+        paid_taxes[province_id] = info.state_payment;
         for(auto& building : province.buildings) {
             // There must not be conflict ongoing otherwise they wont be able to build shit
             if(province.controller_id == province.owner_id && building.can_build_unit() && building.working_unit_type_id.has_value()) {
@@ -592,8 +580,8 @@ void Economy::do_tick(World& world, EconomyState& economy_state) {
         if(nation.exists())
             eval_nations.push_back(&nation);
 
-    // -------------------------- MUTEX PROTECTED WORLD CHANGES BELOW -------------------------------
-    const std::scoped_lock lock(world.world_mutex);
+    // -------------------------- WORLD CHANGES BELOW -------------------------------
+    // The world lock is already held exclusively by World::do_tick
 
     tbb::parallel_for(static_cast<size_t>(0), world.provinces.size(), [&](const auto province_id) {
         auto& province = world.provinces[province_id];
@@ -612,6 +600,7 @@ void Economy::do_tick(World& world, EconomyState& economy_state) {
             province.buildings[building_type].workers = new_workers[building_type];
     });
 
+    world.profiler.start("E-serial");
     province_new_units.combine_each([&](auto& new_unit_list) {
         for(auto& new_unit : new_unit_list) { // Now commit the transaction of the new units into the main world area
             const auto& province = world.provinces[new_unit.province_id];
@@ -628,13 +617,25 @@ void Economy::do_tick(World& world, EconomyState& economy_state) {
         }
     });
 
-    paid_taxes.combine_each([&world](auto& paid_taxes_list) {
-        for(auto& nation : world.nations)
-            nation.revenue.taxes += paid_taxes_list[nation];
-    });
+    world.profiler.stop("E-serial");
+    world.profiler.stop("E-mutex");
 
-    // Add-up all expenses and revenues!
-    for(auto& nation : world.nations)
+    world.profiler.start("E-taxes");
+    // Taxes go to the controller of the province, provinces are bucketed by it so
+    // each nation is summed and booked by a single task, nothing is shared
+    auto& taxes_reduction = economy_state.taxes_reduction;
+    taxes_reduction.partition(world.provinces.size(), world.nations.size(), [&world](size_t province_id) {
+        return static_cast<size_t>(world.provinces[province_id].controller_id);
+    });
+    taxes_reduction.reduce(paid_taxes.data(), [&world](size_t nation_id, float taxes) {
+        auto& nation = world.nations[nation_id];
+        nation.revenue.taxes += taxes;
+        // Add-up all expenses and revenues!
         nation.budget += nation.revenue.get_total() - nation.expenses.get_total();
-    world.profiler.stop("E-mutex");
+    });
+    world.profiler.stop("E-taxes");
+
+    world.profiler.start("E-history");
+    economy_state.history.record(world);
+    world.profiler.stop("E-history");
 }
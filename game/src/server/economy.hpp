@@ -24,7 +24,11 @@
 
 #pragma once
 
+#include "eng3d/grouped_reduction.hpp"
 #include "world.hpp"
+#include "server/market_clearing.hpp"
+#include "server/pop_needs.hpp"
+#include "server/economy_history.hpp"
 
 class World;
 
@@ -55,17 +59,16 @@ namespace Economy {
         std::vector<std::vector<Vertex>> neighbours;
     };
 
-    struct Market {
-        CommodityId commodity;
-        std::vector<float> price;
-        std::vector<float> supply;
-        std::vector<float> demand;
-        std::vector<float> global_demand;
-    };
-
     struct EconomyState final {
         Trade trade;
         std::vector<Market> commodity_market;
+        MarketClearing clearing;
+        /// @brief Owners of the provinces the trade groups of the clearing were made for
+        uint64_t groups_signature = 0;
+        /// @brief Provinces bucketed by controller, to sum their taxes onto the nations
+        Eng3D::GroupedReduction taxes_reduction;
+        PopNeedsTable pop_needs_table;
+        History history;
     };
     void do_tick(World& world, EconomyState& economy_state);
 }
@@ -0,0 +1,187 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/economy_history.cpp
+//
+// Abstract:
+//      Records the history of the commodities and hands it to the readers.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include "world.hpp"
+#include "server/economy_history.hpp"
+
+using namespace Economy;
+
+// Samples are written and read through atomic references, the head of the ring
+// tells the readers which of them are complete
+static inline void store_sample(float& sample, float value) {
+    std::atomic_ref<float>(sample).store(value, std::memory_order_relaxed);
+}
+
+static inline float load_sample(const float& sample) {
+    return std::atomic_ref<float>(const_cast<float&>(sample)).load(std::memory_order_relaxed);
+}
+
+void History::set_memory_budget(size_t bytes) {
+    this->memory_budget = bytes;
+    this->n_provinces = this->n_nations = this->n_commodities = 0;
+}
+
+size_t History::get_memory_usage() const {
+    auto bytes = (this->month_sums.size() + this->year_sums.size()) * sizeof(float);
+    for(const auto& ring : this->rings)
+        bytes += ring.data.size() * sizeof(float);
+    return bytes;
+}
+
+void History::resize(size_t provinces, size_t nations, size_t commodities) {
+    this->n_provinces = provinces;
+    this->n_nations = nations;
+    this->n_commodities = commodities;
+    const auto series_values = this->get_series_count() * History::n_channels;
+
+    // Two months of ticks, two years of months and twenty years, shortened evenly
+    // when they don't fit in the budget
+    constexpr std::array<size_t, History::n_resolutions> wanted_capacity{ World::ticks_per_month * 2 + 1, 24 + 1, 20 + 1 };
+    size_t wanted_values = 2; // Running sums
+    for(const auto capacity : wanted_capacity)
+        wanted_values += capacity;
+    const auto wanted_bytes = static_cast<double>(series_values) * wanted_values * sizeof(float);
+    const auto scale = wanted_bytes > 0.0 ? std::min(1.0, static_cast<double>(this->memory_budget) / wanted_bytes) : 1.0;
+    for(size_t i = 0; i < History::n_resolutions; i++) {
+        auto& ring = this->rings[i];
+        ring.capacity = std::max<size_t>(static_cast<size_t>(wanted_capacity[i] * scale), 3);
+        ring.head.store(0);
+        ring.data.assign(series_values * ring.capacity, 0.f);
+    }
+    this->month_sums.assign(series_values, 0.f);
+    this->year_sums.assign(series_values, 0.f);
+    this->month_ticks = this->year_months = 0;
+}
+
+void History::record(const World& world) {
+    if(this->n_provinces != world.provinces.size() || this->n_nations != world.nations.size() || this->n_commodities != world.commodities.size())
+        this->resize(world.provinces.size(), world.nations.size(), world.commodities.size());
+
+    auto& ring = this->rings[static_cast<size_t>(Resolution::TICK)];
+    const auto head = ring.head.load(std::memory_order_relaxed);
+    const auto slot = head % ring.capacity;
+    // Readers that see any of the samples below also see they have to read again
+    std::atomic_thread_fence(std::memory_order_release);
+    const auto write = [this, &ring, slot](size_t series, float price, float supply, float demand) {
+        const std::array<float, History::n_channels> values{ price, supply, demand };
+        for(size_t i = 0; i < History::n_channels; i++) {
+            store_sample(ring.data[(series * History::n_channels + i) * ring.capacity + slot], values[i]);
+            this->month_sums[series * History::n_channels + i] += values[i];
+        }
+    };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, this->n_provinces), [&](const auto& range) {
+        for(size_t province_id = range.begin(); province_id != range.end(); province_id++) {
+            const auto& province = world.provinces[province_id];
+            for(size_t i = 0; i < this->n_commodities; i++) {
+                const auto& product = province.products[i];
+                write(province_id * this->n_commodities + i, product.price, product.supply, product.demand);
+            }
+        }
+    });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, this->n_nations), [&](const auto& range) {
+        for(size_t nation_id = range.begin(); nation_id != range.end(); nation_id++) {
+            const auto& nation = world.nations[nation_id];
+            for(size_t i = 0; i < this->n_commodities; i++) {
+                auto price = 0.f, supply = 0.f, demand = 0.f;
+                for(const auto province_id : nation.owned_provinces) {
+                    const auto& product = world.provinces[province_id].products[i];
+                    price += product.price;
+                    supply += product.supply;
+                    demand += product.demand;
+                }
+                if(!nation.owned_provinces.empty())
+                    price /= nation.owned_provinces.size();
+                write((this->n_provinces + nation_id) * this->n_commodities + i, price, supply, demand);
+            }
+        }
+    });
+    ring.head.store(head + 1, std::memory_order_release);
+
+    // Downsample at the end of each month and year of the calendar
+    this->month_ticks++;
+    if(world.get_day() == World::ticks_per_month - 1) {
+        this->push_average(Resolution::MONTH, this->month_sums, this->month_ticks, &this->year_sums);
+        this->month_ticks = 0;
+        this->year_months++;
+        if(world.get_month() == 11) {
+            this->push_average(Resolution::YEAR, this->year_sums, this->year_months, nullptr);
+            this->year_months = 0;
+        }
+    }
+}
+
+/// @brief Push the averages of the sums onto a ring, then clear the sums
+/// @param next_sums Sums of the coarser resolution, where the averages are added
+void History::push_average(Resolution resolution, std::vector<float>& sums, uint32_t count, std::vector<float>* next_sums) {
+    auto& ring = this->rings[static_cast<size_t>(resolution)];
+    const auto head = ring.head.load(std::memory_order_relaxed);
+    const auto slot = head % ring.capacity;
+    std::atomic_thread_fence(std::memory_order_release);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, sums.size()), [&](const auto& range) {
+        for(size_t i = range.begin(); i != range.end(); i++) {
+            const auto average = sums[i] / static_cast<float>(std::max<uint32_t>(count, 1));
+            store_sample(ring.data[i * ring.capacity + slot], average);
+            if(next_sums != nullptr)
+                (*next_sums)[i] += average;
+            sums[i] = 0.f;
+        }
+    });
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<float> History::read(size_t series, Channel channel, Resolution resolution) const {
+    const auto& ring = this->rings[static_cast<size_t>(resolution)];
+    const auto offset = (series * History::n_channels + static_cast<size_t>(channel)) * ring.capacity;
+    if(ring.capacity == 0 || offset + ring.capacity > ring.data.size())
+        return {};
+
+    std::vector<float> samples;
+    // The economy pushes a sample at most once a tick, copying is far quicker than
+    // that so retrying is rare and brief
+    while(true) {
+        const auto head = ring.head.load(std::memory_order_acquire);
+        const auto count = static_cast<size_t>(std::min<uint64_t>(head, ring.capacity - 1));
+        samples.resize(count);
+        for(size_t i = 0; i < count; i++)
+            samples[i] = load_sample(ring.data[offset + (head - count + i) % ring.capacity]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(ring.head.load(std::memory_order_relaxed) == head)
+            return samples;
+    }
+}
+
+std::vector<float> History::get_province_history(ProvinceId province_id, CommodityId commodity_id, Channel channel, Resolution resolution) const {
+    const auto province_index = static_cast<size_t>(province_id), commodity_index = static_cast<size_t>(commodity_id);
+    if(province_index >= this->n_provinces || commodity_index >= this->n_commodities) return {};
+    return this->read(province_index * this->n_commodities + commodity_index, channel, resolution);
+}
+
+std::vector<float> History::get_nation_history(NationId nation_id, CommodityId commodity_id, Channel channel, Resolution resolution) const {
+    const auto nation_index = static_cast<size_t>(nation_id), commodity_index = static_cast<size_t>(commodity_id);
+    if(nation_index >= this->n_nations || commodity_index >= this->n_commodities) return {};
+    return this->read((this->n_provinces + nation_index) * this->n_commodities + commodity_index, channel, resolution);
+}
@@ -0,0 +1,147 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/economy_history.hpp
+//
+// Abstract:
+//      Fixed-memory history of the prices, supplies and demands of the
+//      commodities on every province and nation.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <vector>
+#include "world.hpp"
+
+class World;
+
+namespace Economy {
+    /// @brief Time series of every commodity on every province and nation, kept on
+    /// rings of a fixed size at three resolutions: ticks, and the averages of months
+    /// and years. The economy records onto it on its tick and any thread can read it
+    /// at the same time without taking a lock
+    class History {
+    public:
+        enum class Channel : uint8_t {
+            PRICE = 0,
+            SUPPLY = 1,
+            DEMAND = 2,
+        };
+        constexpr static size_t n_channels = 3;
+
+        enum class Resolution : uint8_t {
+            TICK = 0,
+            MONTH = 1,
+            YEAR = 2,
+        };
+        constexpr static size_t n_resolutions = 3;
+
+        /// @brief Samples of all the series at one resolution. The slot after the newest
+        /// sample is the one being written, so it's never handed to the readers
+        struct Ring {
+            size_t capacity = 0; // Slots of each series and channel
+            std::atomic<uint64_t> head = 0; // Samples pushed so far
+            std::vector<float> data; // Series, channel, then slot
+        };
+
+        History() = default;
+        ~History() = default;
+
+        /// @brief Bytes the history may take, the length of the rings is chosen from it
+        /// the next time they're made, which throws away what was recorded
+        void set_memory_budget(size_t bytes);
+        size_t get_memory_usage() const;
+
+        /// @brief Records the products of the current tick, done by the economy
+        void record(const World& world);
+
+        /// @brief Samples of a commodity on a province, oldest first. Safe to call from
+        /// any thread while the economy records
+        std::vector<float> get_province_history(ProvinceId province_id, CommodityId commodity_id, Channel channel, Resolution resolution) const;
+        /// @brief Same as above, the price is the average of the provinces of the nation
+        /// while the supply and demand are their totals
+        std::vector<float> get_nation_history(NationId nation_id, CommodityId commodity_id, Channel channel, Resolution resolution) const;
+
+        size_t n_provinces = 0;
+        size_t n_nations = 0;
+        size_t n_commodities = 0;
+        size_t memory_budget = 32 * 1024 * 1024; // Not saved, it's a setting of the session
+        std::array<Ring, n_resolutions> rings;
+        /// @brief Running sums of the current month and year, series then channel
+        std::vector<float> month_sums;
+        std::vector<float> year_sums;
+        uint32_t month_ticks = 0;
+        uint32_t year_months = 0;
+    private:
+        void resize(size_t provinces, size_t nations, size_t commodities);
+        size_t get_series_count() const {
+            return (this->n_provinces + this->n_nations) * this->n_commodities;
+        }
+        std::vector<float> read(size_t series, Channel channel, Resolution resolution) const;
+        void push_average(Resolution resolution, std::vector<float>& sums, uint32_t count, std::vector<float>* next_sums);
+    };
+}
+
+/// @brief Samples are stored bit for bit, the fixed point of the floats would
+/// overflow with the totals of the nations
+template<>
+struct Eng3D::Deser::Serializer<Economy::History> {
+    template<bool is_const>
+    using type = typename Eng3D::Deser::CondConstType<is_const, Economy::History>::type;
+
+    template<bool is_serialize>
+    static inline void deser_chunked(Eng3D::Deser::ChunkedArchive& car, type<is_serialize>& obj) {
+        auto& ar = car.header;
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.n_provinces);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.n_nations);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.n_commodities);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.month_ticks);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.year_months);
+        const auto series_values = (obj.n_provinces + obj.n_nations) * obj.n_commodities * Economy::History::n_channels;
+        for(size_t i = 0; i < Economy::History::n_resolutions; i++) {
+            auto& ring = obj.rings[i];
+            uint64_t head = ring.head.load();
+            Eng3D::Deser::deser_dynamic<is_serialize>(ar, ring.capacity);
+            Eng3D::Deser::deser_dynamic<is_serialize>(ar, head);
+            deser_samples<is_serialize>(car, "history_" + std::to_string(i), ring.data, series_values * ring.capacity);
+            if constexpr(!is_serialize)
+                ring.head.store(head);
+        }
+        deser_samples<is_serialize>(car, "history_month_sums", obj.month_sums, series_values);
+        deser_samples<is_serialize>(car, "history_year_sums", obj.year_sums, series_values);
+    }
+private:
+    template<bool is_serialize>
+    static inline void deser_samples(Eng3D::Deser::ChunkedArchive& car, const std::string& name, typename Eng3D::Deser::CondConstType<is_serialize, std::vector<float>>::type& samples, size_t size) {
+        std::vector<uint32_t> bits(samples.size());
+        if constexpr(is_serialize) {
+            std::memcpy(bits.data(), samples.data(), samples.size() * sizeof(float));
+            car.serialize_list(name, bits, 16384);
+        } else {
+            car.deserialize_list(name, bits);
+            if(bits.size() != size)
+                CXX_THROW(Eng3D::Deser::Exception, "Economy history doesn't match its size");
+            samples.resize(bits.size());
+            std::memcpy(samples.data(), bits.data(), bits.size() * sizeof(float));
+        }
+    }
+};
@@ -30,6 +30,7 @@
 #include <tbb/parallel_for.h>
 #include <tbb/combinable.h>
 
+#include "eng3d/arena.hpp"
 #include "eng3d/disc_dist.hpp"
 
 #include "server/emigration.hpp"
@@ -88,8 +89,8 @@ static inline void conlonial_migration(World& world, tbb::combinable<std::vector
 static inline void internal_migration(World& world, tbb::combinable<std::vector<EmigrationData>>& emigration) {
     tbb::parallel_for(tbb::blocked_range(world.nations.begin(), world.nations.end()), [&](const auto& nations_range) {
         for(const auto& nation : nations_range) {
-            std::vector<float> attractions;
-            std::vector<ProvinceId> viable_provinces;
+            std::pmr::vector<float> attractions(Eng3D::TickArena::get());
+            std::pmr::vector<ProvinceId> viable_provinces(Eng3D::TickArena::get());
             for(const auto province_id : nation.controlled_provinces) {
                 auto& province = world.provinces[province_id];
                 if(world.terrain_types[province.terrain_type_id].is_water_body)
@@ -135,8 +136,8 @@ static inline void external_migration(World& world, tbb::combinable<std::vector<
     std::vector<DiscreteDistribution<Province*>> province_distributions;
     province_distributions.reserve(world.provinces.size());
     for(auto& nation : world.nations) {
-        std::vector<float> attractions;
-        std::vector<Province*> viable_provinces;
+        std::pmr::vector<float> attractions(Eng3D::TickArena::get());
+        std::pmr::vector<Province*> viable_provinces(Eng3D::TickArena::get());
         for(const auto province_id : nation.controlled_provinces) {
             auto& province = world.provinces[province_id];
             if(world.terrain_types[province.terrain_type_id].is_water_body)
@@ -158,8 +159,8 @@ static inline void external_migration(World& world, tbb::combinable<std::vector<
     std::vector<DiscreteDistribution<Nation*>> nation_distributions;
     nation_distributions.reserve(world.nations.size());
     for(auto& language : world.languages) {
-        std::vector<float> attractions;
-        std::vector<Nation*> viable_nations;
+        std::pmr::vector<float> attractions(Eng3D::TickArena::get());
+        std::pmr::vector<Nation*> viable_nations(Eng3D::TickArena::get());
         for(auto& nation : world.nations) {
             auto attraction = nation_attraction(nation, language);
             if(attraction <= 0.f)
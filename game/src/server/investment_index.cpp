@@ -0,0 +1,158 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/investment_index.cpp
+//
+// Abstract:
+//      Best buildings to invest on for the AI of each nation.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "world.hpp"
+#include "server/investment_index.hpp"
+
+InvestmentIndex investment_index;
+
+void InvestmentIndex::update(const World& world) {
+    if(!this->is_valid || this->provinces.size() != world.provinces.size() || this->heaps.size() != world.nations.size()) {
+        this->output_types.clear();
+        for(const auto& commodity : world.commodities) {
+            const auto it = std::find_if(world.building_types.begin(), world.building_types.end(), [&](const auto& e) {
+                return e.output_id.has_value() && e.output_id.value() == commodity;
+            });
+            if(it != world.building_types.end())
+                this->output_types.emplace_back(commodity, it->get_id());
+        }
+        this->provinces.assign(world.provinces.size(), ProvinceEntry{});
+        this->heaps.assign(world.nations.size(), std::vector<Opportunity>{});
+        this->is_valid = true;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, world.provinces.size()), [&](const auto& range) {
+            for(size_t i = range.begin(); i != range.end(); i++)
+                this->score_province(world.provinces[i], this->provinces[i]);
+        });
+    }
+
+    // Nations whose provinces were scored again, or that gained or lost a province
+    std::vector<bool> is_dirty(world.nations.size(), false);
+    const auto mark = [&](NationId nation_id) {
+        if(Nation::is_valid(nation_id) && !is_dirty[nation_id]) {
+            is_dirty[nation_id] = true;
+            this->dirty_nations.push_back(nation_id);
+        }
+    };
+    this->refreshed = 0;
+    for(const auto& province : world.provinces) {
+        auto& entry = this->provinces[province];
+        if(entry.changed) {
+            this->refreshed++;
+            mark(province.controller_id);
+            entry.changed = false;
+        }
+        if(entry.controller_id != province.controller_id) {
+            mark(entry.controller_id);
+            mark(province.controller_id);
+            entry.controller_id = province.controller_id;
+        }
+    }
+
+    this->heap_churn.assign(this->dirty_nations.size(), 0);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, this->dirty_nations.size()), [&](const auto& range) {
+        for(size_t i = range.begin(); i != range.end(); i++)
+            this->heap_churn[i] = this->rebuild_heap(world, this->dirty_nations[i]);
+    });
+    this->churn = std::accumulate(this->heap_churn.begin(), this->heap_churn.end(), size_t(0));
+    this->dirty_nations.clear();
+}
+
+void InvestmentIndex::on_economy_tick(const Province& province) {
+    if(!this->is_valid || static_cast<size_t>(province.get_id()) >= this->provinces.size()) return;
+    if(province.products.empty() || province.buildings.empty()) return;
+    auto& entry = this->provinces[province];
+    // Only compares what every building was scored from, which is far cheaper than scoring
+    for(size_t i = 0; i < this->output_types.size(); i++) {
+        const auto& [commodity_id, building_type_id] = this->output_types[i];
+        const auto& product = province.products[commodity_id];
+        const auto& building = province.buildings[building_type_id];
+        if(this->has_changed(entry.seen[i], Seen{ product.sd_ratio(), product.demand, building.level, building.budget > 0.f })) {
+            this->score_province(province, entry);
+            return;
+        }
+    }
+}
+
+bool InvestmentIndex::has_changed(const Seen& seen, const Seen& now) const noexcept {
+    if(seen.has_budget != now.has_budget || seen.level != now.level)
+        return true;
+    const auto moved = [this](float old_value, float new_value) {
+        return std::abs(new_value - old_value) > this->refresh_threshold * std::max(std::abs(old_value), 1e-6f);
+    };
+    return moved(seen.sd_ratio, now.sd_ratio) || moved(seen.demand, now.demand);
+}
+
+void InvestmentIndex::score_province(const Province& province, ProvinceEntry& entry) const {
+    entry.changed = true;
+    entry.seen.resize(this->output_types.size());
+    entry.opportunities.clear();
+    if(province.products.empty() || province.buildings.empty()) return;
+    const auto total_demand = std::accumulate(province.products.begin(), province.products.end(), 0.f, [](const auto a, const auto& product) {
+        return a + product.demand;
+    });
+    for(size_t i = 0; i < this->output_types.size(); i++) {
+        const auto& [commodity_id, building_type_id] = this->output_types[i];
+        const auto& product = province.products[commodity_id];
+        const auto& building = province.buildings[building_type_id];
+        entry.seen[i] = Seen{ product.sd_ratio(), product.demand, building.level, building.budget > 0.f };
+        // Do not invest in buildings that are not in need of money (eg. not in the red)
+        if(building.budget > 0.f || product.demand == 0.f) continue;
+        entry.opportunities.push_back(Opportunity{ product.sd_ratio(), product.demand / total_demand, province.get_id(), building_type_id });
+    }
+}
+
+size_t InvestmentIndex::rebuild_heap(const World& world, NationId nation_id) {
+    // Keep the best top_k with a min-heap, then turn it onto a max-heap for the AI to pop from
+    const auto worse_first = [](const auto& lhs, const auto& rhs) { return rhs < lhs; };
+    std::vector<Opportunity> heap;
+    heap.reserve(this->top_k + 1);
+    for(const auto province_id : world.nations[nation_id].controlled_provinces) {
+        for(const auto& opportunity : this->provinces[province_id].opportunities) {
+            if(heap.size() == this->top_k && !(heap.front() < opportunity)) continue;
+            heap.push_back(opportunity);
+            std::push_heap(heap.begin(), heap.end(), worse_first);
+            if(heap.size() > this->top_k) {
+                std::pop_heap(heap.begin(), heap.end(), worse_first);
+                heap.pop_back();
+            }
+        }
+    }
+    std::make_heap(heap.begin(), heap.end());
+
+    // Buildings the nation wasn't going to invest on before
+    auto& old_heap = this->heaps[nation_id];
+    const auto entered = std::count_if(heap.begin(), heap.end(), [&old_heap](const auto& opportunity) {
+        return std::none_of(old_heap.begin(), old_heap.end(), [&opportunity](const auto& e) {
+            return e.province_id == opportunity.province_id && e.building_type_id == opportunity.building_type_id;
+        });
+    });
+    old_heap = std::move(heap);
+    return static_cast<size_t>(entered);
+}
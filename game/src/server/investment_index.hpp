@@ -0,0 +1,118 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/investment_index.hpp
+//
+// Abstract:
+//      Best buildings to invest on for the AI of each nation.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "world.hpp"
+
+/// @brief Scores every building of every province that makes a commodity, and keeps the
+/// best ones of each nation as a heap. A province is only scored again when the market of
+/// one of these commodities or one of these buildings changed materially since the last
+/// time, which the economy checks while it has the province at hand. A nation only rebuilds
+/// its heap when one of its provinces was scored again or changed hands.
+/// Must only be used by the world thread
+class InvestmentIndex {
+public:
+    /// @brief A building worth investing on
+    struct Opportunity {
+        float score = 0.f; // Supply/demand ratio of the commodity made by the building
+        float priority = 0.f; // Share of the demand of the province that is of this commodity
+        ProvinceId province_id;
+        BuildingTypeId building_type_id;
+
+        /// @brief Highest score first, ties go to the lowest ids so the order is always the same
+        bool operator<(const Opportunity& rhs) const noexcept {
+            if(this->score != rhs.score)
+                return this->score < rhs.score;
+            if(this->province_id != rhs.province_id)
+                return this->province_id > rhs.province_id;
+            return this->building_type_id > rhs.building_type_id;
+        }
+    };
+
+    /// @brief Rebuild the heaps of the nations whose provinces were scored again, scoring
+    /// everything first if invalidated. Called once per tick
+    void update(const World& world);
+    /// @brief Score the province again if its markets or buildings changed materially, called
+    /// by the economy once it's done with the province. Each province must only be passed by
+    /// one thread at a time
+    void on_economy_tick(const Province& province);
+    /// @brief Everything will be scored on the next update, i.e after loading a savefile
+    void invalidate() noexcept {
+        this->is_valid = false;
+    }
+
+    /// @brief Best opportunities of the nation as a max-heap, at most top_k of them
+    const std::vector<Opportunity>& get_heap(NationId nation_id) const {
+        return this->heaps[nation_id];
+    }
+
+    /// @brief Provinces that were scored again on the last update
+    size_t get_refreshed() const {
+        return this->refreshed;
+    }
+
+    /// @brief Opportunities that entered the heap of a nation on the last update
+    size_t get_churn() const {
+        return this->churn;
+    }
+
+    size_t top_k = 16; // Opportunities kept per nation
+    float refresh_threshold = 0.05f; // Relative change of a market that makes it be scored again
+private:
+    /// @brief What the score of a building was worked out from
+    struct Seen {
+        float sd_ratio = 0.f;
+        float demand = 0.f;
+        float level = 0.f;
+        bool has_budget = false;
+    };
+
+    struct ProvinceEntry {
+        std::vector<Seen> seen; // One for each entry of output_types
+        std::vector<Opportunity> opportunities;
+        NationId controller_id;
+        bool changed = false; // Scored again since the last update
+    };
+
+    bool has_changed(const Seen& seen, const Seen& now) const noexcept;
+    void score_province(const Province& province, ProvinceEntry& entry) const;
+    /// @return Opportunities that weren't on the heap before
+    size_t rebuild_heap(const World& world, NationId nation_id);
+
+    bool is_valid = false;
+    /// @brief The first building type making each commodity that has one, which is where
+    /// the AI invests to make more of it
+    std::vector<std::pair<CommodityId, BuildingTypeId>> output_types;
+    std::vector<ProvinceEntry> provinces;
+    std::vector<std::vector<Opportunity>> heaps;
+    std::vector<NationId> dirty_nations;
+    std::vector<size_t> heap_churn; // Of each dirty nation, added up once all are rebuilt
+    size_t refreshed = 0;
+    size_t churn = 0;
+};
+
+extern InvestmentIndex investment_index;
@@ -36,6 +36,7 @@
 #include "server/lua_api.hpp"
 #include "world.hpp"
 #include "server/economy.hpp"
+#include "server/diplomacy_index.hpp"
 
 int LuaAPI::register_new_table(lua_State* L, const std::string_view name, const std::vector<luaL_Reg> meta, const std::vector<luaL_Reg> methods) {
     if(luaL_newmetatable(L, name.data())) {
@@ -65,8 +66,10 @@ int LuaAPI::register_new_table(lua_State* L, const std::string_view name, const
 template<typename T>
 static const T& find_or_throw(const std::string_view ref_name) {
     const auto& list = World::get_instance().get_list((T*)nullptr);
-    const auto result = std::find_if(list.begin(), list.end(), [ref_name](const auto& o) {
-        return !strcmp(o.ref_name.data(), ref_name.data());
+    // Interned strings, a name which was never inserted can't belong to any object
+    const auto ref = Eng3D::StringManager::get_instance().find(ref_name);
+    const auto result = !ref.has_value() ? list.end() : std::find_if(list.begin(), list.end(), [&ref](const auto& o) {
+        return o.ref_name == ref.value();
     });
 
     if(result == list.end())
@@ -405,6 +408,7 @@ int LuaAPI::set_nation_relation(lua_State* L) {
     relation.alliance = lua_tonumber(L, 3);
     relation.relation = lua_tonumber(L, 4);
     relation.has_war = lua_toboolean(L, 5);
+    diplomacy_index.on_relation_change(nation, other_nation);
     return 0;
 }
 
@@ -464,8 +468,6 @@ int LuaAPI::add_province(lua_State* L) {
     province.languages.resize(g_world.languages.size(), 0.f);
     province.religions.resize(g_world.religions.size(), 0.f);
     province.buildings.resize(g_world.building_types.size());
-    for(auto& building : province.buildings)
-        building.estate_foreign.resize(g_world.nations.size());
     
     {
         size_t i = 0;
@@ -974,7 +976,7 @@ void LuaAPI::fire_event(lua_State* L, Nation& nation, Event& event, bool& is_mul
     auto orig_event = event;
 
     // Call the "do event" function
-    Eng3D::Log::debug("event", Eng3D::translate_format("Event %s using lua#%i", event.ref_name.data(), event.do_event_function));
+    Eng3D::Log::debug("event", "Event %s using lua#%i", event.ref_name.data(), event.do_event_function);
     int nargs = 1;
     lua_rawgeti(L, LUA_REGISTRYINDEX, event.do_event_function);
     lua_pushstring(L, nation.ref_name.data());
@@ -983,7 +985,7 @@ void LuaAPI::fire_event(lua_State* L, Nation& nation, Event& event, bool& is_mul
         nargs++;
     }
     if(g_world.lua.call_func(nargs, 1)) {
-        Eng3D::Log::error("lua", translate_format("lua_pcall failed: %s", lua_tostring(L, -1)));
+        Eng3D::Log::error("lua", "lua_pcall failed: %s", lua_tostring(L, -1));
         lua_pop(L, 1);
         goto restore_original;
     }
@@ -1001,12 +1003,12 @@ void LuaAPI::fire_event(lua_State* L, Nation& nation, Event& event, bool& is_mul
         for(auto& descision : local_event.decisions) {
             descision.extra_data = local_event.extra_data;
             if(descision.do_decision_function == 0) {
-                Eng3D::Log::error("event", translate_format("(Lua event %s on descision %s has no function callback", orig_event.ref_name.data(), descision.ref_name.data()));
+                Eng3D::Log::error("event", "(Lua event %s on descision %s has no function callback", orig_event.ref_name.data(), descision.ref_name.data());
                 goto restore_original;
             }
         }
         nation.inbox.push_back(local_event);
-        Eng3D::Log::debug("event", translate_format("Event triggered! %s (with %zu decisions)", local_event.ref_name.data(), local_event.decisions.size()));
+        Eng3D::Log::debug("event", "Event triggered! %s (with %zu decisions)", local_event.ref_name.data(), local_event.decisions.size());
     }
 restore_original: // Original event then gets restored
     event = orig_event;
@@ -1041,7 +1043,7 @@ void LuaAPI::check_events(lua_State* L) {
     // taken decisions :)
     for(auto& [dec, nation_id] : g_world.taken_decisions) {
         const auto& nation = g_world.nations[nation_id];
-        Eng3D::Log::debug("event", string_format("%s took the descision %i", nation.ref_name.data(), dec.do_decision_function));
+        Eng3D::Log::debug("event", "%s took the descision %i", nation.ref_name.data(), dec.do_decision_function);
         lua_rawgeti(L, LUA_REGISTRYINDEX, dec.do_decision_function);
         int nargs = 1;
         lua_pushstring(L, nation.ref_name.data());
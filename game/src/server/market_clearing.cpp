@@ -0,0 +1,113 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/market_clearing.cpp
+//
+// Abstract:
+//      Market clearing kernels, parallel across markets and trade groups.
+// ----------------------------------------------------------------------------
+
+#include <tbb/blocked_range2d.h>
+#include <tbb/parallel_for.h>
+#include <tbb/combinable.h>
+#include "world.hpp"
+#include "server/market_clearing.hpp"
+
+using namespace Economy;
+
+float GravityClearing::clear(const ClearingView& view, const float* costs) const {
+    // Independent partial sums, so the loop vectorizes without reassociating floats
+    constexpr size_t lanes = 8;
+    float weights[lanes] = {};
+    float demands[lanes] = {};
+    size_t i = 0;
+    for(; i + lanes <= view.size; i += lanes) {
+        for(size_t j = 0; j < lanes; j++) {
+            const auto apparent_price = view.price[i + j] + costs[i + j];
+            const auto weight = view.supply[i + j] / (apparent_price * apparent_price);
+            weights[j] += weight;
+            demands[j] += view.demand[i + j] * weight;
+        }
+    }
+    for(; i < view.size; i++) {
+        const auto apparent_price = view.price[i] + costs[i];
+        const auto weight = view.supply[i] / (apparent_price * apparent_price);
+        weights[0] += weight;
+        demands[0] += view.demand[i] * weight;
+    }
+
+    auto sum_weightings = 0.f, sum_demand = 0.f;
+    for(size_t j = 0; j < lanes; j++) {
+        sum_weightings += weights[j];
+        sum_demand += demands[j];
+    }
+    if(sum_weightings == 0.f) return 0.f;
+    return sum_demand / sum_weightings;
+}
+
+MarketClearing::MarketClearing()
+    : algorithm{ std::make_unique<GravityClearing>() }
+{
+
+}
+
+void MarketClearing::clear(std::vector<Market>& markets) const {
+    // Scratch for the gathered members, reused by every block a thread takes
+    tbb::combinable<std::vector<float>> gathered;
+    tbb::parallel_for(tbb::blocked_range2d<size_t>(0, markets.size(), 0, this->groups.size()), [&](const auto& range) {
+        auto& scratch = gathered.local();
+        for(size_t i = range.rows().begin(); i != range.rows().end(); i++) {
+            auto& market = markets[i];
+            for(size_t j = range.cols().begin(); j != range.cols().end(); j++) {
+                const auto& group = this->groups[j];
+                const auto n_members = group.members.size();
+                scratch.resize(n_members * 3);
+                auto* price = scratch.data();
+                auto* supply = price + n_members;
+                auto* demand = supply + n_members;
+                for(size_t k = 0; k < n_members; k++) {
+                    const auto province_id = group.members[k];
+                    price[k] = market.price[province_id];
+                    supply[k] = market.supply[province_id];
+                    demand[k] = market.demand[province_id];
+                }
+
+                const ClearingView view{ n_members, price, supply, demand };
+                // Destinations belong to a single group, so the writes never overlap
+                for(size_t k = 0; k < group.destinations.size(); k++)
+                    market.global_demand[group.destinations[k]] = this->algorithm->clear(view, group.costs.data() + k * n_members);
+            }
+        }
+    });
+
+    tbb::parallel_for(tbb::blocked_range(markets.begin(), markets.end()), [this](const auto& markets_range) {
+        for(auto& market : markets_range)
+            MarketClearing::update_prices(market, this->price_change_speed);
+    });
+}
+
+void MarketClearing::update_prices(Market& market, float speed) noexcept {
+    const auto size = market.price.size();
+    auto* price = market.price.data();
+    const auto* supply = market.supply.data();
+    const auto* global_demand = market.global_demand.data();
+    for(size_t i = 0; i < size; i++) {
+        const auto price_factor = global_demand[i] / (supply[i] + 0.01f);
+        price[i] = price[i] * (1.f - speed) + (price[i] * price_factor) * speed;
+    }
+}
@@ -0,0 +1,107 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/market_clearing.hpp
+//
+// Abstract:
+//      Clears the commodity markets, spreading the demand of the provinces of
+//      a trade group onto each other and updating the prices from it.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "world.hpp"
+
+namespace Economy {
+    /// @brief Prices, supplies and demands of a commodity on every province,
+    /// stored as a structure of arrays so the clearing kernels run over contiguous data
+    struct Market {
+        CommodityId commodity;
+        std::vector<float> price;
+        std::vector<float> supply;
+        std::vector<float> demand;
+        std::vector<float> global_demand;
+    };
+
+    /// @brief Provinces that trade with each other, currently the provinces of a nation
+    struct TradeGroup {
+        /// @brief Provinces whose supply and demand are spread onto the destinations
+        std::vector<ProvinceId> members;
+        /// @brief Provinces whose global demand is cleared, none of them is on another group
+        std::vector<ProvinceId> destinations;
+        /// @brief Cost added to the price of each member when seen from each
+        /// destination, destinations * members, row major
+        std::vector<float> costs;
+    };
+
+    /// @brief Members of a trade group gathered onto contiguous arrays
+    struct ClearingView {
+        size_t size = 0;
+        const float* price = nullptr;
+        const float* supply = nullptr;
+        const float* demand = nullptr;
+    };
+
+    /// @brief Decides how much of the demand of a trade group reaches a destination
+    class ClearingAlgorithm {
+    public:
+        virtual ~ClearingAlgorithm() = default;
+        /// @brief Global demand of a destination
+        /// @param costs Cost of trading with each of the members from the destination
+        virtual float clear(const ClearingView& view, const float* costs) const = 0;
+    };
+
+    /// @brief Members are weighted by supply / apparent_price^2, where the apparent
+    /// price is the price plus the trade cost, and their demand is split by the weights
+    class GravityClearing : public ClearingAlgorithm {
+    public:
+        float clear(const ClearingView& view, const float* costs) const override;
+    };
+
+    class MarketClearing {
+    public:
+        MarketClearing();
+        ~MarketClearing() = default;
+
+        /// @brief Computes the global demand of the destinations of every group and
+        /// updates the prices from it, in place. Markets and groups are cleared in parallel
+        void clear(std::vector<Market>& markets) const;
+        /// @brief price = price * (1 - speed) + price * global_demand / supply * speed
+        static void update_prices(Market& market, float speed) noexcept;
+
+        void set_algorithm(std::unique_ptr<ClearingAlgorithm> new_algorithm) {
+            this->algorithm = std::move(new_algorithm);
+        }
+
+        void set_groups(std::vector<TradeGroup> new_groups) {
+            this->groups = std::move(new_groups);
+        }
+
+        const std::vector<TradeGroup>& get_groups() const {
+            return this->groups;
+        }
+
+        float price_change_speed = 0.9f;
+    private:
+        std::unique_ptr<ClearingAlgorithm> algorithm;
+        std::vector<TradeGroup> groups;
+    };
+}
@@ -0,0 +1,93 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/pop_needs.cpp
+//
+// Abstract:
+//      Consumption kernel of the pops.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <numeric>
+#include <glm/common.hpp>
+#include "world.hpp"
+#include "server/pop_needs.hpp"
+
+using namespace Economy;
+
+void PopNeedsTable::build(const std::vector<PopType>& pop_types, size_t commodities_size) {
+    this->n_pop_types = pop_types.size();
+    this->n_commodities = commodities_size;
+    this->amounts.assign(this->n_pop_types * this->n_commodities, 0.f);
+    this->factors.assign(this->n_pop_types * this->n_commodities, 0.f);
+    this->needed.clear();
+    this->needed_offsets.assign(1, 0);
+    for(const auto& pop_type : pop_types) {
+        auto* row_amounts = this->amounts.data() + pop_type.get_id() * this->n_commodities;
+        auto* row_factors = this->factors.data() + pop_type.get_id() * this->n_commodities;
+        const auto n_needs = std::min(pop_type.basic_needs_amount.size(), this->n_commodities);
+        std::copy_n(pop_type.basic_needs_amount.begin(), n_needs, row_amounts);
+        const auto total_factor = std::reduce(row_amounts, row_amounts + this->n_commodities);
+        for(size_t i = 0; i < this->n_commodities; i++) {
+            if(row_amounts[i] <= 0.f) continue;
+            row_factors[i] = row_amounts[i] / total_factor;
+            this->needed.push_back(CommodityId(i));
+        }
+        this->needed_offsets.push_back(this->needed.size());
+    }
+}
+
+void Economy::consume_pop_needs(const PopNeedsTable& table, std::span<const Pop> pops, std::span<PopNeed> pop_needs, std::span<Product> products, float pop_tax, float& state_payment, std::span<float> to_borrow) {
+    for(size_t i = 0; i < pops.size(); i++) {
+        auto& pop_need = pop_needs[i];
+        const auto& pop = pops[i];
+        to_borrow[i] = 0.f;
+        if(pop.size < 1.f) continue;
+
+        const auto factors = table.get_factors(pop.type_id);
+        if(pop_need.budget > 0.f) {
+            const auto percentage_to_spend = 0.8f;
+            const auto budget_alloc = pop_need.budget * percentage_to_spend;
+
+            // If we are going to have value added taxes we should separate them from income taxes
+            state_payment += budget_alloc * pop_tax;
+            const auto budget_after_VAT = budget_alloc * (1.f - pop_tax);
+            const auto budget_per_pop = budget_after_VAT / pop.size;
+            for(const auto commodity_id : table.get_needed(pop.type_id)) {
+                auto& product = products[commodity_id];
+                const auto need_factor = factors[commodity_id];
+                const auto wanted_amount = glm::clamp((budget_per_pop * need_factor) / product.price, 0.f, pop.size * need_factor);
+
+                auto amount = 0.f;
+                pop_need.budget -= product.buy(wanted_amount, amount);
+                pop_need.life_needs_met += (amount / pop.size) * need_factor;
+            }
+        }
+        // Should be between -1 and 1
+        pop_need.life_needs_met = glm::clamp(pop_need.life_needs_met, -1.f, 1.f);
+
+        // What a loan would need to cover if this buying spree didn't satisfy us
+        if(pop_need.life_needs_met < 0.f) {
+            const auto amounts = table.get_amounts(pop.type_id);
+            auto total_to_borrow = 0.f;
+            for(size_t j = 0; j < amounts.size(); j++)
+                total_to_borrow += pop.size * amounts[j] * products[j].price;
+            to_borrow[i] = total_to_borrow;
+        }
+    }
+}
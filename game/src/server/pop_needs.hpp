@@ -0,0 +1,79 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/pop_needs.hpp
+//
+// Abstract:
+//      Consumption of the pops, over the needs of their types precomputed
+//      onto dense tables.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "world.hpp"
+
+struct PopNeed {
+    float life_needs_met = 0.f;
+    float budget = 0.f;
+    float debt = 0.f;
+};
+
+namespace Economy {
+    /// @brief Basic needs of every pop type as dense commodity-indexed rows, so
+    /// they aren't normalized again for every pop on every tick
+    class PopNeedsTable {
+    public:
+        void build(const std::vector<PopType>& pop_types, size_t commodities_size);
+
+        bool is_built_for(size_t pop_type_count, size_t commodity_count) const {
+            return this->n_pop_types == pop_type_count && this->n_commodities == commodity_count;
+        }
+
+        /// @brief Amount of each commodity needed by a person
+        std::span<const float> get_amounts(PopTypeId pop_type_id) const {
+            return std::span<const float>(this->amounts.data() + pop_type_id * this->n_commodities, this->n_commodities);
+        }
+
+        /// @brief Share of the budget spent on each commodity, the needed amount over
+        /// the total of the needed amounts
+        std::span<const float> get_factors(PopTypeId pop_type_id) const {
+            return std::span<const float>(this->factors.data() + pop_type_id * this->n_commodities, this->n_commodities);
+        }
+
+        /// @brief Commodities with a positive need, ascending
+        std::span<const CommodityId> get_needed(PopTypeId pop_type_id) const {
+            return std::span<const CommodityId>(this->needed.data() + this->needed_offsets[pop_type_id], this->needed_offsets[pop_type_id + 1] - this->needed_offsets[pop_type_id]);
+        }
+    private:
+        size_t n_pop_types = 0;
+        size_t n_commodities = 0;
+        std::vector<float> amounts;
+        std::vector<float> factors;
+        std::vector<CommodityId> needed;
+        std::vector<size_t> needed_offsets;
+    };
+
+    /// @brief Pops of a province spend their budget on their needs in one pass, the
+    /// taxes they pay are added to state_payment. Pops with less than a person are skipped
+    /// @param to_borrow What each pop would have to borrow to cover all of its needs,
+    /// zero when its needs were met or it was skipped
+    void consume_pop_needs(const PopNeedsTable& table, std::span<const Pop> pops, std::span<PopNeed> pop_needs, std::span<Product> products, float pop_tax, float& state_payment, std::span<float> to_borrow);
+}
@@ -0,0 +1,234 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/replay.cpp
+//
+// Abstract:
+//      Recording and headless playback of the inputs of a session.
+// ----------------------------------------------------------------------------
+
+#include <cstring>
+#include <chrono>
+#include <shared_mutex>
+#include "eng3d/log.hpp"
+#include "eng3d/string.hpp"
+#include "eng3d/chunked_archive.hpp"
+#include "server/replay.hpp"
+#include "server/server_network.hpp"
+#include "server/ai_scheduler.hpp"
+#include "world.hpp"
+
+namespace AI {
+    void init(World& world);
+    void set_seed(uint32_t seed);
+}
+
+constexpr char replay_magic[4] = { 'S', 'O', 'E', 'R' };
+constexpr uint32_t replay_version = 1;
+
+enum class ReplayEntry : uint8_t {
+    COMMAND,
+    TICK_END,
+};
+
+template<typename T>
+static void write_value(FILE* fp, const T& value) {
+    std::fwrite(&value, sizeof(T), 1, fp);
+}
+
+template<typename T>
+static T read_value(FILE* fp) {
+    T value;
+    if(std::fread(&value, sizeof(T), 1, fp) != 1)
+        CXX_THROW(std::runtime_error, "Replay is truncated");
+    return value;
+}
+
+uint64_t hash_world(const World& world) {
+    Eng3D::Deser::ChunkedArchive ar{};
+    world.save(ar);
+    return ar.get_hash();
+}
+
+/// @brief Loads a snapshot and reseeds the AI, both the recorder and the player start
+/// from here. Strings are only replaced if asked, a running game already has them
+static void load_snapshot(World& world, const std::string_view path, uint32_t seed, bool load_strings) {
+    Eng3D::Deser::ChunkedArchive ar{};
+    ar.from_file(path);
+    if(load_strings) {
+        Eng3D::Deser::deserialize(ar.header, Eng3D::StringManager::get_instance());
+    } else {
+        Eng3D::StringManager strings{};
+        Eng3D::Deser::deserialize(ar.header, strings);
+    }
+    world.load(ar);
+    // Markets aren't saved, both sides rebuild them from the loaded world on the next tick
+    world.economy_state.commodity_market.clear();
+    AI::set_seed(seed);
+    AI::init(world);
+    // The scheduler would pick nations by how long they took, which differs between runs
+    ai_scheduler.set_budgeted(false);
+}
+
+void ReplayRecorder::start(World& world, const std::string_view path, uint32_t seed, size_t _checkpoint_interval) {
+    const std::scoped_lock world_lock(world.world_mutex);
+    const std::scoped_lock lock(this->mutex);
+    const auto snapshot_path = std::string(path) + ".sc4";
+    {
+        Eng3D::Deser::ChunkedArchive ar{};
+        Eng3D::Deser::serialize(ar.header, Eng3D::StringManager::get_instance());
+        world.save(ar);
+        ar.to_file(snapshot_path);
+    }
+    // Floats are stored as fixed point, so carry on from what was actually written
+    load_snapshot(world, snapshot_path, seed, false);
+    if(g_server != nullptr)
+        g_server->visibility.invalidate();
+
+    this->fp.reset(std::fopen(path.data(), "wb"));
+    if(this->fp == nullptr)
+        CXX_THROW(std::runtime_error, Eng3D::translate_format("Can't open replay %s", path.data()));
+    this->checkpoint_interval = _checkpoint_interval;
+    this->n_commands = 0;
+    const auto initial_hash = hash_world(world);
+    std::fwrite(replay_magic, 1, sizeof(replay_magic), this->fp.get());
+    write_value(this->fp.get(), replay_version);
+    write_value(this->fp.get(), seed);
+    write_value(this->fp.get(), static_cast<uint32_t>(this->checkpoint_interval));
+    write_value(this->fp.get(), static_cast<int32_t>(world.time));
+    write_value(this->fp.get(), initial_hash);
+    std::fflush(this->fp.get());
+    Eng3D::Log::debug("replay", "Recording onto %s from tick %i, seed %u, world hash %016llx", path.data(), world.time, seed, static_cast<unsigned long long>(initial_hash));
+}
+
+void ReplayRecorder::stop() {
+    const std::scoped_lock lock(this->mutex);
+    if(this->fp == nullptr) return;
+    Eng3D::Log::debug("replay", "Recording stopped after %zu commands", this->n_commands);
+    this->fp.reset();
+}
+
+void ReplayRecorder::record_command(NationId nation_id, const std::vector<uint8_t>& packet) {
+    const std::scoped_lock lock(this->mutex);
+    if(this->fp == nullptr) return;
+    write_value(this->fp.get(), ReplayEntry::COMMAND);
+    write_value(this->fp.get(), static_cast<uint32_t>(static_cast<size_t>(nation_id)));
+    write_value(this->fp.get(), static_cast<uint32_t>(packet.size()));
+    std::fwrite(packet.data(), 1, packet.size(), this->fp.get());
+    this->n_commands++;
+}
+
+void ReplayRecorder::end_tick(const World& world) {
+    const std::scoped_lock lock(this->mutex);
+    if(this->fp == nullptr) return;
+    const bool is_checkpoint = this->checkpoint_interval && static_cast<size_t>(world.time) % this->checkpoint_interval == 0;
+    write_value(this->fp.get(), ReplayEntry::TICK_END);
+    write_value(this->fp.get(), static_cast<int32_t>(world.time));
+    write_value(this->fp.get(), is_checkpoint ? hash_world(world) : uint64_t(0));
+    // Everything up to the last tick survives a crash
+    std::fflush(this->fp.get());
+}
+
+bool ReplayRecorder::is_recording() const {
+    const std::scoped_lock lock(this->mutex);
+    return this->fp != nullptr;
+}
+
+void ReplayPlayer::open(const std::string_view path) {
+    std::unique_ptr<FILE, int(*)(FILE*)> fp(std::fopen(path.data(), "rb"), std::fclose);
+    if(fp == nullptr)
+        CXX_THROW(std::runtime_error, Eng3D::translate_format("Can't open replay %s", path.data()));
+    char magic[sizeof(replay_magic)];
+    if(std::fread(magic, 1, sizeof(magic), fp.get()) != sizeof(magic) || std::memcmp(magic, replay_magic, sizeof(magic)) != 0)
+        CXX_THROW(std::runtime_error, "Not a replay");
+    if(read_value<uint32_t>(fp.get()) != replay_version)
+        CXX_THROW(std::runtime_error, "Unsupported replay version");
+    this->snapshot_path = std::string(path) + ".sc4";
+    this->seed = read_value<uint32_t>(fp.get());
+    read_value<uint32_t>(fp.get()); // Checkpoint interval, the hashes tell by themselves
+    this->start_time = read_value<int32_t>(fp.get());
+    this->initial_hash = read_value<uint64_t>(fp.get());
+
+    this->ticks.clear();
+    this->next_tick = 0;
+    this->first_divergent_tick.reset();
+    Tick tick{};
+    uint8_t type;
+    while(std::fread(&type, sizeof(type), 1, fp.get()) == 1) {
+        if(type == static_cast<uint8_t>(ReplayEntry::COMMAND)) {
+            Command command{};
+            command.nation_id = NationId(static_cast<size_t>(read_value<uint32_t>(fp.get())));
+            command.packet.resize(read_value<uint32_t>(fp.get()));
+            if(std::fread(command.packet.data(), 1, command.packet.size(), fp.get()) != command.packet.size())
+                CXX_THROW(std::runtime_error, "Replay is truncated");
+            tick.commands.push_back(std::move(command));
+        } else if(type == static_cast<uint8_t>(ReplayEntry::TICK_END)) {
+            tick.time = read_value<int32_t>(fp.get());
+            tick.hash = read_value<uint64_t>(fp.get());
+            this->ticks.push_back(std::move(tick));
+            tick = Tick{};
+        } else {
+            CXX_THROW(std::runtime_error, "Unknown replay entry");
+        }
+    }
+    // Commands after the last tick were never applied by a tick, the game stopped
+    if(!tick.commands.empty())
+        Eng3D::Log::warning("replay", "Ignoring %zu commands after the last tick", tick.commands.size());
+    Eng3D::Log::debug("replay", "Opened replay %s with %zu ticks", path.data(), this->ticks.size());
+}
+
+void ReplayPlayer::load_world(World& world) {
+    load_snapshot(world, this->snapshot_path, this->seed, true);
+    if(world.time != this->start_time || hash_world(world) != this->initial_hash)
+        CXX_THROW(std::runtime_error, "The snapshot of the replay doesn't match the recording");
+}
+
+/// @brief Handlers act on g_world, so world must be it
+std::optional<ReplayPlayer::TickResult> ReplayPlayer::step(World& world) {
+    if(this->next_tick >= this->ticks.size())
+        return std::nullopt;
+    const auto& tick = this->ticks[this->next_tick++];
+    TickResult result{};
+    result.commands = tick.commands.size();
+    for(const auto& command : tick.commands) {
+        Server::ClientData client_data{};
+        if(Nation::is_valid(command.nation_id))
+            client_data.selected_nation = &world.nations.at(command.nation_id);
+        Eng3D::Networking::Packet packet{};
+        packet.data(command.packet.data(), command.packet.size());
+        try {
+            Server::execute_command(client_data, packet);
+        } catch(const std::exception& e) {
+            // Was accepted when recording, so the world has diverged already
+            Eng3D::Log::warning("replay", "Command rejected on tick %i: %s", tick.time, e.what());
+            result.rejected_commands++;
+        }
+    }
+    const auto tick_start = std::chrono::steady_clock::now();
+    world.do_tick();
+    result.tick_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tick_start).count();
+
+    result.time = world.time;
+    result.checked = tick.hash != 0;
+    result.matches = result.rejected_commands == 0 && world.time == tick.time && (!result.checked || hash_world(world) == tick.hash);
+    if(!result.matches && !this->first_divergent_tick.has_value()) {
+        this->first_divergent_tick = tick.time;
+        Eng3D::Log::error("replay", "Playback diverged from the recording on tick %i", tick.time);
+    }
+    return result;
+}
@@ -0,0 +1,111 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/replay.hpp
+//
+// Abstract:
+//      Records the commands applied on every tick so a session can be played
+//      back deterministically, and checks the playback against the recording.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include "world.hpp"
+
+/// @brief Hash of everything that is saved of the world
+uint64_t hash_world(const World& world);
+
+/// @brief Lockstep recording of a session. The world is snapshotted when the
+/// recording starts (onto path + ".sc4"), after that only the inputs are stored:
+/// the commands applied before each tick and, every checkpoint_interval ticks,
+/// the hash of the world so a playback can tell where it diverged.
+/// The file is a header followed by a stream of entries:
+///     header: magic, version, seed of the AI, checkpoint interval, time, hash
+///     command: nation id, size, packet
+///     tick end: time, hash (0 if there isn't a checkpoint)
+class ReplayRecorder {
+    mutable std::mutex mutex;
+    std::unique_ptr<FILE, int(*)(FILE*)> fp{ nullptr, std::fclose };
+    size_t checkpoint_interval = 0;
+    size_t n_commands = 0;
+public:
+    /// @brief Snapshots the world and starts recording, the world is reloaded from
+    /// the snapshot and the AI reseeded so a playback starts from the very same state
+    void start(World& world, const std::string_view path, uint32_t seed, size_t checkpoint_interval);
+    void stop();
+    /// @brief A command that was successfully applied, before the end of the current tick
+    void record_command(NationId nation_id, const std::vector<uint8_t>& packet);
+    /// @brief Called by the world after each tick
+    void end_tick(const World& world);
+    bool is_recording() const;
+};
+
+/// @brief Plays back a recording made by ReplayRecorder on a world, headless
+class ReplayPlayer {
+public:
+    struct Command {
+        NationId nation_id;
+        std::vector<uint8_t> packet;
+    };
+
+    struct Tick {
+        int time = 0;
+        uint64_t hash = 0; // 0 if there isn't a checkpoint on this tick
+        std::vector<Command> commands; // Applied before the tick
+    };
+
+    /// @brief Result of playing back a single tick
+    struct TickResult {
+        int time = 0;
+        size_t commands = 0;
+        size_t rejected_commands = 0;
+        float tick_ms = 0.f; // Without the commands nor the checkpoint
+        bool checked = false; // Whether there was a checkpoint
+        bool matches = true;
+    };
+
+    void open(const std::string_view path);
+    /// @brief Loads the snapshot of the recording onto the world, throws if it doesn't
+    /// hash the same as when it was recorded
+    void load_world(World& world);
+    /// @brief Applies the commands of the next tick and ticks the world
+    /// @return The result of the tick, nothing if the recording is over
+    std::optional<TickResult> step(World& world);
+
+    uint32_t get_seed() const { return this->seed; }
+    size_t get_ticks() const { return this->ticks.size(); }
+    /// @brief First tick whose checkpoint didn't match, if any
+    std::optional<int> get_first_divergent_tick() const { return this->first_divergent_tick; }
+private:
+    std::string snapshot_path;
+    uint32_t seed = 0;
+    int start_time = 0;
+    uint64_t initial_hash = 0;
+    std::vector<Tick> ticks;
+    size_t next_tick = 0;
+    std::optional<int> first_divergent_tick;
+};
@@ -0,0 +1,189 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/save_writer.cpp
+//
+// Abstract:
+//      Background writing of savefiles and rotation of the autosaves.
+// ----------------------------------------------------------------------------
+
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <shared_mutex>
+#include "eng3d/log.hpp"
+#include "server/save_writer.hpp"
+#include "world.hpp"
+
+SaveWriter::SaveWriter()
+    : writer{ &SaveWriter::write_loop, this }
+{
+
+}
+
+SaveWriter::~SaveWriter() {
+    {
+        const std::scoped_lock lock(this->queue_mutex);
+        this->is_running = false;
+    }
+    this->queue_cv.notify_all();
+    this->writer.join(); // Pending saves are still written
+}
+
+std::unique_ptr<SaveWriter::Job> SaveWriter::take_snapshot(const World& world, NationId nation_id, const std::string_view path) {
+    auto job = std::make_unique<Job>();
+    job->path = path;
+    const auto start = std::chrono::steady_clock::now();
+    Eng3D::Deser::serialize(job->ar.header, nation_id);
+    world.save(job->ar);
+    job->snapshot_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return job;
+}
+
+void SaveWriter::save(const World& world, NationId nation_id, const std::string_view path) {
+    std::unique_ptr<Job> job;
+    {
+        const std::shared_lock lock(world.world_mutex);
+        job = this->take_snapshot(world, nation_id, path);
+    }
+    this->push(std::move(job));
+}
+
+void SaveWriter::save_locked(const World& world, NationId nation_id, const std::string_view path) {
+    this->push(this->take_snapshot(world, nation_id, path));
+}
+
+void SaveWriter::set_autosave(size_t interval_ticks, size_t max_files, const std::string_view directory) {
+    this->autosave_interval = interval_ticks;
+    this->autosave_max_files = std::max<size_t>(max_files, 1);
+    this->autosave_directory = directory;
+}
+
+void SaveWriter::on_tick(const World& world, NationId nation_id) {
+    if(this->autosave_interval == 0 || static_cast<size_t>(world.time) % this->autosave_interval != 0)
+        return;
+    {
+        // Don't pile up snapshots if the disk can't keep up
+        const std::scoped_lock lock(this->queue_mutex);
+        if(this->is_writing || !this->queue.empty()) {
+            this->metrics.autosaves_skipped++;
+            Eng3D::Log::warning("save", "Skipping autosave of tick %i, the previous save is still being written", world.time);
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(this->autosave_directory, ec);
+    const auto path = (std::filesystem::path(this->autosave_directory) / string_format("autosave_%i.sc4", world.time)).string();
+    std::unique_ptr<Job> job;
+    {
+        const std::shared_lock lock(world.world_mutex);
+        job = this->take_snapshot(world, nation_id, path);
+    }
+    job->is_autosave = true;
+    this->push(std::move(job));
+}
+
+void SaveWriter::push(std::unique_ptr<Job> job) {
+    {
+        const std::scoped_lock lock(this->queue_mutex);
+        this->queue.push_back(std::move(job));
+    }
+    this->queue_cv.notify_all();
+}
+
+void SaveWriter::wait() {
+    std::unique_lock lock(this->queue_mutex);
+    this->queue_cv.wait(lock, [this] { return this->queue.empty() && !this->is_writing; });
+}
+
+std::string SaveWriter::get_latest_autosave() const {
+    const std::scoped_lock lock(this->queue_mutex);
+    return this->latest_autosave;
+}
+
+SaveWriter::Metrics SaveWriter::get_metrics() const {
+    const std::scoped_lock lock(this->queue_mutex);
+    return this->metrics;
+}
+
+void SaveWriter::write_loop() {
+    while(1) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock lock(this->queue_mutex);
+            this->queue_cv.wait(lock, [this] { return !this->queue.empty() || !this->is_running; });
+            if(this->queue.empty())
+                break; // Stopped and nothing left to write
+            job = std::move(this->queue.front());
+            this->queue.pop_front();
+            this->is_writing = true;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        bool written = false;
+        try {
+            // Write onto a temporary file first, a crash mid-write won't ruin the previous save
+            const auto tmp_path = job->path + ".tmp";
+            job->ar.to_file(tmp_path);
+            std::filesystem::rename(tmp_path, job->path);
+            if(job->is_autosave) {
+                this->rotate_autosaves();
+                const std::scoped_lock lock(this->queue_mutex);
+                this->latest_autosave = job->path;
+            }
+            written = true;
+        } catch(const std::exception& e) {
+            Eng3D::Log::error("save", "Can't write savefile %s: %s", job->path.data(), e.what());
+        }
+        const auto write_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if(written)
+            Eng3D::Log::debug("save", "Saved %s, snapshot took %.2fms and writing %.2fms", job->path.data(), job->snapshot_ms, write_ms);
+
+        {
+            const std::scoped_lock lock(this->queue_mutex);
+            if(written) {
+                this->metrics.saves_written++;
+                this->metrics.last_snapshot_ms = job->snapshot_ms;
+                this->metrics.last_write_ms = write_ms;
+                this->metrics.max_snapshot_ms = std::max(this->metrics.max_snapshot_ms, job->snapshot_ms);
+                this->metrics.max_write_ms = std::max(this->metrics.max_write_ms, write_ms);
+            } else {
+                this->metrics.failures++;
+            }
+            this->is_writing = false;
+        }
+        this->queue_cv.notify_all();
+    }
+}
+
+/// @brief Remove the oldest autosaves of the directory
+void SaveWriter::rotate_autosaves() {
+    std::vector<std::filesystem::directory_entry> autosaves;
+    for(const auto& entry : std::filesystem::directory_iterator(this->autosave_directory)) {
+        const auto filename = entry.path().filename().string();
+        if(entry.is_regular_file() && filename.starts_with("autosave_") && entry.path().extension() == ".sc4")
+            autosaves.push_back(entry);
+    }
+    if(autosaves.size() <= this->autosave_max_files)
+        return;
+    std::sort(autosaves.begin(), autosaves.end(), [](const auto& a, const auto& b) {
+        return a.last_write_time() > b.last_write_time();
+    });
+    for(size_t i = this->autosave_max_files; i < autosaves.size(); i++)
+        std::filesystem::remove(autosaves[i].path());
+}
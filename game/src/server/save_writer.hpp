@@ -0,0 +1,96 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/save_writer.hpp
+//
+// Abstract:
+//      Writes savefiles on a background thread, and handles autosaving.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "eng3d/chunked_archive.hpp"
+#include "world.hpp"
+
+/// @brief Saves the world without stalling the simulation. A snapshot is taken
+/// at a tick boundary by serializing the world onto the in-memory chunks of an
+/// archive (in parallel), then compressing and writing them is done by a
+/// background thread while the world keeps ticking
+class SaveWriter {
+    struct Job {
+        Eng3D::Deser::ChunkedArchive ar;
+        std::string path;
+        float snapshot_ms = 0.f;
+        bool is_autosave = false;
+    };
+public:
+    struct Metrics {
+        float last_snapshot_ms = 0.f; // Time the world was held for the snapshot
+        float last_write_ms = 0.f; // Time to compress and write onto the disk
+        float max_snapshot_ms = 0.f;
+        float max_write_ms = 0.f;
+        size_t saves_written = 0;
+        size_t autosaves_skipped = 0; // Previous autosave was still being written
+        size_t failures = 0;
+    };
+
+    SaveWriter();
+    ~SaveWriter();
+    /// @brief Snapshot the world and queue it for writing. Takes the world lock as
+    /// a reader, so it waits for the tick in progress to finish
+    void save(const World& world, NationId nation_id, const std::string_view path);
+    /// @brief Same as save, for callers already holding the world lock (i.e the UI,
+    /// whose events are handled in client_update with the world locked)
+    void save_locked(const World& world, NationId nation_id, const std::string_view path);
+    /// @brief Autosave every interval ticks onto the directory, keeping only the
+    /// newest max_files autosaves. An interval of 0 disables autosaving
+    void set_autosave(size_t interval_ticks, size_t max_files, const std::string_view directory);
+    /// @brief Call after each tick, autosaves if the interval has elapsed
+    void on_tick(const World& world, NationId nation_id);
+    /// @brief Block until every queued save has been written
+    void wait();
+    /// @brief Path of the last autosave written in this session, empty if none
+    std::string get_latest_autosave() const;
+    Metrics get_metrics() const;
+private:
+    /// @brief Serialize the world, the caller must hold the world lock
+    std::unique_ptr<Job> take_snapshot(const World& world, NationId nation_id, const std::string_view path);
+    void push(std::unique_ptr<Job> job);
+    void write_loop();
+    void rotate_autosaves();
+
+    size_t autosave_interval = 0;
+    size_t autosave_max_files = 3;
+    std::string autosave_directory = ".";
+    std::string latest_autosave;
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<std::unique_ptr<Job>> queue;
+    bool is_writing = false;
+    bool is_running = true;
+    Metrics metrics;
+    std::thread writer;
+};
@@ -28,6 +28,7 @@
 #include <mutex>
 #include <chrono>
 #include <thread>
+#include <algorithm>
 #include "eng3d/log.hpp"
 
 #include "action.hpp"
@@ -37,13 +38,16 @@
 #include "client/game_state.hpp"
 
 Server* g_server = nullptr;
-Server::Server(GameState& _gs, const unsigned port, const unsigned max_conn)
-    : Eng3D::Networking::Server(port, max_conn),
-    gs{ _gs }
-{
-    g_server = this;
-    Eng3D::Log::debug("server", Eng3D::translate_format("Deploying %zu threads for clients", n_clients));
 
+/// @brief Handlers also run headless when replaying, where there's no one to tell
+static void rebroadcast(const Eng3D::Networking::Packet& packet) {
+    if(g_server != nullptr)
+        g_server->broadcast(packet);
+}
+
+static std::unordered_map<ActionType, Server::ActionHandler> make_action_handlers() {
+    using ClientData = Server::ClientData;
+    std::unordered_map<ActionType, Server::ActionHandler> action_handlers;
     action_handlers[ActionType::NATION_ENACT_POLICY] = [](ClientData& client_data, const Eng3D::Networking::Packet&, Eng3D::Deser::Archive& ar) {
         Policies policies;
         Eng3D::Deser::deserialize(ar, policies);
@@ -60,17 +64,17 @@ Server::Server(GameState& _gs, const unsigned port, const unsigned max_conn)
 
         ProvinceId province_id;
         Eng3D::Deser::deserialize(ar, province_id);
-        auto& province = client_data.gs.world->provinces.at(province_id);
+        auto& province = g_world.provinces.at(province_id);
 
         if(unit.can_move()) {
             Eng3D::Log::debug("server", translate_format("Unit changes targets to %s", province.ref_name.data()).data());
             unit.set_path(province);
         }
     };
-    action_handlers[ActionType::BUILDING_START_BUILDING_UNIT] = [this](ClientData& client_data, const Eng3D::Networking::Packet&, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::BUILDING_START_BUILDING_UNIT] = [](ClientData& client_data, const Eng3D::Networking::Packet&, Eng3D::Deser::Archive& ar) {
         ProvinceId province_id;
         Eng3D::Deser::deserialize(ar, province_id);
-        auto& province = client_data.gs.world->provinces.at(province_id);
+        auto& province = g_world.provinces.at(province_id);
         BuildingTypeId building_type_id;
         Eng3D::Deser::deserialize(ar, building_type_id);
         NationId nation_id;
@@ -79,56 +83,56 @@ Server::Server(GameState& _gs, const unsigned port, const unsigned max_conn)
         Eng3D::Deser::deserialize(ar, unit_type_id);
         /// @todo Find building
         auto& building = province.get_buildings().at(building_type_id);
-        const auto& unit_type = gs.world->unit_types.at(unit_type_id);
+        const auto& unit_type = g_world.unit_types.at(unit_type_id);
         /// @todo Check nation can build this unit
         // Tell the building to build this specific unit type
         building.work_on_unit(unit_type);
         Eng3D::Log::debug("server", string_format("Building unit %s", unit_type.ref_name.data()));
     };
-    action_handlers[ActionType::BUILDING_ADD] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::BUILDING_ADD] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         ProvinceId province_id;
         Eng3D::Deser::deserialize(ar, province_id);
-        auto& province = gs.world->provinces.at(province_id);
+        auto& province = g_world.provinces.at(province_id);
         BuildingTypeId building_type_id;
         Eng3D::Deser::deserialize(ar, building_type_id);
         auto& building = province.buildings.at(building_type_id);
         building.budget += building.get_upgrade_cost();
         client_data.selected_nation->budget -= building.get_upgrade_cost();
-        Eng3D::Log::debug("server", string_format("Funding upgrade of buildin %s in %s", client_data.gs.world->building_types[building_type_id].ref_name.data(), client_data.selected_nation->ref_name.data()));
+        Eng3D::Log::debug("server", string_format("Funding upgrade of buildin %s in %s", g_world.building_types[building_type_id].ref_name.data(), client_data.selected_nation->ref_name.data()));
         // Rebroadcast
-        this->broadcast(Action::BuildingAdd::form_packet(province, client_data.gs.world->building_types[building_type_id]));
+        rebroadcast(Action::BuildingAdd::form_packet(province, g_world.building_types[building_type_id]));
     };
-    action_handlers[ActionType::PROVINCE_COLONIZE] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::PROVINCE_COLONIZE] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         ProvinceId province_id;
         Eng3D::Deser::deserialize(ar, province_id);
-        auto& province = gs.world->provinces.at(province_id);
+        auto& province = g_world.provinces.at(province_id);
         // Must not be already owned
         if(client_data.selected_nation == nullptr)
             CXX_THROW(ServerException, "You don't control a country");
         province.owner_id = client_data.selected_nation->get_id();
         // Rebroadcast
-        this->broadcast(packet);
+        rebroadcast(packet);
     };
-    action_handlers[ActionType::CHAT_MESSAGE] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::CHAT_MESSAGE] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         std::string msg{};
         Eng3D::Deser::deserialize(ar, msg);
         Eng3D::Log::debug("server", "Message: " + msg);
         // Rebroadcast
-        this->broadcast(packet);
+        rebroadcast(packet);
     };
-    action_handlers[ActionType::CHANGE_TREATY_APPROVAL] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::CHANGE_TREATY_APPROVAL] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         TreatyId treaty_id;
         Eng3D::Deser::deserialize(ar, treaty_id);
-        auto& treaty = gs.world->treaties.at(treaty_id);
+        auto& treaty = g_world.treaties.at(treaty_id);
         TreatyApproval approval;
         Eng3D::Deser::deserialize(ar, approval);
         //Eng3D::Log::debug("server", selected_nation->ref_name + " approves treaty " + treaty->name + " A=" + (approval == TreatyApproval::ACCEPTED ? "YES" : "NO"));
         if(!treaty.does_participate(*client_data.selected_nation))
             CXX_THROW(ServerException, "Nation does not participate in treaty");
         // Rebroadcast
-        this->broadcast(packet);
+        rebroadcast(packet);
     };
-    action_handlers[ActionType::DRAFT_TREATY] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::DRAFT_TREATY] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         Treaty treaty{};
         Eng3D::Deser::deserialize(ar, treaty.clauses);
         Eng3D::Deser::deserialize(ar, treaty.name);
@@ -168,9 +172,9 @@ Server::Server(GameState& _gs, const unsigned port, const unsigned max_conn)
         Eng3D::Deser::serialize(tmp_ar, treaty);
         auto tmp_packet = packet;
         tmp_packet.data(tmp_ar.get_buffer(), tmp_ar.size());
-        this->broadcast(tmp_packet);
+        rebroadcast(tmp_packet);
     };
-    action_handlers[ActionType::NATION_TAKE_DECISION] = [this](ClientData& client_data, const Eng3D::Networking::Packet&, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::NATION_TAKE_DECISION] = [](ClientData& client_data, const Eng3D::Networking::Packet&, Eng3D::Deser::Archive& ar) {
         // Find event by reference name
         Event event{};
         Eng3D::Deser::deserialize(ar, event);
@@ -178,50 +182,64 @@ Server::Server(GameState& _gs, const unsigned port, const unsigned max_conn)
         decltype(Decision::ref_name) ref_name;
         Eng3D::Deser::deserialize(ar, ref_name);
         auto decision = std::find_if(event.decisions.begin(), event.decisions.end(), [&ref_name](const auto& o) {
-            return o.ref_name.get_string() == ref_name.get_string();
+            return o.ref_name == ref_name;
         });
         if(decision == event.decisions.end())
             CXX_THROW(ServerException, translate_format("Decision %s not found", ref_name.data()));
         event.take_decision(*client_data.selected_nation, *decision);
         //Eng3D::Log::debug("server", "Event " + local_event.ref_name + " takes descision " + ref_name + " by nation " + selected_nation->ref_name);
     };
-    action_handlers[ActionType::SELECT_NATION] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::SELECT_NATION] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         NationId nation_id;
         Eng3D::Deser::deserialize(ar, nation_id);
-        auto& nation = gs.world->nations.at(nation_id);
+        auto& nation = g_world.nations.at(nation_id);
         Eng3D::Deser::deserialize(ar, nation.ai_do_cmd_troops);
         Eng3D::Deser::deserialize(ar, nation.ai_controlled);
         client_data.selected_nation = &nation;
         Eng3D::Log::debug("server", Eng3D::translate_format("Nation %s selected by client %s", client_data.selected_nation->ref_name.data(), client_data.username.data()));
     };
-    action_handlers[ActionType::SET_USERNAME] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::SET_USERNAME] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         NationId nation_id;
         Eng3D::Deser::deserialize(ar, nation_id);
-        auto& nation = gs.world->nations.at(nation_id);
+        auto& nation = g_world.nations.at(nation_id);
         Eng3D::Deser::deserialize(ar, client_data.username);
         client_data.selected_nation = &nation;
         // Tell all other clients about this player
-        this->broadcast(packet);
+        rebroadcast(packet);
     };
-    action_handlers[ActionType::DIPLO_DECLARE_WAR] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::DIPLO_DECLARE_WAR] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         NationId nation_id;
         Eng3D::Deser::deserialize(ar, nation_id);
-        auto& nation = gs.world->nations.at(nation_id);
+        auto& nation = g_world.nations.at(nation_id);
         client_data.selected_nation->declare_war(nation);
     };
-    action_handlers[ActionType::FOCUS_TECH] = [this](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
+    action_handlers[ActionType::FOCUS_TECH] = [](ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar) {
         TechnologyId technology_id;
         Eng3D::Deser::deserialize(ar, technology_id);
-        auto& technology = gs.world->technologies.at(technology_id);
+        auto& technology = g_world.technologies.at(technology_id);
         if(!client_data.selected_nation->can_research(technology))
             CXX_THROW(ServerException, "Can't research tech at the moment");
         client_data.selected_nation->focus_tech_id = technology;
     };
+    return action_handlers;
+}
+
+const std::unordered_map<ActionType, Server::ActionHandler>& Server::get_action_handlers() {
+    static const auto action_handlers = make_action_handlers();
+    return action_handlers;
+}
+
+Server::Server(GameState& _gs, const unsigned port, const unsigned max_conn)
+    : Eng3D::Networking::Server(port, max_conn),
+    gs{ _gs }
+{
+    g_server = this;
+    Eng3D::Log::debug("server", Eng3D::translate_format("Deploying %zu threads for clients", n_clients));
 
     clients = new Eng3D::Networking::ServerClient[n_clients];
     for(size_t i = 0; i < n_clients; i++) {
         clients[i].is_connected = false;
-        clients_data.push_back(gs);
+        clients_data.emplace_back();
     }
     clients_extra_data.resize(n_clients, nullptr);
     // "Starting" thread, this one will wake up all the other ones
@@ -230,7 +248,6 @@ Server::Server(GameState& _gs, const unsigned port, const unsigned max_conn)
 
 void Server::on_connect(int conn_fd, int id) {
     auto& cl = clients[id];
-    auto& client_data = clients_data[id];
     Eng3D::Networking::Packet packet(conn_fd);
     packet.pred = [this]() {
         return this->run == true;
@@ -243,7 +260,8 @@ void Server::on_connect(int conn_fd, int id) {
         ActionType action;
         Eng3D::Deser::deserialize(ar, action);
         Eng3D::Deser::deserialize(ar, cl.username);
-        client_data.username = cl.username;
+        const std::scoped_lock lock(this->clients_data_mutex);
+        this->clients_data[id].username = cl.username;
     }
 
     { // Tell all other clients about the connection of this new client
@@ -271,21 +289,196 @@ void Server::on_disconnect() {
 }
 
 void Server::handler(const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar, int id) {
-    auto& client_data = clients_data[id];
+    // Only this thread changes the data of this client, so it works on a copy which is
+    // published back once a session action changed it
+    ClientData client_data;
+    {
+        const std::scoped_lock lock(this->clients_data_mutex);
+        client_data = this->clients_data[id];
+    }
     ActionType action;
     Eng3D::Deser::deserialize(ar, action);
     if(client_data.selected_nation == nullptr && !(action == ActionType::SET_USERNAME || action == ActionType::CHAT_MESSAGE || action == ActionType::SELECT_NATION))
         CXX_THROW(ServerException, Eng3D::translate_format("Unallowed operation %i without selected nation", static_cast<int>(action)));
 
-    const std::scoped_lock lock(g_world.world_mutex);
-    //switch(action) {
+    const auto& action_handlers = Server::get_action_handlers();
+    const auto it = action_handlers.find(action);
+    if(it == action_handlers.cend())
+        CXX_THROW(ServerException, string_format("Unhandled action %u", static_cast<unsigned int>(action)));
+
+    // Session actions are applied right away since the following packets of this client
+    // depend on them, the editor also wants to see its changes without ticking the world
+    const bool is_session_action = action == ActionType::CHAT_MESSAGE || action == ActionType::SET_USERNAME || action == ActionType::SELECT_NATION;
+    if(is_session_action || gs.editor) {
+        if(action == ActionType::CHAT_MESSAGE || action == ActionType::SET_USERNAME) {
+            // Only reads the world
+            const std::shared_lock lock(g_world.world_mutex);
+            it->second(client_data, packet, ar);
+        } else {
+            const std::scoped_lock lock(g_world.world_mutex);
+            it->second(client_data, packet, ar);
+            // Applied in between ticks, so a replay applies it before the next one
+            const auto nation_id = client_data.selected_nation != nullptr ? client_data.selected_nation->get_id() : Nation::invalid();
+            this->recorder.record_command(nation_id, packet.buffer);
+        }
+        {
+            const std::scoped_lock lock(this->clients_data_mutex);
+            this->clients_data[id] = client_data;
+        }
+
+        // Update the state of the UI with the editor
+        if(gs.editor) gs.update_tick = true;
+        return;
+    }
+
+    // Everything else mutates the world, so it's deferred to the start of the next tick
+    Command cmd{};
+    cmd.client_id = id;
+    cmd.nation_id = client_data.selected_nation->get_id();
+    cmd.seq = this->command_seq++;
+    cmd.username = client_data.username;
+    cmd.packet = packet;
+    this->pending_commands.push(cmd);
+}
+
+/// @brief Applies all the commands enqueued since the last tick, must be called by the world
+/// thread while holding the world lock. Commands are sorted by client and then by order of
+/// arrival so the result doesn't depend on how the network threads were scheduled
+void Server::apply_commands() {
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<Command> commands;
+    Command cmd;
+    while(this->pending_commands.try_pop(cmd))
+        commands.push_back(cmd);
+    // Commands being replayed from a log for this tick
+    while(!this->replayed_commands.empty() && this->replayed_commands.front().first <= gs.world->time) {
+        commands.push_back(this->replayed_commands.front().second);
+        this->replayed_commands.pop_front();
+    }
+    std::sort(commands.begin(), commands.end(), [](const auto& lhs, const auto& rhs) {
+        if(lhs.client_id != rhs.client_id)
+            return lhs.client_id < rhs.client_id;
+        return lhs.seq < rhs.seq;
+    });
+
+    for(const auto& command : commands) {
+        // Act on behalf of the nation the command was issued for, even if the client has
+        // selected another one since then (replayed commands don't have a client at all)
+        ClientData client_data{};
+        client_data.username = command.username;
+        client_data.selected_nation = &gs.world->nations.at(command.nation_id);
+        try {
+            Server::execute_command(client_data, command.packet);
+        } catch(const std::exception& e) {
+            Eng3D::Log::error("server", Eng3D::translate_format("Command from client %i rejected: %s", command.client_id, e.what()));
+            continue;
+        }
+
+        // Log the command so the session can be replayed later
+        this->command_log.push_back(LoggedCommand{ gs.world->time, command.nation_id, command.packet.buffer });
+        if(this->command_log.size() > this->max_logged_commands)
+            this->command_log.pop_front();
+        this->recorder.record_command(command.nation_id, command.packet.buffer);
+    }
+
+    this->last_queue_depth = commands.size();
+    this->last_apply_time_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    if(!commands.empty())
+        Eng3D::Log::debug("server", Eng3D::translate_format("Applied %zu commands in %.2fms", this->last_queue_depth, this->last_apply_time_ms));
+}
+
+/// @brief Runs the handler of the action of a packet, on behalf of the nation selected
+/// on client_data. Throws if the action is unknown or not allowed
+void Server::execute_command(ClientData& client_data, const Eng3D::Networking::Packet& packet) {
+    Eng3D::Deser::Archive ar{};
+    ar.set_buffer(packet.buffer.data(), packet.buffer.size());
+    ar.rewind();
+    ActionType action;
+    Eng3D::Deser::deserialize(ar, action);
+    const auto& action_handlers = Server::get_action_handlers();
     const auto it = action_handlers.find(action);
     if(it == action_handlers.cend())
         CXX_THROW(ServerException, string_format("Unhandled action %u", static_cast<unsigned int>(action)));
     it->second(client_data, packet, ar);
+}
 
-    // Update the state of the UI with the editor
-    if(gs.editor) gs.update_tick = true;
+/// @brief Sends each client the provinces and units its nation can see, instead of the whole
+/// world. Who owns and controls a province is public, so changes of it go to everyone.
+/// Must be called by the world thread while holding the world lock
+void Server::replicate(const World& world) {
+    std::vector<NationId> client_nation_ids(n_clients, Nation::invalid());
+    {
+        const std::scoped_lock lock(this->clients_data_mutex);
+        for(size_t i = 0; i < n_clients; i++)
+            if(clients_data[i].selected_nation != nullptr)
+                client_nation_ids[i] = clients_data[i].selected_nation->get_id();
+    }
+    std::vector<NationId> player_nations;
+    for(size_t i = 0; i < n_clients; i++)
+        if(clients[i].is_connected && Nation::is_valid(client_nation_ids[i]))
+            player_nations.push_back(client_nation_ids[i]);
+    std::sort(player_nations.begin(), player_nations.end());
+    player_nations.erase(std::unique(player_nations.begin(), player_nations.end()), player_nations.end());
+    this->visibility.update(world, player_nations);
+
+    std::vector<ProvinceId> changed_ids = world.province_manager.get_changed_owner_provinces();
+    const auto& changed_control_ids = world.province_manager.get_changed_control_provinces();
+    changed_ids.insert(changed_ids.end(), changed_control_ids.begin(), changed_control_ids.end());
+    std::sort(changed_ids.begin(), changed_ids.end());
+    changed_ids.erase(std::unique(changed_ids.begin(), changed_ids.end()), changed_ids.end());
+    if(!changed_ids.empty())
+        this->broadcast(Action::ProvinceControlUpdate::form_packet(world.provinces, changed_ids));
+
+    // Packets are made once per nation and shared by the clients playing it
+    for(const auto nation_id : player_nations) {
+        const auto& province_ids = this->visibility.get_visible_provinces(nation_id);
+        std::vector<UnitId> unit_ids;
+        for(const auto province_id : province_ids) {
+            const auto& province_unit_ids = world.unit_manager.get_province_units(province_id);
+            unit_ids.insert(unit_ids.end(), province_unit_ids.begin(), province_unit_ids.end());
+        }
+
+        auto province_packet = Action::ProvinceUpdate::form_packet(world.provinces, province_ids);
+        auto unit_packet = Action::UnitUpdate::form_packet(world.unit_manager, unit_ids);
+        this->share(province_packet);
+        this->share(unit_packet);
+        for(size_t i = 0; i < n_clients; i++) {
+            if(!clients[i].is_connected || client_nation_ids[i] != nation_id)
+                continue;
+            clients[i].packets.push(province_packet);
+            clients[i].packets.push(unit_packet);
+        }
+    }
+}
+
+void Server::save_command_log(const std::string_view path) {
+    if(this->command_log.empty()) return; // Nothing was applied yet
+    Eng3D::Deser::Archive ar{};
+    for(const auto& command : this->command_log) {
+        Eng3D::Deser::serialize(ar, command.time);
+        Eng3D::Deser::serialize(ar, command.nation_id);
+        Eng3D::Deser::serialize(ar, command.buffer);
+    }
+    ar.to_file(path);
+}
+
+/// @brief Loads a command log made by save_command_log, each command will be applied again
+/// on the tick it was originally applied on
+void Server::replay_command_log(const std::string_view path) {
+    Eng3D::Deser::Archive ar{};
+    ar.from_file(path);
+    while(ar.ptr < ar.size()) {
+        int time;
+        Eng3D::Deser::deserialize(ar, time);
+        Command cmd{};
+        cmd.client_id = -1;
+        cmd.seq = this->command_seq++;
+        Eng3D::Deser::deserialize(ar, cmd.nation_id);
+        std::vector<uint8_t> buffer;
+        Eng3D::Deser::deserialize(ar, buffer);
+        cmd.packet.data(buffer.data(), buffer.size());
+        this->replayed_commands.emplace_back(time, cmd);
+    }
 }
 
 /// @brief This is the handling thread-function for handling a connection to a single client
@@ -29,9 +29,14 @@
 #include <atomic>
 #include <vector>
 #include <unordered_map>
+#include <string_view>
+#include <functional>
+#include <tbb/concurrent_queue.h>
 
 #include "eng3d/network.hpp"
 #include "action.hpp"
+#include "server/visibility.hpp"
+#include "server/replay.hpp"
 
 class ServerException : public std::exception {
     std::string buffer;
@@ -51,14 +56,24 @@ class Server : public Eng3D::Networking::Server {
 public:
     struct ClientData {
         Nation* selected_nation = nullptr;
-        GameState& gs;
         std::string username;
+    };
+    using ActionHandler = std::function<void(ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar)>;
 
-        ClientData(GameState& _gs)
-            : gs{ _gs }
-        {
+    /// @brief A client action waiting to be applied by the world thread
+    struct Command {
+        int client_id; // Client that sent the command (-1 if replayed from a log)
+        NationId nation_id; // Nation the command was issued for
+        uint64_t seq; // Order of arrival
+        std::string username; // Of the client when the command was sent
+        Eng3D::Networking::Packet packet;
+    };
 
-        }
+    /// @brief An applied command, as saved by save_command_log
+    struct LoggedCommand {
+        int time; // Tick the command was applied on
+        NationId nation_id;
+        std::vector<uint8_t> buffer;
     };
 
     Server(GameState& gs, unsigned port = 1825, unsigned max_conn = 4);
@@ -67,10 +82,33 @@ public:
     void on_connect(int conn_fd, int id) override;
     void on_disconnect() override;
     void handler(const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar, int id) override;
+    void apply_commands();
+    static void execute_command(ClientData& client_data, const Eng3D::Networking::Packet& packet);
+    /// @brief Handlers only act on g_world, so commands can also be applied without a server
+    static const std::unordered_map<ActionType, ActionHandler>& get_action_handlers();
+    void replicate(const World& world);
+    void save_command_log(const std::string_view path);
+    void replay_command_log(const std::string_view path);
 
+    /// @brief Changed by the network threads and read by the world thread, so it's only
+    /// accessed while holding clients_data_mutex
     std::vector<ClientData> clients_data;
+    std::mutex clients_data_mutex;
     std::vector<Nation*> clients_extra_data;
-    std::unordered_map<ActionType, std::function<void(ClientData& client_data, const Eng3D::Networking::Packet& packet, Eng3D::Deser::Archive& ar)>> action_handlers;
+    /// @brief Commands enqueued by the network threads, applied at the start of every tick
+    tbb::concurrent_queue<Command> pending_commands;
+    std::atomic<uint64_t> command_seq = 0;
+    /// @brief The last applied commands tagged with the tick they were applied on, can be
+    /// saved with save_command_log and fed back with replay_command_log
+    std::deque<LoggedCommand> command_log;
+    size_t max_logged_commands = 100'000; // Oldest commands are dropped past this
+    std::deque<std::pair<int, Command>> replayed_commands;
+    size_t last_queue_depth = 0;
+    float last_apply_time_ms = 0.f;
+    /// @brief What the nation of each client can see, see replicate
+    VisibilityTracker visibility;
+    /// @brief Records the applied commands of every tick when started, see ReplayRecorder
+    ReplayRecorder recorder;
 };
 
 extern Server* g_server;
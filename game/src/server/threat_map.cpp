@@ -0,0 +1,142 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/threat_map.cpp
+//
+// Abstract:
+//      Strength of the units on and around every province, shared by the AI
+//      of all nations.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include "eng3d/utils.hpp"
+
+#include "world.hpp"
+#include "server/threat_map.hpp"
+
+ThreatMap threat_map;
+
+/// @brief Add the strength onto the entry of the nation, making one if there's none
+static void add_presence(std::vector<ThreatMap::Presence>& presences, NationId nation_id, float strength, float battle_strength) {
+    auto it = std::find_if(presences.begin(), presences.end(), [nation_id](const auto& e) {
+        return e.nation_id == nation_id;
+    });
+    if(it == presences.end()) {
+        presences.push_back(ThreatMap::Presence{ nation_id });
+        it = presences.end() - 1;
+    }
+    it->strength += strength;
+    it->battle_strength += battle_strength;
+}
+
+void ThreatMap::update(const World& world) {
+    this->refreshed = 0;
+    if(!this->is_valid) {
+        this->local.assign(world.provinces.size(), {});
+        this->nearby.assign(world.provinces.size(), {});
+        this->unit_provinces.assign(world.nations.size(), {});
+        this->is_dirty.assign(world.provinces.size(), false);
+        this->is_nearby_dirty.assign(world.provinces.size(), false);
+        this->dirty.clear();
+        this->nearby_dirty.clear();
+        this->is_valid = true;
+        for(const auto& province : world.provinces)
+            this->mark(province.get_id());
+    }
+
+    for(const auto province_id : this->dirty) {
+        this->is_dirty[province_id] = false;
+        this->refresh_local(world, province_id);
+    }
+    this->refreshed = this->dirty.size();
+    this->dirty.clear();
+    // Only after every local presence is up to date
+    for(const auto province_id : this->nearby_dirty) {
+        this->is_nearby_dirty[province_id] = false;
+        this->refresh_nearby(world, province_id);
+    }
+    this->nearby_dirty.clear();
+}
+
+void ThreatMap::on_unit_add(ProvinceId province_id) {
+    this->mark(province_id);
+}
+
+void ThreatMap::on_unit_remove(ProvinceId province_id) {
+    this->mark(province_id);
+}
+
+void ThreatMap::on_unit_move(ProvinceId from_id, ProvinceId to_id) {
+    this->mark(from_id);
+    this->mark(to_id);
+}
+
+void ThreatMap::on_battle(ProvinceId province_id) {
+    this->mark(province_id);
+}
+
+void ThreatMap::on_unit_change(ProvinceId province_id) {
+    this->mark(province_id);
+}
+
+void ThreatMap::mark(ProvinceId province_id) {
+    // Everything is rebuilt anyways
+    if(!this->is_valid || static_cast<size_t>(province_id) >= this->is_dirty.size()) return;
+    if(!this->is_dirty[province_id]) {
+        this->is_dirty[province_id] = true;
+        this->dirty.push_back(province_id);
+    }
+}
+
+void ThreatMap::refresh_local(const World& world, ProvinceId province_id) {
+    auto& presences = this->local[province_id];
+    for(const auto& presence : presences)
+        Eng3D::fast_erase(this->unit_provinces[presence.nation_id], province_id);
+    presences.clear();
+    for(const auto unit_id : world.unit_manager.get_province_units(province_id)) {
+        const auto& unit = world.unit_manager.units[unit_id];
+        const auto strength = unit.get_strength();
+        add_presence(presences, unit.owner_id, unit.on_battle ? 0.f : strength, unit.on_battle ? strength : 0.f);
+    }
+    // By nation, so the sums don't depend on the order of the units
+    std::sort(presences.begin(), presences.end(), [](const auto& a, const auto& b) {
+        return a.nation_id < b.nation_id;
+    });
+    for(const auto& presence : presences)
+        this->unit_provinces[presence.nation_id].push_back(province_id);
+
+    for(const auto neighbour_id : world.provinces[province_id].neighbour_ids) {
+        if(!this->is_nearby_dirty[neighbour_id]) {
+            this->is_nearby_dirty[neighbour_id] = true;
+            this->nearby_dirty.push_back(neighbour_id);
+        }
+    }
+}
+
+void ThreatMap::refresh_nearby(const World& world, ProvinceId province_id) {
+    auto& presences = this->nearby[province_id];
+    presences.clear();
+    for(const auto neighbour_id : world.provinces[province_id].neighbour_ids) {
+        // Each province spreads its units evenly over its neighbours
+        const auto& neighbour = world.provinces[neighbour_id];
+        if(neighbour.neighbour_ids.empty()) continue;
+        const auto share = 1.f / neighbour.neighbour_ids.size();
+        for(const auto& presence : this->local[neighbour_id])
+            add_presence(presences, presence.nation_id, presence.strength * share, presence.battle_strength * share);
+    }
+}
@@ -0,0 +1,103 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/threat_map.hpp
+//
+// Abstract:
+//      Strength of the units on and around every province, shared by the AI
+//      of all nations.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "world.hpp"
+
+/// @brief Keeps, for every province, the strength of the units of each nation standing
+/// on it and the strength spilling over from its neighbours (each province spreads its
+/// units evenly over its neighbours). Unit moves, additions, removals, replenishments and
+/// changes of owner, and battles mark provinces as dirty and only those and their neighbours
+/// are refreshed, so the AI of each nation weights the forces by its own stances without
+/// scanning provinces or units.
+/// Ownership is read straight from the world when querying, so it's never stale.
+/// Must only be used by the world thread
+class ThreatMap {
+public:
+    /// @brief Units of a nation on (or next to) a province
+    struct Presence {
+        NationId nation_id;
+        float strength = 0.f; // Units not fighting
+        float battle_strength = 0.f; // Units on a battle
+    };
+
+    /// @brief Refresh the dirty provinces, or everything if invalidated. Called once per tick
+    void update(const World& world);
+    /// @brief Everything will be rebuilt on the next update, i.e after loading a savefile
+    void invalidate() noexcept {
+        this->is_valid = false;
+    }
+
+    bool is_built() const noexcept {
+        return this->is_valid;
+    }
+
+    void on_unit_add(ProvinceId province_id);
+    void on_unit_remove(ProvinceId province_id);
+    void on_unit_move(ProvinceId from_id, ProvinceId to_id);
+    /// @brief Units fighting on the province changed their strength
+    void on_battle(ProvinceId province_id);
+    /// @brief A unit on the province was replenished or changed hands without moving
+    void on_unit_change(ProvinceId province_id);
+
+    /// @brief Units standing on the province, one entry per nation
+    const std::vector<Presence>& get_local(ProvinceId province_id) const {
+        return this->local[province_id];
+    }
+
+    /// @brief Units spilling over from the neighbours of the province, one entry per nation
+    const std::vector<Presence>& get_nearby(ProvinceId province_id) const {
+        return this->nearby[province_id];
+    }
+
+    /// @brief Provinces where the nation has units, in no particular order
+    const std::vector<ProvinceId>& get_unit_provinces(NationId nation_id) const {
+        return this->unit_provinces[nation_id];
+    }
+
+    /// @brief Provinces refreshed on the last update
+    size_t get_refreshed() const {
+        return this->refreshed;
+    }
+private:
+    void mark(ProvinceId province_id);
+    void refresh_local(const World& world, ProvinceId province_id);
+    void refresh_nearby(const World& world, ProvinceId province_id);
+
+    bool is_valid = false;
+    std::vector<std::vector<Presence>> local;
+    std::vector<std::vector<Presence>> nearby;
+    std::vector<std::vector<ProvinceId>> unit_provinces;
+    std::vector<bool> is_dirty;
+    std::vector<ProvinceId> dirty;
+    std::vector<bool> is_nearby_dirty;
+    std::vector<ProvinceId> nearby_dirty;
+    size_t refreshed = 0;
+};
+
+extern ThreatMap threat_map;
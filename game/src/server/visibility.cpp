@@ -0,0 +1,174 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/visibility.cpp
+//
+// Abstract:
+//      Incremental per nation visibility, used for interest management.
+// ----------------------------------------------------------------------------
+
+#include <cassert>
+#include <algorithm>
+#include "server/visibility.hpp"
+#include "world.hpp"
+
+VisibilityTracker::View* VisibilityTracker::find_view(NationId nation_id) {
+    for(auto& view : this->views)
+        if(view.nation_id == nation_id)
+            return &view;
+    return nullptr;
+}
+
+const VisibilityTracker::View* VisibilityTracker::find_view(NationId nation_id) const {
+    for(const auto& view : this->views)
+        if(view.nation_id == nation_id)
+            return &view;
+    return nullptr;
+}
+
+std::vector<bool> VisibilityTracker::get_friends(const World& world, NationId nation_id) const {
+    std::vector<bool> friends(world.nations.size(), false);
+    for(const auto& nation : world.nations)
+        friends[nation] = nation.get_id() == nation_id || world.get_relation(nation, nation_id).is_allied();
+    return friends;
+}
+
+void VisibilityTracker::reveal(View& view, ProvinceId province_id, int delta) {
+    auto& counter = view.counters[province_id];
+    if(delta > 0) {
+        if(counter++ == 0) {
+            view.visible_index[province_id] = view.visible.size();
+            view.visible.push_back(province_id);
+        }
+    } else {
+        assert(counter > 0);
+        if(--counter == 0) {
+            // Swap with the last one so the removal is O(1)
+            const auto index = view.visible_index[province_id];
+            const auto last_id = view.visible.back();
+            view.visible[index] = last_id;
+            view.visible_index[last_id] = index;
+            view.visible.pop_back();
+        }
+    }
+}
+
+/// @brief A source on the province reveals it and its neighbours
+void VisibilityTracker::add_source(const World& world, View& view, ProvinceId province_id, int delta) {
+    this->reveal(view, province_id, delta);
+    for(const auto neighbour_id : world.provinces[province_id].neighbour_ids)
+        this->reveal(view, neighbour_id, delta);
+}
+
+void VisibilityTracker::rebuild(const World& world, View& view) {
+    view.counters.assign(world.provinces.size(), 0);
+    view.visible_index.assign(world.provinces.size(), 0);
+    view.visible.clear();
+    for(const auto& nation : world.nations) {
+        if(!view.friends[nation]) continue;
+        for(const auto province_id : nation.controlled_provinces)
+            this->add_source(world, view, province_id, 1);
+    }
+    world.unit_manager.units.for_each([&](const auto& unit) {
+        if(view.friends[this->unit_owners[unit]])
+            this->add_source(world, view, world.unit_manager.get_unit_current_province(unit), 1);
+    });
+}
+
+void VisibilityTracker::update(const World& world, const std::vector<NationId>& player_nations) {
+    if(!this->is_valid) {
+        this->unit_owners.clear();
+        world.unit_manager.units.for_each([this](const auto& unit) {
+            if(static_cast<size_t>(unit.get_id()) >= this->unit_owners.size())
+                this->unit_owners.resize(static_cast<size_t>(unit.get_id()) + 1);
+            this->unit_owners[unit] = unit.owner_id;
+        });
+        for(auto& view : this->views)
+            view.friends.clear(); // Forces a rebuild below
+        this->is_valid = true;
+    }
+
+    std::erase_if(this->views, [&player_nations](const auto& view) {
+        return std::find(player_nations.begin(), player_nations.end(), view.nation_id) == player_nations.end();
+    });
+    for(const auto nation_id : player_nations) {
+        if(this->find_view(nation_id) == nullptr) {
+            auto& view = this->views.emplace_back();
+            view.nation_id = nation_id;
+        }
+    }
+
+    // Alliances are few and seldom change, a full rebuild is fine for them
+    for(auto& view : this->views) {
+        auto friends = this->get_friends(world, view.nation_id);
+        if(friends != view.friends) {
+            view.friends = std::move(friends);
+            this->rebuild(world, view);
+        }
+    }
+}
+
+void VisibilityTracker::on_unit_add(const World& world, UnitId unit_id, NationId owner_id, ProvinceId province_id) {
+    if(!this->is_valid) return;
+    if(static_cast<size_t>(unit_id) >= this->unit_owners.size())
+        this->unit_owners.resize(static_cast<size_t>(unit_id) + 1);
+    this->unit_owners[unit_id] = owner_id;
+    for(auto& view : this->views)
+        if(view.friends[owner_id])
+            this->add_source(world, view, province_id, 1);
+}
+
+void VisibilityTracker::on_unit_remove(const World& world, UnitId unit_id, ProvinceId province_id) {
+    if(!this->is_valid) return;
+    const auto owner_id = this->unit_owners[unit_id];
+    for(auto& view : this->views)
+        if(view.friends[owner_id])
+            this->add_source(world, view, province_id, -1);
+}
+
+void VisibilityTracker::on_unit_move(const World& world, UnitId unit_id, ProvinceId from_id, ProvinceId to_id) {
+    if(!this->is_valid) return;
+    const auto owner_id = this->unit_owners[unit_id];
+    for(auto& view : this->views) {
+        if(!view.friends[owner_id]) continue;
+        // Reveal the new ones first, so the shared neighbours don't flicker out of the list
+        this->add_source(world, view, to_id, 1);
+        this->add_source(world, view, from_id, -1);
+    }
+}
+
+void VisibilityTracker::on_control_change(const World& world, ProvinceId province_id, NationId old_controller_id, NationId new_controller_id) {
+    if(!this->is_valid) return;
+    for(auto& view : this->views) {
+        if(Nation::is_valid(new_controller_id) && view.friends[new_controller_id])
+            this->add_source(world, view, province_id, 1);
+        if(Nation::is_valid(old_controller_id) && view.friends[old_controller_id])
+            this->add_source(world, view, province_id, -1);
+    }
+}
+
+bool VisibilityTracker::is_visible(NationId nation_id, ProvinceId province_id) const {
+    const auto* view = this->find_view(nation_id);
+    return view != nullptr && !view->counters.empty() && view->counters[province_id] > 0;
+}
+
+const std::vector<ProvinceId>& VisibilityTracker::get_visible_provinces(NationId nation_id) const {
+    static const std::vector<ProvinceId> none;
+    const auto* view = this->find_view(nation_id);
+    return view != nullptr ? view->visible : none;
+}
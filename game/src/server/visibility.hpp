@@ -0,0 +1,72 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      server/visibility.hpp
+//
+// Abstract:
+//      Tracks what each player nation can see, so only that is replicated.
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "world.hpp"
+
+/// @brief Keeps the provinces each player nation can see: the ones controlled by the
+/// nation or its allies and the ones where their units stand, plus the neighbours
+/// of both. Every such province is a "source" that bumps the counters of the provinces
+/// it reveals, sources are added and removed as units move and provinces change hands
+/// so nothing is recomputed from scratch each tick. Must only be used by the world thread
+class VisibilityTracker {
+    struct View {
+        NationId nation_id;
+        std::vector<bool> friends; // Nations whose provinces and units are seen (itself included)
+        std::vector<uint32_t> counters; // Sources revealing each province
+        std::vector<ProvinceId> visible;
+        std::vector<uint32_t> visible_index; // Position of each province on visible
+    };
+public:
+    /// @brief Start tracking the given nations (and stop tracking the rest), then
+    /// rebuild the views whose alliances have changed. Called once per tick
+    void update(const World& world, const std::vector<NationId>& player_nations);
+    /// @brief Everything will be rebuilt on the next update, i.e after loading a savefile
+    void invalidate() noexcept {
+        this->is_valid = false;
+    }
+
+    void on_unit_add(const World& world, UnitId unit_id, NationId owner_id, ProvinceId province_id);
+    void on_unit_remove(const World& world, UnitId unit_id, ProvinceId province_id);
+    void on_unit_move(const World& world, UnitId unit_id, ProvinceId from_id, ProvinceId to_id);
+    void on_control_change(const World& world, ProvinceId province_id, NationId old_controller_id, NationId new_controller_id);
+
+    bool is_visible(NationId nation_id, ProvinceId province_id) const;
+    /// @brief Provinces seen by the nation, in no particular order
+    const std::vector<ProvinceId>& get_visible_provinces(NationId nation_id) const;
+private:
+    View* find_view(NationId nation_id);
+    const View* find_view(NationId nation_id) const;
+    std::vector<bool> get_friends(const World& world, NationId nation_id) const;
+    void rebuild(const World& world, View& view);
+    void add_source(const World& world, View& view, ProvinceId province_id, int delta);
+    void reveal(View& view, ProvinceId province_id, int delta);
+
+    bool is_valid = false;
+    std::vector<View> views;
+    std::vector<NationId> unit_owners; // Owner of each unit when it was added
+};
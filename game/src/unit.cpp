@@ -39,6 +39,7 @@
 #include "eng3d/utils.hpp"
 
 #include "server/server_network.hpp"
+#include "server/threat_map.hpp"
 #include "action.hpp"
 #include "world.hpp"
 
@@ -128,18 +129,21 @@ void UnitManager::add_unit(Unit unit, ProvinceId unit_current_province) {
     if(static_cast<size_t>(unit_current_province) >= province_units.size())
         province_units.resize(static_cast<size_t>(unit_current_province) + 1);
     province_units[unit_current_province].push_back(index);
+    threat_map.on_unit_add(unit_current_province);
 
-    if(g_server != nullptr) /// @todo Obtain the cached ID of the newly added unit
-        g_server->broadcast(Action::UnitAdd::form_packet(units[index]));
+    // Clients get the units they can see on every tick, see Server::replicate
+    if(g_server != nullptr)
+        g_server->visibility.on_unit_add(World::get_instance(), UnitId(index), units[index].owner_id, unit_current_province);
 }
 
 void UnitManager::remove_unit(UnitId unit_id) {
+    const auto current_province_id = unit_province[unit_id];
     if(g_server != nullptr)
-        g_server->broadcast(Action::UnitRemove::form_packet(units[unit_id]));
+        g_server->visibility.on_unit_remove(World::get_instance(), unit_id, current_province_id);
 
-    const auto current_province_id = unit_province[unit_id];
     Eng3D::fast_erase(province_units[current_province_id], unit_id);
     units.remove(unit_id);
+    threat_map.on_unit_remove(current_province_id);
 
     // Assert there was no duplication (id remaining after removal is troubling)
     const auto& p = province_units[current_province_id];
@@ -164,8 +168,9 @@ void UnitManager::move_unit(UnitId unit_id, ProvinceId target_province_id) {
 
     unit_province[unit_id] = target_province_id;
     province_units[target_province_id].push_back(unit_id);
+    threat_map.on_unit_move(current_province_id, target_province_id);
     if(g_server != nullptr)
-        g_server->broadcast(Action::UnitMove::form_packet(units[unit_id], world.provinces[target_province_id]));
+        g_server->visibility.on_unit_move(world, unit_id, current_province_id, target_province_id);
     
     ProvinceId id;
     for(const auto& unit_ids : province_units) {
@@ -179,8 +184,43 @@ void UnitManager::move_unit(UnitId unit_id, ProvinceId target_province_id) {
     Eng3D::Log::debug("game", string_format("Moving unit id=%zu in %s->%s", (size_t)unit_id, g_world.provinces[current_province_id].name.data(), g_world.provinces[target_province_id].name.data()));
 }
 
+void UnitManager::set_unit(Unit unit, ProvinceId province_id) {
+    const auto unit_id = unit.get_id();
+    if(!units.contains(unit_id)) {
+        units.add_at(unit_id, unit);
+        if(static_cast<size_t>(unit_id) >= unit_province.size())
+            unit_province.resize(static_cast<size_t>(unit_id) + 1);
+        unit_province[unit_id] = province_id;
+        if(static_cast<size_t>(province_id) >= province_units.size())
+            province_units.resize(static_cast<size_t>(province_id) + 1);
+        province_units[province_id].push_back(unit_id);
+        threat_map.on_unit_add(province_id);
+        return;
+    }
+
+    units[unit_id] = unit;
+    const auto current_province_id = unit_province[unit_id];
+    if(current_province_id != province_id) {
+        Eng3D::fast_erase(province_units[current_province_id], unit_id);
+        unit_province[unit_id] = province_id;
+        province_units[province_id].push_back(unit_id);
+    }
+    threat_map.on_unit_move(current_province_id, province_id);
+}
+
 void Unit::set_owner(const Nation& nation) {
+    if(this->owner_id == nation.get_id()) return;
     this->owner_id = nation;
+    // Units that aren't on the world yet are counted by the threat map once added
+    auto& unit_manager = World::get_instance().unit_manager;
+    if(unit_manager.units.contains(this->get_id()) && &unit_manager.units[this->get_id()] == this)
+        threat_map.on_unit_change(this->province_id());
+}
+
+void Unit::replenish() {
+    if(this->size >= this->base) return;
+    this->size = glm::min<float>(this->base, this->size + this->experience * 10.f);
+    threat_map.on_unit_change(this->province_id());
 }
 
 void Unit::set_path(const Province& target) {
@@ -28,6 +28,7 @@
 #include <cstring>
 #include <cassert>
 #include <set>
+#include <chrono>
 #ifndef _MSC_VER
 #	include <sys/cdefs.h>
 #endif
@@ -36,6 +37,7 @@
 #include <tbb/parallel_for.h>
 #include <tbb/combinable.h>
 
+#include "eng3d/arena.hpp"
 #include "eng3d/binary_image.hpp"
 #include "eng3d/log.hpp"
 #include "eng3d/serializer.hpp"
@@ -47,6 +49,8 @@
 #include "world.hpp"
 #include "server/lua_api.hpp"
 #include "server/server_network.hpp"
+#include "server/threat_map.hpp"
+#include "server/diplomacy_index.hpp"
 #include "action.hpp"
 #include "server/economy.hpp"
 
@@ -63,8 +67,10 @@ namespace AI {
 template<typename T>
 static const T& find_or_throw(const std::string_view ref_name) {
     const auto& list = World::get_instance().get_list((T*)nullptr);
-    const auto result = std::find_if(list.begin(), list.end(), [ref_name](const auto& o) {
-        return !strcmp(o.ref_name.data(), ref_name.data());
+    // Interned strings, a name which was never inserted can't belong to any object
+    const auto ref = Eng3D::StringManager::get_instance().find(ref_name);
+    const auto result = !ref.has_value() ? list.end() : std::find_if(list.begin(), list.end(), [&ref](const auto& o) {
+        return o.ref_name == ref.value();
     });
 
     if(result == list.end())
@@ -134,6 +140,7 @@ void World::init_lua() {
         auto& relation = g_world.get_relation(nation, other_nation);
         relation.alliance = 0.45f; // Just below to not make a customs union
         relation.relation = 0.f;
+        diplomacy_index.on_relation_change(nation, other_nation);
         return 0;
     });
     lua_register(lua.state, "nation_make_customs_union", [](lua_State* L) {
@@ -142,6 +149,7 @@ void World::init_lua() {
         auto& relation = g_world.get_relation(nation, other_nation);
         relation.alliance = 1.f;
         relation.relation = 0.f;
+        diplomacy_index.on_relation_change(nation, other_nation);
         return 0;
     });
     lua_register(lua.state, "set_nation_flag", [](lua_State* L) {
@@ -413,11 +421,26 @@ static void lua_exec_all_of(World& world, const std::vector<std::string> files,
         CXX_THROW(Eng3D::LuaException, lua_tostring(world.lua.state, -1));
 }
 
+static void log_archive_stats(const Eng3D::Deser::ChunkedArchive& ar, const char* action) {
+    for(const auto& stats : ar.get_stats())
+        Eng3D::Log::debug("archive", "%s %s: %zu elements in %zu chunks (%zu bytes) took %.2fms", action, stats.name.data(), stats.elements, stats.chunks, stats.bytes, stats.ms);
+}
+
+void World::save(Eng3D::Deser::ChunkedArchive& ar) const {
+    Eng3D::Deser::Serializer<World>::deser_chunked<true>(ar, *this);
+    log_archive_stats(ar, "Serializing");
+}
+
+void World::load(Eng3D::Deser::ChunkedArchive& ar) {
+    Eng3D::Deser::Serializer<World>::deser_chunked<false>(ar, *this);
+    log_archive_stats(ar, "Deserializing");
+}
+
 void World::load_initial() try {
-    Eng3D::Deser::Archive ar{};
+    Eng3D::Deser::ChunkedArchive ar{};
     ar.from_file("world.cch");
-    Eng3D::Deser::deserialize(ar, Eng3D::StringManager::get_instance().strings);
-    Eng3D::Deser::deserialize(ar, *this);
+    Eng3D::Deser::deserialize(ar.header, Eng3D::StringManager::get_instance());
+    this->load(ar);
 } catch(const std::exception& e) {
     Eng3D::Log::error("cache", e.what());
 
@@ -432,7 +455,7 @@ void World::load_initial() try {
     auto div = std::make_unique<Eng3D::BinaryImage>(Eng3D::State::get_instance().package_man.get_unique("map/provinces.png")->abs_path);
     width = div->width;
     height = div->height;
-    tiles = std::make_unique<ProvinceId[]>(width * height);
+    auto raw_tiles = std::make_unique<ProvinceId[]>(width * height);
 
     Eng3D::Log::debug("world", translate("Associate tiles with provinces"));
 
@@ -444,11 +467,14 @@ void World::load_initial() try {
         province_color_table[province.color & 0xffffff] = this->get_id(province);
 
     const auto* raw_buffer = div->buffer.get();
-    tbb::parallel_for(static_cast<size_t>(0), height, [this, &province_color_table, raw_buffer](const auto j) {
+    tbb::parallel_for(static_cast<size_t>(0), height, [this, &province_color_table, raw_buffer, &raw_tiles](const auto j) {
         const auto off = j * width;
         for(size_t i = 0; i < width; i++)
-            tiles[off + i] = province_color_table[raw_buffer[off + i] & 0xffffff];
+            raw_tiles[off + i] = province_color_table[raw_buffer[off + i] & 0xffffff];
     });
+    tiles = Eng3D::RLEGrid<ProvinceId>(raw_tiles.get(), width, height);
+    raw_tiles.reset();
+    Eng3D::Log::debug("world", "Tiles encoded into %zu runs (%zu bytes)", tiles.run_count(), tiles.memory_usage());
 
 //#if 0
     std::set<uint32_t> colors_found;
@@ -510,14 +536,14 @@ void World::load_initial() try {
         province.box_area.top = height;
     }
 
-    for(size_t i = 0; i < width; i++) {
-        for(size_t j = 0; j < height; j++) {
-            auto& province = provinces[this->tiles[i + j * width]];
-            province.box_area.left = glm::min(province.box_area.left, static_cast<float>(i));
-            province.box_area.right = glm::max(province.box_area.right, static_cast<float>(i));
+    for(size_t j = 0; j < height; j++) {
+        this->tiles.for_each_run(j, [this, j](size_t x_start, size_t x_end, ProvinceId province_id) {
+            auto& province = provinces[province_id];
+            province.box_area.left = glm::min(province.box_area.left, static_cast<float>(x_start));
+            province.box_area.right = glm::max(province.box_area.right, static_cast<float>(x_end - 1));
             province.box_area.bottom = glm::max(province.box_area.bottom, static_cast<float>(j));
             province.box_area.top = glm::min(province.box_area.top, static_cast<float>(j));
-        }
+        });
     }
 
     // Correct stuff from provinces
@@ -529,23 +555,27 @@ void World::load_initial() try {
 
     // Neighbours
     Eng3D::Log::debug("world", translate("Calculating neighbours for provinces"));
-    for(size_t i = 0; i < width * height; i++) {
-        auto& province = this->provinces[this->tiles[i]];
-        if(i > this->width) { // Up
-            auto other_tile = this->tiles[i - this->width];
-            province.neighbour_ids.push_back(other_tile);
-        }
-        if(i < (this->width * this->height) - this->width) { // Down
-            auto other_tile = this->tiles[i + this->width];
-            province.neighbour_ids.push_back(other_tile);
-        }
-        if(i > 1) { // Left
-            auto other_tile = this->tiles[i - 1];
-            province.neighbour_ids.push_back(other_tile);
-        }
-        if(i < (this->width * this->height) - 1) { // Right
-            auto other_tile = this->tiles[i + 1];
-            province.neighbour_ids.push_back(other_tile);
+    const auto add_neighbours = [this](ProvinceId a, ProvinceId b) {
+        if(a == b) return;
+        this->provinces[a].neighbour_ids.push_back(b);
+        this->provinces[b].neighbour_ids.push_back(a);
+    };
+    for(size_t j = 0; j < height; j++) {
+        // Left and right, consecutive runs of the same row always differ
+        const auto first = this->tiles.row_offsets[j], last = this->tiles.row_offsets[j + 1];
+        for(auto k = first; k + 1 < last; k++)
+            add_neighbours(this->tiles.run_values[k], this->tiles.run_values[k + 1]);
+
+        // Up and down, walk the runs of this row and the one below as they overlap
+        if(j + 1 >= height) continue;
+        auto a = first, b = last;
+        const auto b_last = this->tiles.row_offsets[j + 2];
+        while(a < last && b < b_last) {
+            add_neighbours(this->tiles.run_values[a], this->tiles.run_values[b]);
+            const size_t a_end = a + 1 < last ? this->tiles.run_starts[a + 1] : width;
+            const size_t b_end = b + 1 < b_last ? this->tiles.run_starts[b + 1] : width;
+            if(a_end <= b_end) a++;
+            if(b_end <= a_end) b++;
         }
     }
 
@@ -578,9 +608,9 @@ void World::load_initial() try {
     }
 
     // Write the entire world to the cache file
-    Eng3D::Deser::Archive ar{};
-    Eng3D::Deser::serialize(ar, Eng3D::StringManager::get_instance().strings);
-    Eng3D::Deser::serialize(ar, *this);
+    Eng3D::Deser::ChunkedArchive ar{};
+    Eng3D::Deser::serialize(ar.header, Eng3D::StringManager::get_instance());
+    this->save(ar);
     ar.to_file("world.cch");
 }
 
@@ -589,6 +619,7 @@ void World::load_mod() {
         "mod", "postinit"
     };
     lua_exec_all_of(*this, mod_files, "lua/init");
+    this->update_aggregates();
 
     // Server needs now to sync changes to clients (changing state is not enough)
     this->needs_to_sync = true;
@@ -604,9 +635,7 @@ static inline void unit_do_tick(World& world, Unit& unit) {
     }
 
     auto& province = world.provinces[unit.province_id()];
-    // Replenish units
-    if(unit.size < unit.base)
-        unit.size = glm::min<float>(unit.base, unit.size + unit.experience * 10.f);
+    unit.replenish();
 
     if(unit.has_target_province()) {
         assert(unit.get_target_province_id() != unit.province_id());
@@ -710,7 +739,7 @@ static inline void unit_do_battle_tick(World& world, Unit& unit) {
             v.erase(std::unique(v.begin(), v.end()), v.end());
             province.battle.defender_nations_ids = v;
 
-            Eng3D::Log::debug("game", string_format("New battle on province %s", province.name.data()));
+            Eng3D::Log::debug("game", "New battle on province %s", province.name.data());
         }
     }
 
@@ -724,30 +753,82 @@ static inline void unit_do_battle_tick(World& world, Unit& unit) {
     assert(std::adjacent_find(unit_ids.begin(), unit_ids.end()) == unit_ids.end());
 }
 
-void World::fire_special_event(const std::string_view event_ref_name, const std::string_view nation_ref_name, const std::string_view other_nation_ref_name) {
+void World::fire_special_event(const std::string_view event_ref_name, NationId nation_id, NationId other_nation_id) {
+    // There are few events, unlike nations which are taken by id
     auto event_it = std::find_if(this->events.begin(), this->events.end(), [&](const auto& e) {
         return e.ref_name.get_string() == event_ref_name;
     });
     if(event_it == this->events.end())
         CXX_THROW(std::runtime_error, translate_format("Can't find special event %s", event_ref_name.data()));
 
-    auto nation_it = std::find_if(this->nations.begin(), this->nations.end(), [&](const auto& e) {
-        return e.ref_name.get_string() == nation_ref_name;
-    });
-    if(nation_it == this->nations.end())
-        CXX_THROW(std::runtime_error, translate_format("Can't find the first nation %s for firing special event %s", nation_ref_name.data(), event_ref_name.data()));
+    auto& nation = this->nations[nation_id];
+    const auto& other_nation = this->nations[other_nation_id];
+    bool discard = false;
+    LuaAPI::fire_event(this->lua.state, nation, *event_it, discard, other_nation.ref_name.get_string());
+}
 
-    auto other_nation_it = std::find_if(this->nations.begin(), this->nations.end(), [&](const auto& e) {
-        return e.ref_name.get_string() == other_nation_ref_name;
+/// @brief Refreshes the cached aggregates of every province and nation in a single
+/// parallel reduction, each nation only reads from the provinces it owns
+void World::update_aggregates() {
+    tbb::parallel_for(tbb::blocked_range(this->provinces.begin(), this->provinces.end()), [](auto& provinces_range) {
+        for(auto& province : provinces_range)
+            province.stats = province.calc_stats();
     });
-    if(other_nation_it == this->nations.end())
-        CXX_THROW(std::runtime_error, translate_format("Can't find the second nation %s for firing special event %s", nation_ref_name.data(), event_ref_name.data()));
+    tbb::parallel_for(tbb::blocked_range(this->nations.begin(), this->nations.end()), [this](auto& nations_range) {
+        for(auto& nation : nations_range) {
+            AggregateStats stats{};
+            for(const auto province_id : nation.owned_provinces)
+                stats.merge(this->provinces[province_id].stats);
+            nation.stats = stats;
+        }
+    });
+}
 
-    bool discard = false;
-    LuaAPI::fire_event(this->lua.state, *nation_it, *event_it, discard, other_nation_ref_name);
+/// @brief Debug consistency checker, recomputes all the aggregates serially and compares
+/// them against the cached ones
+/// @return true If the cached aggregates match the world state
+bool World::check_aggregates() const {
+    const auto is_close = [](float a, float b) {
+        return std::fabs(a - b) <= glm::max(std::fabs(a), std::fabs(b)) * 0.001f + 0.001f;
+    };
+    const auto is_same = [&is_close](const AggregateStats& a, const AggregateStats& b) {
+        return is_close(a.total_pops, b.total_pops) && is_close(a.militancy, b.militancy)
+            && is_close(a.literacy, b.literacy) && is_close(a.life_needs_met, b.life_needs_met)
+            && is_close(a.gdp, b.gdp) && is_close(a.industrial_score, b.industrial_score);
+    };
+
+    bool is_consistent = true;
+    for(const auto& province : this->provinces) {
+        if(!is_same(province.stats, province.calc_stats())) {
+            Eng3D::Log::error("aggregates", "Stale aggregates on province %s", province.ref_name.data());
+            is_consistent = false;
+        }
+    }
+
+    for(const auto& nation : this->nations) {
+        AggregateStats stats{};
+        for(const auto province_id : nation.owned_provinces)
+            stats.merge(this->provinces[province_id].calc_stats());
+        if(!is_same(nation.stats, stats)) {
+            Eng3D::Log::error("aggregates", "Stale aggregates on nation %s", nation.ref_name.data());
+            is_consistent = false;
+        }
+    }
+    return is_consistent;
 }
 
 void World::do_tick() {
+    // The tick is the writer of the world, so it holds the lock exclusively for its whole duration
+    const auto wait_start = std::chrono::steady_clock::now();
+    const std::scoped_lock lock(this->world_mutex);
+    profiler.record("Tick lock wait", std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - wait_start).count());
+
+    profiler.start("Commands");
+    // Apply the actions the clients sent during the last tick
+    if(g_server != nullptr)
+        g_server->apply_commands();
+    profiler.stop("Commands");
+
     province_manager.clear();
 
     profiler.start("Economy");
@@ -760,10 +841,8 @@ void World::do_tick() {
     profiler.stop("AI");
 
     profiler.start("E-packages");
-    if(g_server != nullptr) {
+    if(g_server != nullptr)
         g_server->broadcast(Action::NationUpdate::form_packet(nations));
-        g_server->broadcast(Action::ProvinceUpdate::form_packet(provinces));
-    }
     profiler.stop("E-packages");
 
     profiler.start("Research");
@@ -777,7 +856,7 @@ void World::do_tick() {
         if(!treaty.in_effect()) continue;
 
         // Treaties clauses now will be enforced
-        Eng3D::Log::debug("game", string_format("Enforcing treaty %s", treaty.name));
+        Eng3D::Log::debug("game", "Enforcing treaty %s", treaty.name.data());
         for(auto& clause : treaty.clauses) {
             assert(clause != nullptr);
             if(clause->type == TreatyClauseType::PAYMENT) {
@@ -813,6 +892,7 @@ void World::do_tick() {
             // war with the puppets of the receiver, and also stop war
             // with each other depending on the clauses
             relation.has_war = false;
+            diplomacy_index.on_relation_change(treaty.sender_id, treaty.receiver_id);
         }
     }
     profiler.stop("Treaties");
@@ -832,6 +912,8 @@ void World::do_tick() {
     std::vector<UnitId> clear_units;
     for(auto& province : provinces) {
         if(province.battle.active) {
+            // Casualties and units leaving the battle change the forces on the province
+            threat_map.on_battle(province);
             auto& units = this->unit_manager.units;
             const auto attacker_unit_ids = province.battle.get_attacker_unit_ids();
             const auto defender_unit_ids = province.battle.get_defender_unit_ids();
@@ -882,7 +964,7 @@ void World::do_tick() {
                 auto& unit = units[unit_id];
                 assert(unit_id == unit.get_id());
                 if(unit.size < 1.f) {
-                    Eng3D::Log::debug("game", string_format("Removing unit id=%zu from province %s", (size_t)unit_id, province.name.data()));
+                    Eng3D::Log::debug("game", "Removing unit id=%zu from province %s", (size_t)unit_id, province.name.data());
                     assert(std::find(clear_units.begin(), clear_units.end(), unit_id) == clear_units.end());
                     clear_units.push_back(unit_id);
                     province.battle.unit_ids.erase(province.battle.unit_ids.begin() + i);
@@ -955,16 +1037,39 @@ void World::do_tick() {
     LuaAPI::check_events(this->lua.state);
     profiler.stop("Events");
 
+    profiler.start("Aggregates");
+    this->update_aggregates();
+    // Recomputing everything from scratch on every tick would hide the cost of the incremental
+    // updates when profiling debug builds, so it's only checked once a month
+    assert(this->time % ticks_per_month != 0 || this->check_aggregates());
+    profiler.stop("Aggregates");
+
     profiler.start("Send packets");
+    // Provinces and units are only sent to the clients that can see them
     if(g_server != nullptr)
-        g_server->broadcast(Action::UnitUpdate::form_packet(this->unit_manager.units));
+        g_server->replicate(*this);
     profiler.stop("Send packets");
 
+    // Every temporary of this tick is gone by now, give the arenas back
+    Eng3D::Log::debug("game", "Tick arenas used %zu bytes", Eng3D::TickArena::get_used());
+    Eng3D::TickArena::reset();
+
     if(!(time % ticks_per_month))
-        Eng3D::Log::debug("game", Eng3D::translate_format("%i/%i/%i", time / 12 / ticks_per_month, (time / ticks_per_month % 12) + 1, (time % ticks_per_month) + 1));
-    Eng3D::Log::debug("game", Eng3D::translate_format("Tick %i done", time));
+        Eng3D::Log::debug("game", "%i/%i/%i", time / 12 / ticks_per_month, (time / ticks_per_month % 12) + 1, (time % ticks_per_month) + 1);
+    Eng3D::Log::debug("game", "Tick %i done", time);
     time++;
 
+    if(g_server != nullptr)
+        g_server->recorder.end_tick(*this);
+
+    // Time waited on the world lock by everyone since the last tick, useful to know
+    // which side (readers or writers) is stalling the simulation
+    const auto lock_stats = this->world_mutex.take_stats();
+    profiler.record("World lock writers wait", lock_stats.exclusive_wait_ms);
+    profiler.record("World lock readers wait", lock_stats.shared_wait_ms);
+    if(lock_stats.contended_count)
+        Eng3D::Log::debug("game", "World lock contended %zu times (writers %.2fms, readers %.2fms)", lock_stats.contended_count, lock_stats.exclusive_wait_ms, lock_stats.shared_wait_ms);
+
     if(g_server != nullptr) {
         // Tell clients that this tick has been done
         Eng3D::Networking::Packet packet{};
@@ -43,13 +43,18 @@
 #include <glm/vec2.hpp>
 
 #include "eng3d/serializer.hpp"
+#include "eng3d/chunked_archive.hpp"
 #include "eng3d/entity.hpp"
 #include "eng3d/profiler.hpp"
+#include "eng3d/rwlock.hpp"
 #include "eng3d/string.hpp"
 #include "eng3d/log.hpp"
 #include "eng3d/luavm.hpp"
 #include "eng3d/color.hpp"
 #include "eng3d/freelist.hpp"
+#include "eng3d/small_map.hpp"
+#include "eng3d/ranking.hpp"
+#include "eng3d/rle_grid.hpp"
 
 struct CommodityId : EntityId<uint8_t> {
     CommodityId() = default;
@@ -561,6 +566,29 @@ namespace TreatyClause {
     class BaseClause;
 }
 struct Technology;
+/// @brief Aggregates over the pops and buildings of a province or a nation, these are
+/// cached so consumers (UI, map modes, AI) don't have to loop over the pops on every query
+struct AggregateStats {
+    float total_pops = 0.f;
+    float militancy = 0.f; // Average militancy (weighted by pop size)
+    float literacy = 0.f; // Average literacy (weighted by pop size)
+    float life_needs_met = 0.f; // Average life needs met (weighted by pop size)
+    float gdp = 0.f; // Value of everything produced by the buildings
+    float industrial_score = 0.f;
+
+    /// @brief Merges the aggregates of another province onto this one
+    void merge(const AggregateStats& rhs) noexcept {
+        const auto new_total = this->total_pops + rhs.total_pops;
+        if(new_total > 0.f) {
+            this->militancy = (this->militancy * this->total_pops + rhs.militancy * rhs.total_pops) / new_total;
+            this->literacy = (this->literacy * this->total_pops + rhs.literacy * rhs.total_pops) / new_total;
+            this->life_needs_met = (this->life_needs_met * this->total_pops + rhs.life_needs_met * rhs.total_pops) / new_total;
+        }
+        this->total_pops = new_total;
+        this->gdp += rhs.gdp;
+        this->industrial_score += rhs.industrial_score;
+    }
+};
 class Nation : public RefnameEntity<NationId> {
     void do_diplomacy() {
         /// @todo Fix this formula which is currently broken
@@ -670,6 +698,9 @@ public:
     std::vector<Nation::ClientHint> client_hints; // Hints for the client on how to draw a nation on the client
     std::unordered_map<std::string, float> flags; // Flags that can be manipulated by events
     std::string client_username; // Used by clients to store usernames from nations - not saved
+    /// @brief Cached aggregates of all the owned provinces, refreshed by
+    /// World::update_aggregates - not saved
+    AggregateStats stats;
 
     struct {
         float public_loans = 0.f; // Obtained in public loans
@@ -906,6 +937,28 @@ struct Eng3D::Deser::Serializer<BuildingType> {
     }
 };
 
+/// @brief Money put onto a building by one of its owners, defined outside of Building
+/// so it's complete by the time the maps of investments are instantiated
+struct BuildingInvestment {
+    float total = 0.f;
+    float today_funds = 0.f;
+
+    void invest(float amount) noexcept {
+        total += amount;
+        today_funds += amount;
+    }
+
+    float get_ownership(float total_investments) const noexcept {
+        if(total == 0.f || total_investments == 0.f) return 0.f;
+        return total_investments / total;
+    }
+
+    float get_dividends(float profit, float ownership) const noexcept {
+        assert(ownership >= 0.f && ownership <= 1.f);
+        return profit * ownership;
+    }
+};
+
 class Province;
 /// @brief A military outpost, on land serves as a "spawn" place for units
 /// When adjacent to a water tile this serves as a shipyard for spawning naval units
@@ -948,40 +1001,27 @@ struct Building : Entity<BuildingId> {
 
     void work_on_unit(const UnitType& unit_type);
 
-    struct Investment {
-        float total = 0.f;
-        float today_funds = 0.f;
-
-        void invest(float amount) noexcept {
-            total += amount;
-            today_funds += amount;
-        }
-
-        float get_ownership(float total_investments) const noexcept {
-            if(total == 0.f || total_investments == 0.f) return 0.f;
-            return total_investments / total;
-        }
-
-        float get_dividends(float profit, float ownership) const noexcept {
-            assert(ownership >= 0.f && ownership <= 1.f);
-            return profit * ownership;
-        }
-    };
+    using Investment = BuildingInvestment;
     Investment estate_private;
     Investment estate_state;
     Investment estate_collective;
     Investment estate_individual;
-    std::vector<Investment> estate_foreign;
+    /// @brief Investments of other nations, only the ones that have invested are present
+    Eng3D::SmallMap<NationId, Investment> estate_foreign;
     float get_total_investment() const noexcept {
         auto sum = estate_private.total;
         sum += estate_state.total;
         sum += estate_collective.total;
         sum += estate_individual.total;
-        for(const auto& foreign : estate_foreign)
+        for(const auto& [nation_id, foreign] : estate_foreign)
             sum += foreign.total;
         return sum;
     }
 
+    Investment& get_foreign_investment(NationId nation_id) {
+        return this->estate_foreign[nation_id];
+    }
+
     float budget = 0.f; // Total money that the industry has
     float level = 0.f; // Level/Capacity scale of the building
     float workers = 1.f; // Amount of workers
@@ -1083,6 +1123,8 @@ public:
         return total / pops.size();
     }
 
+    AggregateStats calc_stats() const noexcept;
+
     float get_attractiveness(const Pop& pop) const;
     void add_building(const BuildingType& building_type);
     void cancel_construction_project();
@@ -1152,6 +1194,10 @@ public:
     std::vector<float> languages;
     /// @brief Percentage of each religion prescence on the pops, from 0 to 1
     std::vector<float> religions;
+    /// @brief Cached aggregates, refreshed by World::update_aggregates - not saved
+    AggregateStats stats;
+    /// @brief Building types by operating ratio, kept between ticks by the economy - not saved
+    Eng3D::Ranking<BuildingTypeId> factories_by_profitability;
 };
 template<>
 struct Eng3D::Deser::Serializer<Province::Battle> {
@@ -1555,6 +1601,8 @@ public:
     float days_to_move_to(const Province& province) const;
     bool update_movement(UnitManager& unit_manager); // Returns true if unit moved
     void set_owner(const Nation& nation);
+    /// @brief Bring the size of the unit back towards its base, as it's resupplied
+    void replenish();
 
     /// @brief Checks if the unit can move (if it can set_province)
     /// @return true 
@@ -1616,8 +1664,11 @@ public:
     void add_unit(Unit unit, ProvinceId unit_current_province);
     void remove_unit(UnitId unit);
     void move_unit(UnitId unit, ProvinceId target_province);
+    /// @brief Add or update an unit keeping the id it has on the server, used by
+    /// the clients to mirror the units the server replicates
+    void set_unit(Unit unit, ProvinceId province_id);
 
-    std::vector<UnitId> get_province_units(ProvinceId province_id) const noexcept {
+    const std::vector<UnitId>& get_province_units(ProvinceId province_id) const noexcept {
         return province_units[province_id];
     }
 
@@ -1670,7 +1721,12 @@ public:
     void init_lua();
     void load_initial();
     void load_mod();
-    void fire_special_event(const std::string_view event_ref_name, const std::string_view nation_ref_name, const std::string_view other_nation_ref_name);
+    /// @brief Write the world onto a chunked archive (i.e savefiles), logging the time each list took
+    void save(Eng3D::Deser::ChunkedArchive& ar) const;
+    void load(Eng3D::Deser::ChunkedArchive& ar);
+    void fire_special_event(const std::string_view event_ref_name, NationId nation_id, NationId other_nation_id);
+    void update_aggregates();
+    bool check_aggregates() const;
     Eng3D::Profiler profiler;
 
     LIST_FOR_LOCAL_TYPE(Commodity, commodities, std::vector)
@@ -1756,14 +1812,17 @@ public:
 
     Eng3D::LuaVM lua;
 
-    // 2D Array of tiles
-    std::unique_ptr<ProvinceId[]> tiles;
+    // 2D Array of tiles, rows are run-length encoded since most of a row are long
+    // stretches of the same province
+    Eng3D::RLEGrid<ProvinceId> tiles;
     size_t width, height;
     int time;
 
     /// @brief Used to signal the lua scripts of invalid operations (eg. adding a country midgame)
     bool needs_to_sync = false;
-    std::mutex world_mutex;
+    /// @brief Exclusively held by the tick and by mutating packets, shared by readers
+    /// such as the renderer
+    mutable Eng3D::RWLock world_mutex;
     std::mutex list_mutex;
     std::mutex inbox_mutex;
     std::vector<std::pair<Decision, NationId>> taken_decisions;
@@ -1795,21 +1854,44 @@ struct Eng3D::Deser::Serializer<World> {
 
         // Savefiles do not contain the tiles
         /// @todo Handle dynamic tiles (provinces changing shape for ex.)
-        bool has_tiles = obj.tiles.get() != nullptr;
+        bool has_tiles = !obj.tiles.empty();
         Eng3D::Deser::deser_dynamic<is_serialize>(ar, has_tiles);
-        if(has_tiles) {
-            if constexpr(is_serialize) {
-                // Serialize all tiles
-                ar.expand(obj.width * obj.height * sizeof(ProvinceId));
-                ar.copy_from(obj.tiles.get(), obj.width * obj.height * sizeof(ProvinceId));
-            } else {
-                // In order to avoid post-deserialization relational patcher, we will simply allocate everything with "empty" objects,
-                // then we will fill those spots as we deserialize
-                obj.tiles.reset(new ProvinceId[obj.width * obj.height]);
-                // Deserialize all tiles
-                ar.copy_to(obj.tiles.get(), obj.width * obj.height * sizeof(ProvinceId));
-            }
-        }
+        if(has_tiles)
+            Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.tiles);
+    }
+
+    /// @brief Same as above, but the big lists are split onto chunks which are
+    /// (de)serialized in parallel. Pops and buildings go with their provinces
+    template<bool is_serialize>
+    static inline void deser_chunked(Eng3D::Deser::ChunkedArchive& car, type<is_serialize>& obj) {
+        auto& ar = car.header;
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.width);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.height);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.time);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.commodities);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.unit_types);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.religions);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.languages);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.pop_types);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.terrain_types);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.building_types);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.ideologies);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.technologies);
+        car.deser_list<is_serialize, Nation>("nations", obj.nations, 16);
+        car.deser_list<is_serialize, Province>("provinces", obj.provinces, 256);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.events);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.treaties);
+        car.deser_list<is_serialize, std::optional<Unit>>("units", obj.unit_manager.units.data, 4096);
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.unit_manager.units.slots);
+        car.deser_list<is_serialize, ProvinceId>("unit_province", obj.unit_manager.unit_province, 16384);
+        car.deser_list<is_serialize, std::vector<UnitId>>("province_units", obj.unit_manager.province_units, 4096);
+        car.deser_list<is_serialize, Nation::Relation>("relations", obj.relations, 16384);
+
+        bool has_tiles = !obj.tiles.empty();
+        Eng3D::Deser::deser_dynamic<is_serialize>(ar, has_tiles);
+        if(has_tiles)
+            Eng3D::Deser::deser_dynamic<is_serialize>(ar, obj.tiles);
+        Eng3D::Deser::Serializer<Economy::History>::deser_chunked<is_serialize>(car, obj.economy_state.history);
     }
 };
 
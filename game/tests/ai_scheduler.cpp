@@ -0,0 +1,75 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      tests/ai_scheduler.cpp
+//
+// Abstract:
+//      Checks that a nation becoming eligible for a phase of the AI late, i.e
+//      a player handing their nation to the AI, doesn't catch up on every tick
+//      it wasn't eligible for.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <algorithm>
+
+#include "server/ai_scheduler.hpp"
+
+static int test_late_eligibility(AIPhase phase, int eligible_tick, int ticks = 200) {
+    AIScheduler scheduler{};
+    scheduler.init(2, 0);
+    scheduler.set_budgeted(false);
+    const auto period = scheduler.get_config(phase).period;
+
+    size_t late_runs = 0;
+    for(int tick = 0; tick < ticks; tick++) {
+        // The first nation is always run by the AI, the second one only from eligible_tick on
+        const auto& nation_ids = scheduler.plan(phase, tick, [&](const NationId nation_id) {
+            return nation_id == NationId(0) || tick >= eligible_tick;
+        });
+        for(const auto nation_id : nation_ids) {
+            if(nation_id == NationId(1)) {
+                if(tick < eligible_tick) {
+                    std::cout << "Nation ran on tick " << tick << " before becoming eligible" << std::endl;
+                    return -1;
+                }
+                late_runs++;
+            }
+            // Without a budget nobody is deferred, so no nation can be owed more than a period
+            const auto elapsed = scheduler.get_elapsed(phase, nation_id);
+            if(elapsed > period) {
+                std::cout << "Nation " << static_cast<size_t>(nation_id) << " ran on tick " << tick << " with " << elapsed << " ticks elapsed, the period is " << period << std::endl;
+                return -1;
+            }
+        }
+    }
+    if(late_runs == 0) {
+        std::cout << "Nation never ran after becoming eligible" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "AIScheduler" << std::endl;
+    for(const auto phase : { AIPhase::INVESTMENTS, AIPhase::LOANS })
+        for(const auto eligible_tick : { 2, 37, 150 })
+            if(test_late_eligibility(phase, eligible_tick) != 0)
+                return -1;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      tests/pop_needs.cpp
+//
+// Abstract:
+//      Golden test of the consumption of the pops, against a small province
+//      worked out by hand.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "world.hpp"
+#include "server/pop_needs.hpp"
+
+static bool near(float a, float b) {
+    return std::abs(a - b) <= 1e-4f * std::max(1.f, std::abs(b));
+}
+
+/// @brief The empty pop in the middle must not stop the pop after it from buying
+static int test_golden_province() {
+    std::vector<PopType> pop_types(1);
+    pop_types[0].cached_id = PopTypeId(0);
+    pop_types[0].basic_needs_amount = { 1.f, 3.f };
+    Economy::PopNeedsTable table{};
+    table.build(pop_types, 2);
+
+    std::vector<Product> products(2);
+    products[0].price = 2.f;
+    products[1].price = 4.f;
+    products[0].supply = products[1].supply = 100.f;
+    std::array<Pop, 3> pops;
+    pops[0].size = 10.f;
+    pops[1].size = 0.5f;
+    pops[2].size = 20.f;
+    std::array<PopNeed, 3> pop_needs;
+    pop_needs[0] = PopNeed{ 0.f, 100.f, 0.f };
+    pop_needs[1] = PopNeed{ 0.f, 50.f, 0.f };
+    pop_needs[2] = PopNeed{ -0.5f, 40.f, 0.f };
+    std::array<float, 3> to_borrow;
+    auto state_payment = 0.f;
+    Economy::consume_pop_needs(table, pops, pop_needs, products, 0.1f, state_payment, to_borrow);
+
+    const bool passed = near(state_payment, 11.2f)
+        && near(pop_needs[0].budget, 92.8f) && near(pop_needs[0].life_needs_met, 0.12375f) && near(to_borrow[0], 0.f)
+        && near(pop_needs[1].budget, 50.f) && near(pop_needs[1].life_needs_met, 0.f) && near(to_borrow[1], 0.f)
+        && near(pop_needs[2].budget, 38.56f) && near(pop_needs[2].life_needs_met, -0.487625f) && near(to_borrow[2], 280.f)
+        && near(products[0].bought, 1.08f) && near(products[0].demand, 1.08f)
+        && near(products[1].bought, 1.62f) && near(products[1].demand, 1.62f);
+    if(!passed) {
+        std::cout << "Golden province differs: state " << state_payment
+            << ", budgets " << pop_needs[0].budget << " " << pop_needs[1].budget << " " << pop_needs[2].budget
+            << ", needs " << pop_needs[0].life_needs_met << " " << pop_needs[1].life_needs_met << " " << pop_needs[2].life_needs_met
+            << ", borrow " << to_borrow[0] << " " << to_borrow[1] << " " << to_borrow[2] << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "Economy::consume_pop_needs" << std::endl;
+    if(test_golden_province() != 0)
+        return -1;
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Symphony of Empires
+// Copyright (C) 2021, Symphony of Empires contributors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// ----------------------------------------------------------------------------
+// Name:
+//      tests/save_writer.cpp
+//
+// Abstract:
+//      Checks that the world can be saved while the world lock is held, as the
+//      save button does from client_update, and without it, as autosaves do.
+// ----------------------------------------------------------------------------
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <filesystem>
+
+#include "eng3d/string.hpp"
+
+#include "world.hpp"
+#include "server/save_writer.hpp"
+
+static void generate_world(World& world) {
+    Nation nation{};
+    nation.ref_name = "nation";
+    nation.name = nation.ref_name;
+    world.insert(nation);
+    Province province{};
+    province.ref_name = "province";
+    province.name = province.ref_name;
+    province.owner_id = province.controller_id = NationId(0);
+    world.insert(province);
+    world.nations[0].owned_provinces.push_back(ProvinceId(0));
+    world.nations[0].controlled_provinces.push_back(ProvinceId(0));
+    world.relations.resize(world.nations.size() * world.nations.size());
+}
+
+/// @brief Saves on another thread, a deadlocked save can't be joined so it's reported and abandoned
+template<typename F>
+static void wait_for_save(F&& fn) {
+    auto future = std::async(std::launch::async, std::forward<F>(fn));
+    if(future.wait_for(std::chrono::seconds(10)) == std::future_status::timeout) {
+        std::cout << "Saving didn't finish, is it waiting for the world lock?" << std::endl;
+        std::_Exit(1);
+    }
+    future.get();
+}
+
+static int test_save_writer() {
+    auto& world = World::get_instance();
+    generate_world(world);
+    const auto locked_path = (std::filesystem::temp_directory_path() / "save_writer_locked.sc4").string();
+    const auto unlocked_path = (std::filesystem::temp_directory_path() / "save_writer_unlocked.sc4").string();
+    std::filesystem::remove(locked_path);
+    std::filesystem::remove(unlocked_path);
+
+    SaveWriter save_writer{};
+    wait_for_save([&] {
+        const std::scoped_lock lock(world.world_mutex);
+        save_writer.save_locked(world, NationId(0), locked_path);
+    });
+    wait_for_save([&] {
+        save_writer.save(world, NationId(0), unlocked_path);
+    });
+    save_writer.wait();
+
+    const auto metrics = save_writer.get_metrics();
+    if(metrics.saves_written != 2 || metrics.failures != 0 || !std::filesystem::exists(locked_path) || !std::filesystem::exists(unlocked_path)) {
+        std::cout << "Expected 2 savefiles, " << metrics.saves_written << " were written and " << metrics.failures << " failed" << std::endl;
+        return -1;
+    }
+    std::filesystem::remove(locked_path);
+    std::filesystem::remove(unlocked_path);
+    std::cout << "Test passed" << std::endl;
+    return 0;
+}
+
+int main(int, char**) {
+    std::cout << "SaveWriter" << std::endl;
+    Eng3D::StringManager string_man;
+    return test_save_writer();
+}